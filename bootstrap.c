@@ -72,7 +72,7 @@ bootstrap_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **appl
 					    }
 				    }
 				    xpc_dictionary_set_uint64(dict, "type", 2);
-				    xpc_dictionary_set_uint64(dict, "handle", xpc_user_sessions_get_foreground_uid(0));
+				    xpc_dictionary_set_uint64(dict, "handle", launchctl_foreground_uid());
 				    return false;
 				});
 			}
@@ -139,7 +139,7 @@ bootout_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 					    }
 				    }
 				    xpc_dictionary_set_uint64(dict, "type", 2);
-				    xpc_dictionary_set_uint64(dict, "handle", xpc_user_sessions_get_foreground_uid(0));
+				    xpc_dictionary_set_uint64(dict, "handle", launchctl_foreground_uid());
 				    return false;
 				});
 			}
@@ -0,0 +1,158 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "dotenv.h"
+
+int
+dotenv_parse(char *buf, size_t len, bool need_value, dotenv_entry_f entry, void *ctx, struct dotenv_error *err)
+{
+	char *p = buf, *end = buf + len, *key, *keyend, *value, *out;
+	int line = 1, start;
+
+#define BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\r')
+#define FAIL(m)                    \
+	do {                       \
+		err->line = start; \
+		err->message = m;  \
+		return EINVAL;     \
+	} while (0)
+
+	while (p < end) {
+		start = line;
+		while (p < end && BLANK(*p))
+			p++;
+		if (p == end)
+			break;
+		if (*p == '\n' || *p == '#') {
+			while (p < end && *p != '\n')
+				p++;
+			if (p < end)
+				p++;
+			line++;
+			continue;
+		}
+		if (strncmp(p, "export", 6) == 0 && BLANK(p[6])) {
+			p += 6;
+			while (p < end && BLANK(*p))
+				p++;
+		}
+
+		key = p;
+		if (!isalpha((unsigned char)*p) && *p != '_')
+			FAIL("invalid variable name");
+		while (p < end && (isalnum((unsigned char)*p) || *p == '_'))
+			p++;
+		keyend = p;
+		while (p < end && BLANK(*p))
+			p++;
+
+		if (p == end || *p == '\n' || *p == '#') {
+			if (need_value)
+				FAIL("expected '=' after variable name");
+			while (p < end && *p != '\n')
+				p++;
+			if (p < end) {
+				p++;
+				line++;
+			}
+			*keyend = '\0';
+			entry(key, NULL, ctx);
+			continue;
+		}
+		if (*p++ != '=')
+			FAIL("expected '=' after variable name");
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+
+		value = out = p;
+		if (*p == '\'' || *p == '"') {
+			char quote = *p++;
+			value = out = p;
+			while (p < end && *p != quote) {
+				if (*p == '\n')
+					line++;
+				if (quote == '"' && *p == '\\' && p + 1 < end) {
+					switch (p[1]) {
+						case 'n':
+							*out++ = '\n';
+							p += 2;
+							continue;
+						case 't':
+							*out++ = '\t';
+							p += 2;
+							continue;
+						case 'r':
+							*out++ = '\r';
+							p += 2;
+							continue;
+						case '"':
+						case '\\':
+						case '$':
+							*out++ = p[1];
+							p += 2;
+							continue;
+					}
+				}
+				*out++ = *p++;
+			}
+			if (p == end)
+				FAIL("unterminated quoted value");
+			p++;
+			while (p < end && BLANK(*p))
+				p++;
+			if (p < end && *p == '#')
+				while (p < end && *p != '\n')
+					p++;
+			if (p < end && *p != '\n')
+				FAIL("unexpected characters after quoted value");
+		} else {
+			while (p < end && *p != '\n' && !(*p == '#' && (out == value || BLANK(p[-1]))))
+				*out++ = *p++;
+			while (out > value && BLANK(out[-1]))
+				out--;
+			while (p < end && *p != '\n')
+				p++;
+		}
+		if (p < end) {
+			p++;
+			line++;
+		}
+		*keyend = '\0';
+		*out = '\0';
+		entry(key, value, ctx);
+	}
+	return 0;
+
+#undef FAIL
+#undef BLANK
+}
@@ -0,0 +1,55 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef _LAUNCHCTL_DOTENV_H_
+#define _LAUNCHCTL_DOTENV_H_
+
+/*
+ * Single-pass parser for dotenv-style files, used by setenv --from-file.
+ * Lines look like `[export] KEY=value`; values may be 'single quoted'
+ * (literal) or "double quoted" (with \n, \t, \r, \", \\ and \$ escapes) and
+ * may then span lines. Unquoted values end at a `#` preceded by whitespace.
+ * Blank lines, `#` comments and CRLF line endings are accepted. Values are
+ * unquoted in place, so the buffer must be writable and NUL-terminated.
+ */
+typedef void (*dotenv_entry_f)(const char *key, const char *value, void *ctx);
+
+struct dotenv_error {
+	int line;
+	const char *message;
+};
+
+/*
+ * Calls entry() for every variable in file order, with a NULL value for a
+ * bare `KEY` line when need_value is false. Returns 0, or EINVAL with the
+ * line (from 1) and a description of the first error in err.
+ */
+int dotenv_parse(char *buf, size_t len, bool need_value, dotenv_entry_f entry, void *ctx, struct dotenv_error *err);
+#endif
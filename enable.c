@@ -25,47 +25,184 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <ctype.h>
 #include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
 #include "xpc_private.h"
 
+/*
+ * Reads service targets from path, or standard input for "-", one per line.
+ * Blank lines and lines starting with # are skipped. The targets are
+ * appended to *targets, which is grown as needed.
+ */
+static int
+enable_read_targets(const char *path, char ***targets, int *count)
+{
+	FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+	char *line = NULL;
+	size_t cap = 0;
+	ssize_t len;
+	int ret = 0;
+
+	if (f == NULL) {
+		ret = errno;
+		fprintf(stderr, "Could not open %s: %d: %s\n", path, ret, strerror(ret));
+		return ret;
+	}
+	while ((len = getline(&line, &cap, f)) != -1) {
+		char *start = line, *end = line + len;
+		while (start < end && isspace((unsigned char)*start))
+			start++;
+		while (end > start && isspace((unsigned char)end[-1]))
+			end--;
+		if (start == end || *start == '#')
+			continue;
+		*end = '\0';
+
+		char **grown = realloc(*targets, (*count + 1) * sizeof(char *));
+		if (grown == NULL || (grown[*count] = strdup(start)) == NULL) {
+			if (grown != NULL)
+				*targets = grown;
+			ret = ENOMEM;
+			break;
+		}
+		*targets = grown;
+		(*count)++;
+	}
+	free(line);
+	if (f != stdin)
+		fclose(f);
+	return ret;
+}
+
+/*
+ * Adds every entry of list to the request for its domain in requests, keyed
+ * by type and handle, so each domain is sent one request with all of its
+ * names. Requests are also appended to order in the order their domains
+ * were first seen.
+ */
+static void
+enable_group_by_domain(xpc_object_t list, xpc_object_t requests, xpc_object_t order)
+{
+	for (size_t i = 0; i < xpc_array_get_count(list); i++) {
+		xpc_object_t target = xpc_array_get_value(list, i), dict, names;
+		char key[48];
+
+		snprintf(key, sizeof(key), "%" PRIu64 "/%" PRIu64, xpc_dictionary_get_uint64(target, "type"),
+		    xpc_dictionary_get_uint64(target, "handle"));
+		if ((dict = xpc_dictionary_get_value(requests, key)) == NULL) {
+			dict = xpc_dictionary_create(NULL, NULL, 0);
+			xpc_dictionary_set_uint64(dict, "type", xpc_dictionary_get_uint64(target, "type"));
+			xpc_dictionary_set_uint64(dict, "handle", xpc_dictionary_get_uint64(target, "handle"));
+			names = xpc_array_create(NULL, 0);
+			xpc_dictionary_set_value(dict, "names", names);
+			xpc_release(names);
+			xpc_dictionary_set_value(requests, key, dict);
+			xpc_array_append_value(order, dict);
+			xpc_release(dict);
+		}
+		names = xpc_dictionary_get_value(dict, "names");
+
+		const char *name = xpc_dictionary_get_string(target, "name");
+		bool seen = false;
+		for (size_t j = 0; j < xpc_array_get_count(names) && !seen; j++)
+			seen = strcmp(xpc_array_get_string(names, j), name) == 0;
+		if (!seen)
+			xpc_array_set_string(names, XPC_ARRAY_APPEND, name);
+	}
+}
+
 int
 enable_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 {
-	if (argc < 2)
-		return EUSAGE;
-
-	xpc_object_t dict, reply, names;
+	static const struct option longopts[] = {
+		{ "from-file", required_argument, NULL, 'f' },
+		{ NULL, 0, NULL, 0 },
+	};
+	xpc_object_t dict, reply, list, requests, order;
 	bool enable = strcmp(argv[0], "enable") == 0;
-	int ret;
-	const char *name;
+	char **targets = NULL;
+	size_t total = 0;
+	__block size_t failed = 0;
+	int ret = 0, count = 0, ch;
 
 	dict = xpc_dictionary_create(NULL, NULL, 0);
 	*msg = dict;
 	launchctl_setup_xpc_dict(dict);
-	ret = launchctl_setup_xpc_dict_for_service_name(argv[1], dict, &name);
-	if (ret != 0)
-		return ret;
-	if (name == NULL)
-		return EBADNAME;
 
-	names = xpc_array_create(NULL, 0);
-	xpc_dictionary_set_value(dict, "names", names);
-	xpc_array_set_string(names, XPC_ARRAY_APPEND, name);
+	while ((ch = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+		switch (ch) {
+			case 'f':
+				ret = enable_read_targets(optarg, &targets, &count);
+				break;
+			default:
+				ret = EUSAGE;
+				break;
+		}
+		if (ret != 0)
+			goto done;
+	}
+	for (int i = optind; i < argc; i++) {
+		char **grown = realloc(targets, (count + 1) * sizeof(char *));
+		if (grown == NULL || (grown[count] = strdup(argv[i])) == NULL) {
+			if (grown != NULL)
+				targets = grown;
+			ret = ENOMEM;
+			goto done;
+		}
+		targets = grown;
+		count++;
+	}
+	if (count == 0) {
+		ret = EUSAGE;
+		goto done;
+	}
+
+	if ((ret = launchctl_expand_service_targets(count, targets, &list)) != 0)
+		goto done;
+	if (xpc_array_get_count(list) == 0) {
+		xpc_release(list);
+		ret = ENOSERVICE;
+		goto done;
+	}
+	requests = xpc_dictionary_create(NULL, NULL, 0);
+	order = xpc_array_create(NULL, 0);
+	enable_group_by_domain(list, requests, order);
+	xpc_release(list);
+
+	for (size_t i = 0; i < xpc_array_get_count(order); i++) {
+		xpc_object_t request = xpc_array_get_value(order, i);
+		size_t nnames = xpc_array_get_count(xpc_dictionary_get_value(request, "names"));
+		int err;
+
+		// Keep the domain around for the messages printed by main()
+		if (i == 0) {
+			xpc_dictionary_set_uint64(dict, "type", xpc_dictionary_get_uint64(request, "type"));
+			xpc_dictionary_set_uint64(dict, "handle", xpc_dictionary_get_uint64(request, "handle"));
+		}
+		total += nnames;
+		reply = NULL;
+		err = launchctl_send_xpc_to_launchd(enable ? XPC_ROUTINE_ENABLE : XPC_ROUTINE_DISABLE, request, &reply);
+		if (err != 0) {
+			failed += nnames;
+			if (ret == 0)
+				ret = err;
+			if (err == ENODOMAIN && xpc_array_get_count(order) == 1)
+				break;
+			fprintf(stderr, "Could not %s %s: %d: %s\n", enable ? "enable" : "disable",
+			    nnames == 1 ? "service" : "services", err, xpc_strerror(err));
+			continue;
+		}
 
-	ret = launchctl_send_xpc_to_launchd(enable ? XPC_ROUTINE_ENABLE : XPC_ROUTINE_DISABLE, dict, &reply);
-	if (ret == ENODOMAIN)
-		return ret;
-	if (ret != 0) {
-		fprintf(stderr, "Could not %s service: %d: %s\n", enable ? "enable" : "disable", ret,
-		    xpc_strerror(ret));
-	} else {
 		xpc_object_t errors = xpc_dictionary_get_value(reply, "errors");
 		if (errors != NULL && xpc_get_type(errors) == XPC_TYPE_DICTIONARY) {
 			(void)xpc_dictionary_apply(errors, ^bool(const char *key, xpc_object_t value) {
@@ -76,12 +213,22 @@ enable_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 				    else
 					    fprintf(stderr, "%s: %s\n", key, xpc_strerror(err));
 			    }
+			    failed++;
 			    return true;
 			});
-			if (xpc_dictionary_get_count(errors) != 0)
+			if (xpc_dictionary_get_count(errors) != 0 && ret == 0)
 				ret = EMANY;
 		}
+		xpc_release(reply);
 	}
+	if (total > 1)
+		printf("%s %zu of %zu services.\n", enable ? "Enabled" : "Disabled", total - failed, total);
 
+	xpc_release(order);
+	xpc_release(requests);
+done:
+	for (int i = 0; i < count; i++)
+		free(targets[i]);
+	free(targets);
 	return ret;
 }
@@ -0,0 +1,419 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/fcntl.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <xpc/xpc.h>
+
+#include "entitlements.h"
+#include "launchctl.h"
+#include "macho.h"
+#include "trace.h"
+#include "xpc_private.h"
+
+#define ENTITLEMENTS_MAX_SLICES 16
+
+/*
+ * DER entitlements are encoded as
+ *
+ *	[APPLICATION 16] { INTEGER version, [CONTEXT 16] { dictionary } }
+ *
+ * where a dictionary is a SET of SEQUENCE { UTF8String key, value } and an
+ * array is a SEQUENCE of values. Values are BOOLEAN, INTEGER, UTF8String,
+ * arrays or dictionaries.
+ */
+#define DER_BOOLEAN 0x01
+#define DER_INTEGER 0x02
+#define DER_UTF8STRING 0x0c
+#define DER_SEQUENCE 0x30
+#define DER_SET 0x31
+#define DER_ENTITLEMENTS 0x70
+#define DER_ENTITLEMENTS_DICT 0xb0
+
+#define DER_MAX_DEPTH 32
+
+struct der_item {
+	uint8_t tag;
+	const uint8_t *data;
+	size_t len;
+};
+
+static bool
+der_next(const uint8_t **p, const uint8_t *end, struct der_item *item)
+{
+	const uint8_t *q = *p;
+	size_t len;
+
+	if (end - q < 2)
+		return false;
+	item->tag = *q++;
+	if ((item->tag & 0x1f) == 0x1f)
+		return false; // high tag numbers are never used
+
+	len = *q++;
+	if (len & 0x80) {
+		size_t nbytes = len & 0x7f;
+		if (nbytes == 0 || nbytes > sizeof(size_t) || (size_t)(end - q) < nbytes)
+			return false;
+		len = 0;
+		while (nbytes-- != 0)
+			len = (len << 8) | *q++;
+	}
+	if ((size_t)(end - q) < len)
+		return false;
+
+	item->data = q;
+	item->len = len;
+	*p = q + len;
+	return true;
+}
+
+static xpc_object_t der_decode_value(const struct der_item *item, int depth);
+
+static xpc_object_t
+der_decode_dict(const uint8_t *p, const uint8_t *end, int depth)
+{
+	xpc_object_t dict = xpc_dictionary_create(NULL, NULL, 0);
+	struct der_item entry, key, value;
+
+	while (p < end) {
+		if (!der_next(&p, end, &entry) || entry.tag != DER_SEQUENCE)
+			goto fail;
+		const uint8_t *q = entry.data, *qend = entry.data + entry.len;
+		if (!der_next(&q, qend, &key) || key.tag != DER_UTF8STRING || !der_next(&q, qend, &value) || q != qend)
+			goto fail;
+
+		char *k = strndup((const char *)key.data, key.len);
+		xpc_object_t v = der_decode_value(&value, depth + 1);
+		if (k == NULL || v == NULL) {
+			free(k);
+			if (v != NULL)
+				xpc_release(v);
+			goto fail;
+		}
+		xpc_dictionary_set_value(dict, k, v);
+		xpc_release(v);
+		free(k);
+	}
+	return dict;
+
+fail:
+	xpc_release(dict);
+	return NULL;
+}
+
+static xpc_object_t
+der_decode_value(const struct der_item *item, int depth)
+{
+	const uint8_t *p = item->data, *end = item->data + item->len;
+
+	if (depth > DER_MAX_DEPTH)
+		return NULL;
+
+	switch (item->tag) {
+		case DER_BOOLEAN:
+			if (item->len != 1)
+				return NULL;
+			return xpc_bool_create(item->data[0] != 0);
+		case DER_INTEGER: {
+			if (item->len == 0 || item->len > sizeof(int64_t))
+				return NULL;
+			// two's complement, big-endian
+			uint64_t val = (item->data[0] & 0x80) ? UINT64_MAX : 0;
+			for (size_t i = 0; i < item->len; i++)
+				val = (val << 8) | item->data[i];
+			return xpc_int64_create((int64_t)val);
+		}
+		case DER_UTF8STRING: {
+			char *str = strndup((const char *)item->data, item->len);
+			if (str == NULL)
+				return NULL;
+			xpc_object_t xstr = xpc_string_create(str);
+			free(str);
+			return xstr;
+		}
+		case DER_SEQUENCE: {
+			xpc_object_t array = xpc_array_create(NULL, 0);
+			struct der_item elem;
+			while (p < end) {
+				xpc_object_t v;
+				if (!der_next(&p, end, &elem) || (v = der_decode_value(&elem, depth + 1)) == NULL) {
+					xpc_release(array);
+					return NULL;
+				}
+				xpc_array_append_value(array, v);
+				xpc_release(v);
+			}
+			return array;
+		}
+		case DER_SET:
+			return der_decode_dict(p, end, depth);
+		default:
+			return NULL;
+	}
+}
+
+/*
+ * Decodes the payload of a CSMAGIC_EMBEDDED_DER_ENTITLEMENTS blob directly
+ * into an XPC dictionary. Returns NULL if the encoding is malformed.
+ */
+xpc_object_t
+launchctl_entitlements_from_der(const void *der, size_t len)
+{
+	const uint8_t *p = der, *end = p + len;
+	struct der_item outer, version, body, dict;
+
+	if (!der_next(&p, end, &outer) || outer.tag != DER_ENTITLEMENTS)
+		return NULL;
+
+	p = outer.data;
+	end = outer.data + outer.len;
+	if (!der_next(&p, end, &version) || version.tag != DER_INTEGER)
+		return NULL;
+	if (!der_next(&p, end, &body) || body.tag != DER_ENTITLEMENTS_DICT)
+		return NULL;
+
+	p = body.data;
+	end = body.data + body.len;
+	if (p == end)
+		return xpc_dictionary_create(NULL, NULL, 0);
+	if (!der_next(&p, end, &dict) || dict.tag != DER_SET)
+		return NULL;
+
+	return der_decode_dict(dict.data, dict.data + dict.len, 0);
+}
+
+struct entitlements_slice {
+	const char *arch;
+	int error;
+	xpc_object_t entitlements;
+};
+
+struct entitlements_file {
+	const char *path;
+	int error;
+	uint32_t count;
+	struct entitlements_slice slices[ENTITLEMENTS_MAX_SLICES];
+};
+
+/*
+ * Decodes the entitlements in the code signature of a slice, preferring the
+ * DER blob like the kernel does and falling back to the XML one. A signed
+ * slice without entitlements gets an empty dictionary; ENOENT means the
+ * slice is not signed, and EBADMACHO that a blob that is present does not
+ * decode.
+ */
+static int
+entitlements_copy_slice(struct macho_file *file, const struct macho_slice *slice, xpc_object_t *out)
+{
+	const void *commands, *signature, *blob;
+	void *commandsBuf = NULL, *signatureBuf = NULL;
+	uint64_t offset, len;
+	size_t commandsLen, blobLen;
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+	int ret;
+
+	*out = NULL;
+	if ((ret = macho_file_commands(file, slice, &commands, &commandsLen, &commandsBuf)) != 0)
+		return ret;
+	ret = macho_code_signature(commands, commandsLen, slice->size, &offset, &len);
+	free(commandsBuf);
+	if (ret != 0)
+		return ret;
+	if ((ret = macho_file_read(file, slice->offset + offset, (size_t)len, &signature, &signatureBuf)) != 0)
+		return ret;
+
+	bool der = macho_signature_blob(signature, (size_t)len, CSMAGIC_EMBEDDED_DER_ENTITLEMENTS, &blob, &blobLen) == 0;
+	if (der)
+		*out = launchctl_entitlements_from_der(blob, blobLen);
+	if (*out == NULL &&
+	    (ret = macho_signature_blob(signature, (size_t)len, CSMAGIC_EMBEDDED_ENTITLEMENTS, &blob, &blobLen)) == 0)
+		*out = xpc_create_from_plist(blob, blobLen);
+
+	// No XML blob is only "no entitlements" if there was no DER blob either
+	if (*out == NULL && ret == ENOENT && !der) {
+		*out = xpc_dictionary_create(NULL, NULL, 0);
+		ret = 0;
+	} else if (*out == NULL && ret == 0) {
+		ret = EBADMACHO;
+	}
+	free(signatureBuf);
+	LAUNCHCTL_TRACE_END("macho_signature", t, NULL, "\"bytes\":%llu,\"error\":%d", (unsigned long long)len, ret);
+	return ret;
+}
+
+static void
+entitlements_scan_file(struct entitlements_file *ef)
+{
+	struct macho_slice slices[ENTITLEMENTS_MAX_SLICES];
+	struct macho_file file;
+	uint32_t count;
+	int fd;
+
+	if ((fd = open(ef->path, O_RDONLY | O_CLOEXEC)) == -1) {
+		ef->error = errno;
+		return;
+	}
+	if ((ef->error = macho_file_open(&file, fd, MACHO_IO_AUTO)) != 0) {
+		close(fd);
+		return;
+	}
+
+	if ((ef->error = macho_file_slices(&file, slices, ENTITLEMENTS_MAX_SLICES, &count)) == 0) {
+		for (uint32_t i = 0; i < count; i++) {
+			struct entitlements_slice *s = &ef->slices[ef->count];
+			s->arch = macho_arch_name(slices[i].cputype, slices[i].cpusubtype);
+			s->error = entitlements_copy_slice(&file, &slices[i], &s->entitlements);
+			// Fat files can carry slices that are not Mach-O at all; skip those
+			if (s->error != ENOEXEC)
+				ef->count++;
+		}
+		if (ef->count == 0)
+			ef->error = ENOEXEC;
+	}
+
+	macho_file_close(&file);
+	close(fd);
+}
+
+static int
+entitlements_print(const struct entitlements_file *files, size_t nfiles, bool json)
+{
+	char name[PATH_MAX + 64];
+	int ret = 0;
+
+	for (size_t i = 0; i < nfiles; i++) {
+		const struct entitlements_file *ef = &files[i];
+
+		if (ef->error == ENOEXEC) {
+			fprintf(stderr, "%s: File is not a valid Mach-O or fat file.\n", ef->path);
+			ret = ef->error;
+			continue;
+		} else if (ef->error != 0) {
+			fprintf(stderr, "%s: %s\n", ef->path, strerror(ef->error));
+			ret = ef->error;
+			continue;
+		}
+
+		for (uint32_t j = 0; j < ef->count; j++) {
+			const struct entitlements_slice *s = &ef->slices[j];
+
+			if (s->error == ENOENT) {
+				fprintf(stderr, "%s: %s: Mach-O is not signed.\n", ef->path, s->arch);
+				ret = s->error;
+				continue;
+			} else if (s->error != 0) {
+				fprintf(stderr, "%s: %s: Mach-O is invalid: %d: %s\n", ef->path, s->arch, s->error,
+				    strerror(s->error));
+				ret = s->error;
+				continue;
+			}
+
+			if (json) {
+				fputs("{\"path\":", stdout);
+				launchctl_fprint_json_string(stdout, ef->path);
+				fputs(",\"arch\":", stdout);
+				launchctl_fprint_json_string(stdout, s->arch);
+				fputs(",\"entitlements\":", stdout);
+				launchctl_xpc_object_fprint_json(stdout, s->entitlements);
+				fputs("}\n", stdout);
+			} else if (nfiles == 1 && ef->count == 1) {
+				launchctl_xpc_object_print(s->entitlements, NULL, 0);
+			} else {
+				if (ef->count == 1)
+					snprintf(name, sizeof(name), "%s", ef->path);
+				else
+					snprintf(name, sizeof(name), "%s (%s)", ef->path, s->arch);
+				launchctl_xpc_object_print(s->entitlements, name, 0);
+			}
+		}
+	}
+
+	return ret;
+}
+
+int
+entitlements_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+{
+	static const struct option longopts[] = {
+		{ "json", no_argument, NULL, 'J' },
+		{ NULL, 0, NULL, 0 },
+	};
+	struct entitlements_file *files;
+	size_t width = 8;
+	bool json = false;
+	int ch, ret;
+
+	while ((ch = getopt_long(argc, argv, "j:", longopts, NULL)) != -1) {
+		switch (ch) {
+			case 'j':
+				if ((width = strtoul(optarg, NULL, 10)) == 0)
+					return EUSAGE;
+				break;
+			case 'J':
+				json = true;
+				break;
+			default:
+				return EUSAGE;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (argc < 1)
+		return EUSAGE;
+
+	if ((files = calloc(argc, sizeof(*files))) == NULL)
+		return ENOMEM;
+	for (int i = 0; i < argc; i++)
+		files[i].path = argv[i];
+
+	// Results are kept until every file is done so the output follows the order of the arguments
+	launchctl_concurrent_apply(argc, width, ^(size_t i) {
+	    entitlements_scan_file(&files[i]);
+	});
+	ret = entitlements_print(files, argc, json);
+
+	for (int i = 0; i < argc; i++) {
+		for (uint32_t j = 0; j < files[i].count; j++) {
+			if (files[i].slices[j].entitlements != NULL)
+				xpc_release(files[i].slices[j].entitlements);
+		}
+	}
+	free(files);
+	return ret;
+}
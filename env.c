@@ -26,32 +26,267 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <xpc/xpc.h>
 
+#include "dotenv.h"
 #include "launchctl.h"
 #include "xpc_private.h"
 
-int
-setenv_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+// Approximate encoded size above which envvars is split across several requests
+#define SETENV_CHUNK_BYTES (64 * 1024)
+
+static int
+env_read_file(const char *path, char **buf, size_t *len)
+{
+	int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+	size_t cap = 0;
+	ssize_t n;
+	int ret = 0;
+
+	*buf = NULL;
+	*len = 0;
+	if (fd == -1) {
+		ret = errno;
+		fprintf(stderr, "Could not open %s: %d: %s\n", path, ret, strerror(ret));
+		return ret;
+	}
+	do {
+		if (cap - *len < 4096) {
+			char *grown = realloc(*buf, cap = cap * 2 + 4096);
+			if (grown == NULL) {
+				ret = ENOMEM;
+				break;
+			}
+			*buf = grown;
+		}
+		n = read(fd, *buf + *len, cap - *len - 1);
+		if (n == -1 && errno != EINTR) {
+			ret = errno;
+			fprintf(stderr, "Could not read %s: %d: %s\n", path, ret, strerror(ret));
+			break;
+		}
+		if (n > 0)
+			*len += n;
+	} while (n != 0);
+	if (fd != STDIN_FILENO)
+		close(fd);
+	if (ret != 0) {
+		free(*buf);
+		*buf = NULL;
+		return ret;
+	}
+	(*buf)[*len] = '\0';
+	return 0;
+}
+
+struct env_parse_ctx {
+	xpc_object_t env;
+	bool setenv;
+};
+
+// Adds a parsed variable to env: as a string for setenv, as null for unsetenv
+static void
+env_parse_entry(const char *key, const char *value, void *ctx)
+{
+	struct env_parse_ctx *pc = ctx;
+
+	if (pc->setenv) {
+		xpc_dictionary_set_string(pc->env, key, value);
+	} else {
+		xpc_object_t null = xpc_null_create();
+		xpc_dictionary_set_value(pc->env, key, null);
+		xpc_release(null);
+	}
+}
+
+static int
+env_parse(char *buf, size_t len, const char *path, bool setenv, xpc_object_t env)
 {
-	xpc_object_t dict, env, reply;
+	struct env_parse_ctx pc = { env, setenv };
+	struct dotenv_error err;
 	int ret;
-	bool setenv = strcmp(argv[0], "setenv") == 0 ? true : false;
 
-	argc--;
-	argv++;
+	if ((ret = dotenv_parse(buf, len, setenv, env_parse_entry, &pc, &err)) != 0)
+		fprintf(stderr, "%s:%d: %s\n", path, err.line, err.message);
+	return ret;
+}
 
-	if (setenv && argc % 2 != 0)
-		return EUSAGE;
+/*
+ * Removes from env the variables that would not change: those launchd
+ * already has with the same value for setenv, or does not have for
+ * unsetenv. launchd has no call that returns the whole domain environment,
+ * so this asks for each variable, several at a time.
+ */
+static int
+env_drop_unchanged(xpc_object_t env, bool setenv)
+{
+	size_t count = xpc_dictionary_get_count(env);
+	__block size_t n = 0;
+	char **keys;
+	bool *same;
+
+	if (count == 0)
+		return 0;
+	keys = calloc(count, sizeof(*keys));
+	same = calloc(count, sizeof(*same));
+	if (keys == NULL || same == NULL) {
+		free(keys);
+		free(same);
+		return ENOMEM;
+	}
+	(void)xpc_dictionary_apply(env, ^bool(const char *key, xpc_object_t value) {
+	    keys[n] = strdup(key);
+	    return keys[n++] != NULL;
+	});
+	if (n != count) {
+		for (size_t i = 0; i < n; i++)
+			free(keys[i]);
+		free(keys);
+		free(same);
+		return ENOMEM;
+	}
+
+	launchctl_concurrent_apply(count, LAUNCHCTL_REQUEST_WIDTH, ^(size_t i) {
+	    xpc_object_t dict = xpc_dictionary_create(NULL, NULL, 0), reply = NULL;
+	    const char *current = NULL;
+	    int err;
+
+	    launchctl_setup_xpc_dict(dict);
+	    xpc_dictionary_set_string(dict, "envvar", keys[i]);
+	    err = launchctl_send_xpc_to_launchd(XPC_ROUTINE_GETENV, dict, &reply);
+	    if (err == 0)
+		    current = xpc_dictionary_get_string(reply, "value");
+	    if (setenv)
+		    same[i] = current != NULL && strcmp(current, xpc_dictionary_get_string(env, keys[i])) == 0;
+	    else
+		    same[i] = err == ENOENT || (err == 0 && current == NULL);
+	    if (reply != NULL)
+		    xpc_release(reply);
+	    xpc_release(dict);
+	});
+
+	for (size_t i = 0; i < count; i++) {
+		if (same[i])
+			xpc_dictionary_set_value(env, keys[i], NULL);
+		free(keys[i]);
+	}
+	free(keys);
+	free(same);
+	return 0;
+}
+
+static int
+env_send_chunk(xpc_object_t envvars)
+{
+	xpc_object_t dict, reply = NULL;
+	int ret;
+
+	dict = xpc_dictionary_create(NULL, NULL, 0);
+	launchctl_setup_xpc_dict(dict);
+	xpc_dictionary_set_value(dict, "envvars", envvars);
+	ret = launchctl_send_xpc_to_launchd(XPC_ROUTINE_SETENV, dict, &reply);
+	if (reply != NULL)
+		xpc_release(reply);
+	xpc_release(dict);
+	return ret;
+}
+
+/*
+ * Sends env in as few XPC_ROUTINE_SETENV requests as possible, starting a
+ * new one only when the next variable would take the request over
+ * SETENV_CHUNK_BYTES. Sizes are estimated the way stats.c does. Requests are
+ * not atomic as a group: when one fails, those before it have already been
+ * applied, and *applied and *failed say how many variables that was and
+ * which request (from 1) failed.
+ */
+static int
+env_send(xpc_object_t env, size_t *applied, size_t *failed)
+{
+	__block xpc_object_t chunk = xpc_dictionary_create(NULL, NULL, 0);
+	__block size_t size = 8, sent = 0, nchunks = 0;
+	__block int ret = 0;
+
+	(void)xpc_dictionary_apply(env, ^bool(const char *key, xpc_object_t value) {
+	    size_t entry = strlen(key) + 1 + 8;
+	    if (xpc_get_type(value) == XPC_TYPE_STRING)
+		    entry = strlen(key) + 1 + 4 + xpc_string_get_length(value) + 1;
+	    if (xpc_dictionary_get_count(chunk) > 0 && size + entry > SETENV_CHUNK_BYTES) {
+		    nchunks++;
+		    if ((ret = env_send_chunk(chunk)) != 0)
+			    return false;
+		    sent += xpc_dictionary_get_count(chunk);
+		    xpc_release(chunk);
+		    chunk = xpc_dictionary_create(NULL, NULL, 0);
+		    size = 8;
+	    }
+	    xpc_dictionary_set_value(chunk, key, value);
+	    size += entry;
+	    return true;
+	});
+	if (ret == 0 && xpc_dictionary_get_count(chunk) > 0) {
+		nchunks++;
+		if ((ret = env_send_chunk(chunk)) == 0)
+			sent += xpc_dictionary_get_count(chunk);
+	}
+	xpc_release(chunk);
+	*applied = sent;
+	*failed = ret != 0 ? nchunks : 0;
+	return ret;
+}
+
+int
+setenv_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+{
+	static const struct option longopts[] = {
+		{ "from-file", required_argument, NULL, 'f' },
+		{ "diff", no_argument, NULL, 'd' },
+		{ NULL, 0, NULL, 0 },
+	};
+	xpc_object_t dict, env;
+	bool setenv = strcmp(argv[0], "setenv") == 0 ? true : false;
+	bool diff = false;
+	char *buf;
+	size_t len, applied, failed;
+	int ret = 0, ch;
 
 	dict = xpc_dictionary_create(NULL, NULL, 0);
 	launchctl_setup_xpc_dict(dict);
 	*msg = dict;
 	env = xpc_dictionary_create(NULL, NULL, 0);
-	xpc_dictionary_set_value(dict, "envvars", env);
+
+	// Stop at the first key so that values beginning with '-' are left alone; keys that do need "--" first
+	while ((ch = getopt_long(argc, argv, "+", longopts, NULL)) != -1) {
+		switch (ch) {
+			case 'f':
+				if ((ret = env_read_file(optarg, &buf, &len)) == 0) {
+					ret = env_parse(buf, len, strcmp(optarg, "-") == 0 ? "<stdin>" : optarg, setenv, env);
+					free(buf);
+				}
+				break;
+			case 'd':
+				diff = true;
+				break;
+			default:
+				ret = EUSAGE;
+				break;
+		}
+		if (ret != 0)
+			goto done;
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (setenv && argc % 2 != 0) {
+		ret = EUSAGE;
+		goto done;
+	}
 
 	for (int i = 0; i < argc; i++) {
 		if (setenv) {
@@ -64,15 +299,29 @@ setenv_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 		}
 	}
 
-	ret = launchctl_send_xpc_to_launchd(XPC_ROUTINE_SETENV, dict, &reply);
+	// Nothing on the command line or in the files; launchd would only have been sent an empty request
+	if (xpc_dictionary_get_count(env) == 0) {
+		ret = EUSAGE;
+		goto done;
+	}
+
+	if (diff && (ret = env_drop_unchanged(env, setenv)) != 0)
+		goto done;
+
+	ret = env_send(env, &applied, &failed);
 	if (ret != 0) {
 		if (ret == EPERM)
 			fprintf(stderr, "Not privileged to set domain environment.\n");
 		else {
 			fprintf(stderr, "Could not set environment: %d: %s\n", ret, xpc_strerror(ret));
 		}
+		if (applied > 0)
+			fprintf(stderr, "Request %zu failed; %zu of %zu variables were already applied by earlier requests.\n",
+			    failed, applied, xpc_dictionary_get_count(env));
 	}
 
+done:
+	xpc_release(env);
 	return ret;
 }
 
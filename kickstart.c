@@ -30,21 +30,174 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
+#include "trace.h"
 #include "xpc_private.h"
 
+struct kickstart_result {
+	int error;
+	int64_t oldpid; // The pid before a restart, which the service has to leave behind
+	int64_t pid;
+	uint64_t kicked; // When the request was sent, from launchctl_trace_now()
+	uint64_t running; // When the service was first seen running, or 0
+	int64_t replaced; // A pid seen after running during --settle, or 0
+};
+
+/*
+ * Sends the kickstart requests for entries [start, start + count) of list
+ * concurrently, with the options set in opts.
+ */
+static void
+kickstart_kick(xpc_object_t list, size_t start, size_t count, xpc_object_t opts, struct kickstart_result *results)
+{
+	launchctl_concurrent_apply(count, LAUNCHCTL_REQUEST_WIDTH, ^(size_t n) {
+	    size_t i = start + n;
+	    xpc_object_t dict = launchctl_target_request(xpc_array_get_value(list, i)), reply = NULL;
+	    if (xpc_dictionary_get_bool(opts, "kill"))
+		    xpc_dictionary_set_bool(dict, "kill", true);
+	    if (xpc_dictionary_get_bool(opts, "suspended"))
+		    xpc_dictionary_set_bool(dict, "suspended", true);
+	    if (xpc_dictionary_get_bool(opts, "unthrottle"))
+		    xpc_dictionary_set_bool(dict, "unthrottle", true);
+	    results[i].kicked = launchctl_trace_now();
+	    results[i].error = launchctl_send_xpc_to_launchd(XPC_ROUTINE_KICKSTART_SERVICE, dict, &reply);
+	    if (results[i].error == 0)
+		    results[i].pid = xpc_dictionary_get_int64(reply, "pid");
+	    if (reply != NULL)
+		    xpc_release(reply);
+	    xpc_release(dict);
+	});
+}
+
+/*
+ * Waits for entries [start, start + count) to run. A service counts as
+ * running once it is listed with the pid launchd gave it, or with any pid
+ * other than its old one if launchd did not say.
+ */
+static void
+kickstart_wait(xpc_object_t list, size_t start, size_t count, struct kickstart_result *results, double timeout)
+{
+	(void)launchctl_wait_services(list, start, count, timeout, ^bool(size_t i, int64_t pid) {
+	    struct kickstart_result *r = &results[i];
+	    if (r->error != 0 && r->error != EALREADY)
+		    return true;
+	    if (pid > 0 && pid != r->oldpid && (r->pid <= 0 || pid == r->pid)) {
+		    r->pid = pid;
+		    r->running = launchctl_trace_now();
+		    return true;
+	    }
+	    return false;
+	});
+}
+
+// Sleeps for seconds, resuming after a signal handler returns
+static void
+kickstart_sleep(double seconds)
+{
+	struct timespec ts = { (time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9) };
+	while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+		;
+}
+
+/*
+ * Polls the pids of entries [start, start + count) every half second for
+ * settle seconds, recording in replaced the first pid other than the one a
+ * service came up with. Stops early once a service has been replaced, since
+ * that fails the wave. Returns whether every service kept its pid.
+ */
+static bool
+kickstart_settle(xpc_object_t list, size_t start, size_t count, struct kickstart_result *results, int64_t *pids,
+    double settle)
+{
+	bool held = true;
+
+	for (double left = settle; left > 0 && held; left -= 0.5) {
+		kickstart_sleep(left < 0.5 ? left : 0.5);
+		launchctl_copy_service_pids(list, start, count, pids);
+		for (size_t i = start; i < start + count; i++) {
+			struct kickstart_result *r = &results[i];
+			if (r->running != 0 && r->replaced == 0 && pids[i] != LAUNCHCTL_PID_UNKNOWN && pids[i] != r->pid) {
+				r->replaced = pids[i];
+				held = false;
+			}
+		}
+	}
+	return held;
+}
+
+/*
+ * Kickstarts every service the targets expand to, concurrently, with the
+ * options set in opts, then optionally waits for them to run. One line per
+ * service is printed at the end.
+ */
+static int
+kickstart_targets(int count, char **targets, xpc_object_t opts, double timeout)
+{
+	struct launchctl_results res = {};
+	struct kickstart_result *results;
+	xpc_object_t list;
+	size_t n;
+	int ret;
+
+	if ((ret = launchctl_expand_service_targets(count, targets, &list)) != 0)
+		return ret;
+	if ((n = xpc_array_get_count(list)) == 0) {
+		xpc_release(list);
+		return ENOSERVICE;
+	}
+	if ((results = calloc(n, sizeof(*results))) == NULL) {
+		xpc_release(list);
+		return ENOMEM;
+	}
+
+	kickstart_kick(list, 0, n, opts, results);
+	if (timeout > 0)
+		kickstart_wait(list, 0, n, results, timeout);
+
+	for (size_t i = 0; i < n; i++) {
+		const char *target = xpc_dictionary_get_string(xpc_array_get_value(list, i), "target");
+		struct kickstart_result *r = &results[i];
+
+		if (r->error == EALREADY && timeout <= 0)
+			launchctl_result_ok(&res, target, "already running");
+		else if (r->error != 0 && r->error != EALREADY)
+			launchctl_result_fail(&res, target, r->error, "%d: %s", r->error, xpc_strerror(r->error));
+		else if (timeout <= 0)
+			launchctl_result_ok(&res, target, "spawned with pid %" PRId64, r->pid);
+		else if (r->running != 0)
+			launchctl_result_ok(&res, target, "running with pid %" PRId64 " after %.1f ms", r->pid,
+			    (r->running - r->kicked) / 1e6);
+		else
+			launchctl_result_fail(&res, target, ETIMEDOUT, "not running after %g s", timeout);
+	}
+	ret = launchctl_results_finish(&res, n, timeout > 0 ? "Running:" : "Kickstarted", NULL);
+
+	free(results);
+	xpc_release(list);
+	return ret;
+}
+
 int
 kickstart_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 {
 	if (argc < 2)
 		return EUSAGE;
 
+	static const struct option longopts[] = {
+		{ "wait", required_argument, NULL, 'w' },
+		{ NULL, 0, NULL, 0 },
+	};
 	xpc_object_t dict, reply;
 	bool printpid = false;
 	const char *name = NULL;
+	double timeout = 0;
+	char *end;
 	int err;
 	int64_t pid;
 
@@ -52,7 +205,7 @@ kickstart_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **appl
 	*msg = dict;
 
 	int ch;
-	while ((ch = getopt(argc, argv, "pks")) != -1) {
+	while ((ch = getopt_long(argc, argv, "pksuw:", longopts, NULL)) != -1) {
 		switch (ch) {
 			case 'k':
 				xpc_dictionary_set_bool(dict, "kill", true);
@@ -66,12 +219,22 @@ kickstart_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **appl
 			case 'p':
 				printpid = true;
 				break;
+			case 'w':
+				timeout = strtod(optarg, &end);
+				if (*end != '\0' || timeout <= 0)
+					return EUSAGE;
+				break;
+			default:
+				return EUSAGE;
 		}
 	}
 
 	if (argc <= optind)
 		return EUSAGE;
 
+	if (argc - optind > 1 || timeout > 0 || strpbrk(argv[optind], "*?[") != NULL)
+		return kickstart_targets(argc - optind, argv + optind, dict, timeout);
+
 	if ((err = launchctl_setup_xpc_dict_for_service_name(argv[optind], dict, &name)) != 0)
 		return err;
 	if (name == NULL)
@@ -96,3 +259,127 @@ kickstart_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **appl
 
 	return err;
 }
+
+/*
+ * Restarts services with kickstart -k. With --rolling they go in waves of
+ * --max-parallel (default 1); each wave must come back with new pids within
+ * --timeout seconds (default 30) and keep them for --settle seconds before
+ * the next wave starts, otherwise the restart stops there. Pids are checked
+ * every half second during --settle rather than once at its end.
+ */
+int
+restart_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+{
+	static const struct option longopts[] = {
+		{ "rolling", no_argument, NULL, 'r' },
+		{ "max-parallel", required_argument, NULL, 'n' },
+		{ "settle", required_argument, NULL, 's' },
+		{ "timeout", required_argument, NULL, 't' },
+		{ NULL, 0, NULL, 0 },
+	};
+	struct launchctl_results res = {};
+	struct kickstart_result *results;
+	xpc_object_t opts, list;
+	double settle = 0, timeout = 30;
+	size_t n, width = 1, waves = 0;
+	char detail[64];
+	bool rolling = false, parallel = false;
+	int64_t *pids;
+	char *end;
+	int ch, ret;
+
+	opts = xpc_dictionary_create(NULL, NULL, 0);
+	*msg = opts;
+	xpc_dictionary_set_bool(opts, "kill", true);
+
+	while ((ch = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+		switch (ch) {
+			case 'r':
+				rolling = true;
+				break;
+			case 'n':
+				width = strtoul(optarg, &end, 10);
+				if (*end != '\0' || width == 0)
+					return EUSAGE;
+				parallel = true;
+				break;
+			case 's':
+				settle = strtod(optarg, &end);
+				if (*end != '\0' || settle < 0)
+					return EUSAGE;
+				break;
+			case 't':
+				timeout = strtod(optarg, &end);
+				if (*end != '\0' || timeout <= 0)
+					return EUSAGE;
+				break;
+			default:
+				return EUSAGE;
+		}
+	}
+	// Without --rolling every service is restarted at once, so a limit would be ignored
+	if (argc <= optind || (parallel && !rolling))
+		return EUSAGE;
+
+	if ((ret = launchctl_expand_service_targets(argc - optind, argv + optind, &list)) != 0)
+		return ret;
+	if ((n = xpc_array_get_count(list)) == 0) {
+		xpc_release(list);
+		return ENOSERVICE;
+	}
+	results = calloc(n, sizeof(*results));
+	pids = calloc(n, sizeof(int64_t));
+	if (results == NULL || pids == NULL) {
+		free(results);
+		free(pids);
+		xpc_release(list);
+		return ENOMEM;
+	}
+	if (!rolling)
+		width = n;
+
+	for (size_t start = 0; start < n && ret == 0; start += width) {
+		size_t count = n - start < width ? n - start : width;
+
+		waves++;
+		launchctl_copy_service_pids(list, start, count, pids);
+		for (size_t i = start; i < start + count; i++)
+			results[i].oldpid = pids[i];
+		kickstart_kick(list, start, count, opts, results);
+		kickstart_wait(list, start, count, results, timeout);
+
+		// A service that crashed or was replaced during the settle period no longer has the pid it came up with
+		if (settle > 0)
+			(void)kickstart_settle(list, start, count, results, pids, settle);
+
+		for (size_t i = start; i < start + count; i++) {
+			const char *target = xpc_dictionary_get_string(xpc_array_get_value(list, i), "target");
+			struct kickstart_result *r = &results[i];
+
+			if (r->error != 0 && r->error != EALREADY)
+				launchctl_result_fail(&res, target, r->error, "%d: %s", r->error, xpc_strerror(r->error));
+			else if (r->running == 0)
+				launchctl_result_fail(&res, target, ETIMEDOUT, "no new pid after %g s", timeout);
+			else if (r->replaced != 0)
+				launchctl_result_fail(&res, target, ESRCH, "pid %" PRId64 " did not last %g s", r->pid, settle);
+			else if (r->oldpid == LAUNCHCTL_PID_UNKNOWN)
+				launchctl_result_ok(&res, target, "restarted, pid %" PRId64 " after %.1f ms", r->pid,
+				    (r->running - r->kicked) / 1e6);
+			else
+				launchctl_result_ok(&res, target, "restarted, pid %" PRId64 " -> %" PRId64 " after %.1f ms",
+				    r->oldpid, r->pid, (r->running - r->kicked) / 1e6);
+		}
+		ret = res.error;
+		fflush(stdout);
+	}
+
+	if (ret != 0 && waves * width < n)
+		printf("Stopped after wave %zu; %zu services were not restarted.\n", waves, n - waves * width);
+	snprintf(detail, sizeof(detail), "in %zu %s", waves, waves == 1 ? "wave" : "waves");
+	ret = launchctl_results_finish(&res, n, "Restarted", detail);
+
+	free(results);
+	free(pids);
+	xpc_release(list);
+	return ret;
+}
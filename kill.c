@@ -36,6 +36,62 @@
 #include "launchctl.h"
 #include "xpc_private.h"
 
+static const char *
+kill_strerror(int err)
+{
+	if (err == EPERM)
+		return "Not privileged to signal service";
+	else if (err == ESRCH)
+		return "No process to signal";
+	return xpc_strerror(err);
+}
+
+/*
+ * Signals every service the targets expand to, concurrently, and prints
+ * one line per service once all of them have answered.
+ */
+static int
+kill_targets(int count, char **targets, int sig)
+{
+	struct launchctl_results res = {};
+	xpc_object_t list;
+	size_t n;
+	int ret, *errors;
+
+	if ((ret = launchctl_expand_service_targets(count, targets, &list)) != 0)
+		return ret;
+	if ((n = xpc_array_get_count(list)) == 0) {
+		xpc_release(list);
+		return ENOSERVICE;
+	}
+	if ((errors = calloc(n, sizeof(int))) == NULL) {
+		xpc_release(list);
+		return ENOMEM;
+	}
+
+	launchctl_concurrent_apply(n, LAUNCHCTL_REQUEST_WIDTH, ^(size_t i) {
+	    xpc_object_t dict = launchctl_target_request(xpc_array_get_value(list, i)), reply = NULL;
+	    xpc_dictionary_set_int64(dict, "signal", sig);
+	    errors[i] = launchctl_send_xpc_to_launchd(XPC_ROUTINE_SERVICE_KILL, dict, &reply);
+	    if (reply != NULL)
+		    xpc_release(reply);
+	    xpc_release(dict);
+	});
+
+	for (size_t i = 0; i < n; i++) {
+		const char *target = xpc_dictionary_get_string(xpc_array_get_value(list, i), "target");
+		if (errors[i] == 0)
+			launchctl_result_ok(&res, target, "signaled");
+		else
+			launchctl_result_fail(&res, target, errors[i], "%d: %s", errors[i], kill_strerror(errors[i]));
+	}
+	ret = launchctl_results_finish(&res, n, "Signaled", NULL);
+
+	free(errors);
+	xpc_release(list);
+	return ret;
+}
+
 int
 kill_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 {
@@ -74,6 +130,9 @@ cont:
 	dict = xpc_dictionary_create(NULL, NULL, 0);
 	*msg = dict;
 
+	if (argc > 3 || strpbrk(argv[2], "*?[") != NULL)
+		return kill_targets(argc - 2, argv + 2, sig);
+
 	if ((err = launchctl_setup_xpc_dict_for_service_name(argv[2], dict, &name)) != 0)
 		return err;
 
@@ -84,10 +143,8 @@ cont:
 	xpc_dictionary_set_string(dict, "name", name);
 	err = launchctl_send_xpc_to_launchd(XPC_ROUTINE_SERVICE_KILL, dict, &reply);
 
-	if (err == EPERM)
-		fprintf(stderr, "Not privileged to signal service.\n");
-	else if (err == ESRCH)
-		fprintf(stderr, "No process to signal.\n");
+	if (err == EPERM || err == ESRCH)
+		fprintf(stderr, "%s.\n", kill_strerror(err));
 
 	return err;
 }
@@ -42,6 +42,7 @@
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
+#include "trace.h"
 #include "xpc_private.h"
 
 __SCCSID("@(#)PROGRAM:launchctl  PROJECT:ProcursusTeam/launchctl  VERSION:1.2.0");
@@ -59,23 +60,25 @@ static const struct {
 } cmds[] = {
 	{ "bootstrap", "Bootstraps a domain or a service into a domain.", "<domain-target> [service-path, service-path2, ...]", bootstrap_cmd },
 	{ "bootout", "Tears down a domain or removes a service from a domain.", "<domain-target> [service-path1, service-path2, ...] | <service-target>", bootout_cmd },
-	{ "enable", "Enables an existing service.", "<service-target>", enable_cmd },
-	{ "disable", "Disables an existing service.", "<service-target>", enable_cmd },
+	{ "enable", "Enables an existing service.", "[--from-file <path>] <service-target> ...", enable_cmd },
+	{ "disable", "Disables an existing service.", "[--from-file <path>] <service-target> ...", enable_cmd },
 	{ "uncache", "Removes the specified service name from the service cache.", "<service-name>", uncache_cmd },
-	{ "kickstart", "Forces an existing service to start.", "[-k] [-p] <service-target>", kickstart_cmd },
+	{ "kickstart", "Forces an existing service to start.", "[-k] [-p] [-s] [-u] [-w <timeout>] <service-target> ...", kickstart_cmd },
+	{ "restart", "Restarts services, optionally a few at a time.", "[--rolling] [--max-parallel <n>] [--settle <seconds>] [--timeout <seconds>] <service-target> ...", restart_cmd },
 	{ "attach", "Attach the system's debugger to a service.", "[-k] [-s] [-x] <service-target>", attach_cmd },
 	{ "debug", "Configures the next invocation of a service for debugging.", "<service-target> [--program <program-path>] [--start-suspended] [oc-stack-logging] [--malloc-nano-allocator] [--debug-libraries] [--NSZombie] [--32] [--stdin [path]] [--stdout [path]] [--stderr [path]] [--environment VARIABLE0=value0 VARIABLE1=value1 ...] -- [argv0 argv1 ...]", todo_cmd },
-	{ "kill", "Sends a signal to the service instance.", "<signal-number|signal-name> <service-target>", kill_cmd },
+	{ "kill", "Sends a signal to the service instance.", "<signal-number|signal-name> <service-target> ...", kill_cmd },
 	{ "blame", "Prints the reason a service is running.", "<service-target>", blame_cmd },
 	{ "print", "Prints a description of a domain or service.", "<domain-target> | <service-target>", print_cmd },
 	{ "print-cache", "Prints information about the service cache.", NULL, print_cache_cmd },
 	{ "print-disabled", "Prints which services are disabled.", NULL, print_disabled_cmd },
-	{ "plist", "Prints a property list embedded in a binary (targets the Info.plist by default).", "[segment,section] <path>", plist_cmd },
-	{ "procinfo", "Prints port information about a process.", "<pid>", procinfo_cmd },
+	{ "plist", "Prints a property list embedded in a binary (targets the Info.plist by default).", "[--arch <name> | --all-arches] [--io auto|mmap|pread] [-s segment,section]... [segment,section] <path> | -r [-j jobs] [--arch <name> | --all-arches] [--io auto|mmap|pread] [-s segment,section]... <dir>...", plist_cmd },
+	{ "entitlements", "Prints the entitlements in the code signature of binaries.", "[-j jobs] [--json] <path> [path2, ...]", entitlements_cmd },
+	{ "procinfo", "Prints port information about a process.", "<pid> [pid2, ...] | --all | --service <target> [--jobs <n>]", procinfo_cmd },
 	{ "hostinfo", "Prints port information about the host.", NULL, hostinfo_cmd },
 	{ "resolveport", "Resolves a port name from a process to an endpoint in launchd.", "<owner-pid> <port-name>", resolveport_cmd },
 	{ "limit", "Reads or modifies launchd's resource limits.", "[<limit-name> [<both-limits> | <soft-limit> <hard-limit>]", limit_cmd },
-	{ "runstats", "Prints performance statistics for a service.", "<service-target>", runstats_cmd },
+	{ "runstats", "Prints performance statistics for a service.", "[--summary] <service-target> [service-target2, ...] | --all [--format csv|columnar] [--output <path>] [--jobs <n>] <domain-target> | --collect <interval> --ring <path> [--slots <n>] <service-target|domain-target> ...", runstats_cmd },
 	{ "examine", "Runs the specified analysis tool against launchd in a non-reentrant manner.", "[<tool> [arg0, arg1, ... , @PID, ...]]", examine_cmd },
 	{ "config", "Modifies persistent configuration parameters for launchd domains.", NULL, config_cmd },
 	{ "dumpstate", "Dumps launchd state to stdout.", NULL, dumpstate_cmd },
@@ -89,10 +92,10 @@ static const struct {
 	{ "unload", "Unloads a service or directory of services.", "<service-path, service-path2, ...>", load_cmd },
 	{ "remove", "Unloads the specified service name.", "<service-name>", remove_cmd },
 	{ "list", "Lists information about services.", "[service-name]", list_cmd },
-	{ "start", "Starts the specified service.", "<service-name>", start_cmd },
-	{ "stop", "Stops the specified service if it is running.", "<service-name>", stop_cmd },
-	{ "setenv", "Sets the specified environment variables for all services within the domain.", "<<key> <value>, ...>", setenv_cmd },
-	{ "unsetenv", "Unsets the specified environment variables for all services within the domain.", "<key, ...>", setenv_cmd },
+	{ "start", "Starts the specified service.", "[-w <timeout>] <service-name> ...", start_cmd },
+	{ "stop", "Stops the specified service if it is running.", "[-w <timeout>] <service-name> ...", stop_cmd },
+	{ "setenv", "Sets the specified environment variables for all services within the domain.", "[--diff] [--from-file <path>] [--] [<key> <value> ...]", setenv_cmd },
+	{ "unsetenv", "Unsets the specified environment variables for all services within the domain.", "[--diff] [--from-file <path>] [--] [<key> ...]", setenv_cmd },
 	{ "getenv", "Gets the value of an environment variable from within launchd.", "<key>", getenv_cmd },
 	{ "bsexec", "Execute a program in another process' bootstrap context.", "<pid> <program> [...]", todo_cmd },
 	{ "asuser", "Execute a program in the bootstrap context of a given user.", "<uid> <program> [...]", todo_cmd },
@@ -112,6 +115,12 @@ main(int argc, char **argv, char **envp, char **apple)
 {
 	xpc_object_t msg;
 	const char *name = NULL;
+	if (argc > 1 && strcmp(argv[1], "--stats") == 0) {
+		launchctl_stats_start();
+		argv[1] = argv[0];
+		argc--;
+		argv++;
+	}
 	if (argc <= 1) {
 		help_cmd(NULL, argc - 1, argv + 1, envp, apple);
 		return 0;
@@ -121,7 +130,10 @@ main(int argc, char **argv, char **envp, char **apple)
 	int n = sizeof(cmds) / sizeof(cmds[0]);
 	for (int i = 0; i < n; i++) {
 		if (strcmp(argv[1], cmds[i].name) == 0) {
+			launchctl_trace_open(getprogname());
+			uint64_t t = LAUNCHCTL_TRACE_BEGIN();
 			ret = (cmds[i].exec)(&msg, argc - 1, argv + 1, envp, apple);
+			LAUNCHCTL_TRACE_END(cmds[i].name, t, NULL, "\"error\":%d", ret);
 			goto finish;
 		}
 	}
@@ -176,7 +188,7 @@ help_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 		fprintf(stderr, "help <subcommand>\n");
 		return 64;
 	}
-	printf("Usage: %s <subcommand> ... | help [subcommand]\n"
+	printf("Usage: %s [--stats] <subcommand> ... | help [subcommand]\n"
 	       "Many subcommands take a target specifier that refers to a domain or service\n"
 	       "within that domain. The available specifier forms are:\n"
 	       "\n"
@@ -26,6 +26,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <mach/mach.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <xpc/xpc.h>
@@ -87,6 +88,7 @@ cmd_main remove_cmd;
 
 // kickstart.c
 cmd_main kickstart_cmd;
+cmd_main restart_cmd;
 
 // kill.c
 cmd_main kill_cmd;
@@ -117,6 +119,9 @@ cmd_main limit_cmd;
 // dumpjpcategory.c
 cmd_main dumpjpcategory_cmd;
 
+// entitlements.c
+cmd_main entitlements_cmd;
+
 // procinfo.c
 cmd_main procinfo_cmd;
 cmd_main hostinfo_cmd;
@@ -124,11 +129,24 @@ cmd_main hostinfo_cmd;
 // resolveport.c
 cmd_main resolveport_cmd;
 
+// resolve_cache.c
+bool launchctl_resolve_cache_lookup(const char *name, uint64_t *type);
+void launchctl_resolve_cache_store(const char *name, uint64_t type);
+uint64_t launchctl_foreground_uid(void);
+
+// stats.c
+extern bool launchctl_stats_enabled;
+void launchctl_stats_start(void);
+void launchctl_stats_record(uint64_t routine, xpc_object_t msg, xpc_object_t reply, int error, uint64_t ns);
+
 // rem.c
 cmd_main enter_rem_cmd;
 cmd_main enter_rem_dev_cmd;
 
 void launchctl_xpc_object_print(xpc_object_t, const char *name, int level);
+void launchctl_xpc_object_fprint(FILE *out, xpc_object_t, const char *name, int level);
+void launchctl_xpc_object_fprint_json(FILE *out, xpc_object_t);
+void launchctl_fprint_json_string(FILE *out, const char *str);
 int launchctl_send_xpc_to_launchd(uint64_t routine, xpc_object_t msg, xpc_object_t *reply);
 void launchctl_setup_xpc_dict(xpc_object_t dict);
 int launchctl_setup_xpc_dict_for_service_name(char *servicetarget, xpc_object_t dict, const char **name);
@@ -137,4 +155,28 @@ xpc_object_t launchctl_parse_load_unload(unsigned int domain, int count, char **
 vm_address_t launchctl_create_shmem(xpc_object_t, vm_size_t);
 void launchctl_print_shmem(xpc_object_t dict, vm_address_t addr, vm_size_t sz, FILE *outfd);
 xpc_object_t launchctl_xpc_from_plist(const char *path);
+void launchctl_concurrent_apply(size_t count, size_t width, void (^work)(size_t index));
+int launchctl_copy_service_list(xpc_object_t domain, xpc_object_t *services);
+int launchctl_expand_service_targets(int count, char **targets, xpc_object_t *out);
+int launchctl_expand_glob(xpc_object_t domain, const char *prefix, const char *pattern, xpc_object_t snapshots,
+    xpc_object_t out);
+xpc_object_t launchctl_target_request(xpc_object_t target);
+// Written by launchctl_copy_service_pids() when the domain could not be listed
+#define LAUNCHCTL_PID_UNKNOWN (-1)
+void launchctl_copy_service_pids(xpc_object_t list, size_t start, size_t count, int64_t *pids);
+size_t launchctl_wait_services(xpc_object_t list, size_t start, size_t count, double timeout,
+    bool (^done)(size_t index, int64_t pid));
+
+// Requests in flight at once when a command sends one request per service
+#define LAUNCHCTL_REQUEST_WIDTH 16
+
+struct launchctl_results {
+	size_t ok; // Services reported with launchctl_result_ok()
+	int error; // The first error passed to launchctl_result_fail()
+};
+void launchctl_result_ok(struct launchctl_results *res, const char *target, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+void launchctl_result_fail(struct launchctl_results *res, const char *target, int err, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+int launchctl_results_finish(const struct launchctl_results *res, size_t total, const char *verb, const char *detail);
 #endif
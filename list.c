@@ -30,6 +30,7 @@
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
+#include "trace.h"
 #include "xpc_private.h"
 
 int
@@ -54,6 +55,7 @@ list_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 		xpc_object_t services = xpc_dictionary_get_value(reply, "services");
 		if (services == NULL)
 			return EBADRESP;
+		uint64_t t = LAUNCHCTL_TRACE_BEGIN();
 		printf("PID\tStatus\tLabel\n");
 		(void)xpc_dictionary_apply(services, ^bool(const char *key, xpc_object_t value) {
 		    int64_t pid = xpc_dictionary_get_int64(value, "pid");
@@ -70,6 +72,7 @@ list_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 			    printf("-%d\t%s\n", WTERMSIG(status), key);
 		    return true;
 		});
+		LAUNCHCTL_TRACE_END("render", t, "list", "\"services\":%zu", xpc_dictionary_get_count(services));
 	} else {
 		xpc_object_t service = xpc_dictionary_get_dictionary(reply, "service");
 		if (service == NULL)
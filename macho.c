@@ -0,0 +1,402 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "macho.h"
+
+/*
+ * Records a raw section or section_64 from a segment command. Only the
+ * fields the index keeps are read, straight from the (unaligned) record.
+ */
+static int
+macho_index_add(struct macho_index *idx, const uint8_t *raw, bool is64)
+{
+	if (idx->nsections == MACHO_MAX_SECTIONS)
+		return EBADMACHO;
+
+	// Names are 16 bytes and only NUL-terminated when shorter than that.
+	struct macho_section *s = &idx->sections[idx->nsections++];
+	memcpy(s->sectname, raw + offsetof(struct section, sectname), 16);
+	s->sectname[16] = '\0';
+	memcpy(s->segname, raw + offsetof(struct section, segname), 16);
+	s->segname[16] = '\0';
+
+	if (is64) {
+		uint32_t offset;
+		memcpy(&s->size, raw + offsetof(struct section_64, size), sizeof(s->size));
+		memcpy(&offset, raw + offsetof(struct section_64, offset), sizeof(offset));
+		memcpy(&s->flags, raw + offsetof(struct section_64, flags), sizeof(s->flags));
+		s->offset = offset;
+	} else {
+		uint32_t offset, size;
+		memcpy(&size, raw + offsetof(struct section, size), sizeof(size));
+		memcpy(&offset, raw + offsetof(struct section, offset), sizeof(offset));
+		memcpy(&s->flags, raw + offsetof(struct section, flags), sizeof(s->flags));
+		s->size = size;
+		s->offset = offset;
+	}
+	return 0;
+}
+
+static int
+macho_index_segment(struct macho_index *idx, const struct macho_load_command *lc, bool is64)
+{
+	size_t segsize = is64 ? sizeof(struct segment_command_64) : sizeof(struct segment_command);
+	size_t sectsize = is64 ? sizeof(struct section_64) : sizeof(struct section);
+	size_t nsectsoff = is64 ? offsetof(struct segment_command_64, nsects) : offsetof(struct segment_command, nsects);
+	uint32_t nsects;
+	int ret;
+
+	if (lc->cmdsize < segsize)
+		return EBADMACHO;
+	memcpy(&nsects, lc->data + nsectsoff, sizeof(nsects));
+	if (nsects > (lc->cmdsize - segsize) / sectsize)
+		return EBADMACHO;
+
+	for (uint32_t i = 0; i < nsects; i++) {
+		if ((ret = macho_index_add(idx, lc->data + segsize + i * sectsize, is64)) != 0)
+			return ret;
+	}
+	return 0;
+}
+
+// Fat headers are big-endian on every host.
+static uint32_t
+macho_read_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint64_t
+macho_read_be64(const uint8_t *p)
+{
+	return (uint64_t)macho_read_be32(p) << 32 | macho_read_be32(p + 4);
+}
+
+/*
+ * Reads the slice table from the first avail bytes of a file of filesize
+ * bytes; avail only has to cover the headers.
+ */
+int
+macho_slices_header(const void *header, size_t avail, uint64_t filesize, struct macho_slice *slices, uint32_t max,
+    uint32_t *count)
+{
+	const uint8_t *base = header;
+	size_t size = avail;
+	uint32_t magic, nfat;
+	size_t archSize;
+
+	*count = 0;
+	if (size < sizeof(magic))
+		return ENOEXEC;
+	memcpy(&magic, base, sizeof(magic));
+
+	if (magic == MH_MAGIC || magic == MH_MAGIC_64) {
+		// The 32-bit header is a prefix of the 64-bit one
+		struct mach_header mh;
+		if (size < sizeof(mh))
+			return EBADMACHO;
+		memcpy(&mh, base, sizeof(mh));
+		if (max > 0) {
+			slices[0] = (struct macho_slice) { mh.cputype, mh.cpusubtype, 0, filesize };
+			*count = 1;
+		}
+		return 0;
+	}
+
+	magic = macho_read_be32(base);
+	if (magic != FAT_MAGIC && magic != FAT_MAGIC_64)
+		return ENOEXEC;
+	if (size < sizeof(struct fat_header))
+		return EBADMACHO;
+
+	// Java class files share FAT_MAGIC; their version puts nfat_arch at 45 or above
+	nfat = macho_read_be32(base + 4);
+	if (nfat == 0 || nfat >= 45)
+		return ENOEXEC;
+
+	archSize = magic == FAT_MAGIC ? sizeof(struct fat_arch) : sizeof(struct fat_arch_64);
+	if (nfat > (size - sizeof(struct fat_header)) / archSize)
+		return EBADMACHO;
+
+	for (uint32_t i = 0; i < nfat && *count < max; i++) {
+		const uint8_t *arch = base + sizeof(struct fat_header) + i * archSize;
+		struct macho_slice *slice = &slices[*count];
+		slice->cputype = (cpu_type_t)macho_read_be32(arch);
+		slice->cpusubtype = (cpu_subtype_t)macho_read_be32(arch + 4);
+		if (magic == FAT_MAGIC) {
+			slice->offset = macho_read_be32(arch + 8);
+			slice->size = macho_read_be32(arch + 12);
+		} else {
+			slice->offset = macho_read_be64(arch + 8);
+			slice->size = macho_read_be64(arch + 16);
+		}
+		if (slice->offset > filesize || slice->size > filesize - slice->offset)
+			return EBADMACHO;
+		(*count)++;
+	}
+	return 0;
+}
+
+int
+macho_slices(const void *file, size_t size, struct macho_slice *slices, uint32_t max, uint32_t *count)
+{
+	return macho_slices_header(file, size, size, slices, max, count);
+}
+
+int
+macho_walker_init(struct macho_walker *w, const void *slice, size_t size)
+{
+	uint32_t magic, sizeofcmds;
+	size_t hdrsize;
+
+	w->base = slice;
+	w->size = size;
+	w->index = 0;
+	w->error = 0;
+
+	if (size < sizeof(magic))
+		return ENOEXEC;
+	memcpy(&magic, w->base, sizeof(magic));
+
+	if (magic == MH_MAGIC_64) {
+		struct mach_header_64 mh;
+		if (size < sizeof(mh))
+			return EBADMACHO;
+		memcpy(&mh, w->base, sizeof(mh));
+		w->is64 = true;
+		w->cputype = mh.cputype;
+		w->cpusubtype = mh.cpusubtype;
+		w->ncmds = mh.ncmds;
+		sizeofcmds = mh.sizeofcmds;
+		hdrsize = sizeof(mh);
+	} else if (magic == MH_MAGIC) {
+		struct mach_header mh;
+		if (size < sizeof(mh))
+			return EBADMACHO;
+		memcpy(&mh, w->base, sizeof(mh));
+		w->is64 = false;
+		w->cputype = mh.cputype;
+		w->cpusubtype = mh.cpusubtype;
+		w->ncmds = mh.ncmds;
+		sizeofcmds = mh.sizeofcmds;
+		hdrsize = sizeof(mh);
+	} else {
+		return ENOEXEC;
+	}
+
+	if (sizeofcmds > size - hdrsize)
+		return EBADMACHO;
+	// Every command is at least a struct load_command, which bounds ncmds
+	if (w->ncmds > sizeofcmds / sizeof(struct load_command))
+		return EBADMACHO;
+
+	w->offset = hdrsize;
+	w->end = hdrsize + sizeofcmds;
+	return 0;
+}
+
+bool
+macho_walker_next(struct macho_walker *w, struct macho_load_command *lc)
+{
+	struct load_command hdr;
+
+	if (w->error != 0 || w->index == w->ncmds)
+		return false;
+
+	if (w->end - w->offset < sizeof(hdr)) {
+		w->error = EBADMACHO;
+		return false;
+	}
+	memcpy(&hdr, w->base + w->offset, sizeof(hdr));
+	if (hdr.cmdsize < sizeof(hdr) || hdr.cmdsize > w->end - w->offset) {
+		w->error = EBADMACHO;
+		return false;
+	}
+
+	lc->cmd = hdr.cmd;
+	lc->cmdsize = hdr.cmdsize;
+	lc->data = w->base + w->offset;
+	w->offset += hdr.cmdsize;
+	w->index++;
+	return true;
+}
+
+int
+macho_index_build(struct macho_index *idx, const void *slice, size_t size)
+{
+	struct macho_walker w;
+	struct macho_load_command lc;
+	int ret;
+
+	// The section table is left uninitialized; only the first nsections entries are valid
+	idx->base = slice;
+	idx->size = size;
+	idx->nsections = 0;
+
+	if ((ret = macho_walker_init(&w, slice, size)) != 0)
+		return ret;
+	idx->is64 = w.is64;
+	idx->cputype = w.cputype;
+	idx->cpusubtype = w.cpusubtype;
+
+	while (macho_walker_next(&w, &lc)) {
+		if ((lc.cmd == LC_SEGMENT_64 && w.is64) || (lc.cmd == LC_SEGMENT && !w.is64))
+			ret = macho_index_segment(idx, &lc, w.is64);
+		if (ret != 0)
+			return ret;
+	}
+	return w.error;
+}
+
+const struct macho_section *
+macho_index_find(const struct macho_index *idx, const char *segname, const char *sectname)
+{
+	for (uint32_t i = 0; i < idx->nsections; i++) {
+		const struct macho_section *s = &idx->sections[i];
+		if (strcmp(s->sectname, sectname) == 0 && strcmp(s->segname, segname) == 0)
+			return s;
+	}
+	return NULL;
+}
+
+bool
+macho_section_has_data(const struct macho_section *sect, uint64_t size)
+{
+	switch (sect->flags & SECTION_TYPE) {
+		case S_ZEROFILL:
+		case S_GB_ZEROFILL:
+		case S_THREAD_LOCAL_ZEROFILL:
+			return false;
+	}
+	return sect->offset <= size && sect->size <= size - sect->offset;
+}
+
+const void *
+macho_section_data(const struct macho_index *idx, const struct macho_section *sect)
+{
+	return macho_section_has_data(sect, idx->size) ? idx->base + sect->offset : NULL;
+}
+
+/*
+ * Finds LC_CODE_SIGNATURE in the load commands at the start of a slice of
+ * slicesize bytes. Returns ENOENT if the slice is not signed.
+ */
+int
+macho_code_signature(const void *commands, size_t size, uint64_t slicesize, uint64_t *offset, uint64_t *len)
+{
+	struct macho_walker w;
+	struct macho_load_command lc;
+	struct linkedit_data_command sig;
+	int ret;
+
+	if ((ret = macho_walker_init(&w, commands, size)) != 0)
+		return ret;
+	while (macho_walker_next(&w, &lc)) {
+		if (lc.cmd != LC_CODE_SIGNATURE)
+			continue;
+		if (lc.cmdsize < sizeof(sig))
+			return EBADMACHO;
+		memcpy(&sig, lc.data, sizeof(sig));
+		if (sig.dataoff > slicesize || sig.datasize > slicesize - sig.dataoff)
+			return EBADMACHO;
+		*offset = sig.dataoff;
+		*len = sig.datasize;
+		return 0;
+	}
+	return w.error != 0 ? w.error : ENOENT;
+}
+
+/*
+ * Returns the payload of the first blob with the given magic in an embedded
+ * signature. Code signatures are big-endian whatever the slice is.
+ */
+int
+macho_signature_blob(const void *signature, size_t size, uint32_t magic, const void **data, size_t *len)
+{
+	const uint8_t *base = signature;
+	uint32_t length, count;
+
+	if (size < 12 || macho_read_be32(base) != CSMAGIC_EMBEDDED_SIGNATURE)
+		return EBADMACHO;
+	length = macho_read_be32(base + 4);
+	count = macho_read_be32(base + 8);
+	if (length < 12 || length > size || count > (length - 12) / 8)
+		return EBADMACHO;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t offset = macho_read_be32(base + 12 + i * 8 + 4);
+		if (offset > length - 8 || macho_read_be32(base + offset) != magic)
+			continue;
+		uint32_t blobLength = macho_read_be32(base + offset + 4);
+		if (blobLength < 8 || blobLength > length - offset)
+			return EBADMACHO;
+		*data = base + offset + 8;
+		*len = blobLength - 8;
+		return 0;
+	}
+	return ENOENT;
+}
+
+static const struct {
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	const char *name;
+} macho_arch_names[] = {
+	{ CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_H, "x86_64h" },
+	{ CPU_TYPE_X86_64, -1, "x86_64" },
+	{ CPU_TYPE_I386, -1, "i386" },
+	{ CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E, "arm64e" },
+	{ CPU_TYPE_ARM64, -1, "arm64" },
+	{ CPU_TYPE_ARM64_32, -1, "arm64_32" },
+	{ CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7K, "armv7k" },
+	{ CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7S, "armv7s" },
+	{ CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7, "armv7" },
+	{ CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V6, "armv6" },
+	{ CPU_TYPE_ARM, -1, "arm" },
+	{ CPU_TYPE_POWERPC64, -1, "ppc64" },
+	{ CPU_TYPE_POWERPC, -1, "ppc" },
+};
+
+const char *
+macho_arch_name(cpu_type_t cputype, cpu_subtype_t cpusubtype)
+{
+	cpusubtype &= ~CPU_SUBTYPE_MASK;
+	for (size_t i = 0; i < sizeof(macho_arch_names) / sizeof(macho_arch_names[0]); i++) {
+		if (macho_arch_names[i].cputype == cputype &&
+		    (macho_arch_names[i].cpusubtype == -1 || macho_arch_names[i].cpusubtype == cpusubtype))
+			return macho_arch_names[i].name;
+	}
+	return "unknown";
+}
@@ -0,0 +1,170 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <mach/machine.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef _LAUNCHCTL_MACHO_H_
+#define _LAUNCHCTL_MACHO_H_
+
+/*
+ * Mach-O parsing for untrusted files. Nothing here allocates, and every
+ * count, size and offset read from the file is checked against the bounds
+ * of the buffer before it is used, so a corrupt file produces EBADMACHO
+ * (EINVAL where that does not exist) rather than a crash. ENOEXEC means the
+ * buffer is not a Mach-O or fat file at all.
+ */
+
+#ifndef EBADMACHO
+#define EBADMACHO EINVAL
+#endif
+
+#define CSMAGIC_EMBEDDED_SIGNATURE 0xfade0cc0
+#define CSMAGIC_EMBEDDED_ENTITLEMENTS 0xfade7171
+#define CSMAGIC_EMBEDDED_DER_ENTITLEMENTS 0xfade7172
+
+// n_sect in the symbol table is 8 bits wide, so no image has more sections
+#define MACHO_MAX_SECTIONS 255
+
+/*
+ * A slice of a thin or fat file; a thin file is a single slice spanning the
+ * whole file. Offsets and sizes are checked against the file size.
+ */
+struct macho_slice {
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	uint64_t offset;
+	uint64_t size;
+};
+
+/*
+ * Iterator over the load commands of a single (thin) Mach-O slice.
+ * macho_walker_next() returns false once all commands have been visited or
+ * when one is malformed, in which case error is set. data points at the
+ * whole command inside the slice and is not necessarily aligned.
+ */
+struct macho_walker {
+	const uint8_t *base;
+	size_t size;
+	bool is64;
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	uint32_t ncmds;
+	uint32_t index;
+	size_t offset;
+	size_t end;
+	int error;
+};
+
+struct macho_load_command {
+	uint32_t cmd;
+	uint32_t cmdsize;
+	const uint8_t *data;
+};
+
+/*
+ * Segment/section index of a single slice.
+ *
+ * The load commands are walked once and every section is recorded with
+ * NUL-terminated names and its file range relative to the start of the
+ * slice, so any number of sections can be looked up without walking the
+ * load commands again. Section data is checked against the slice when it is
+ * fetched.
+ */
+struct macho_section {
+	char segname[17];
+	char sectname[17];
+	uint32_t flags;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct macho_index {
+	const uint8_t *base;
+	size_t size;
+	bool is64;
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	uint32_t nsections;
+	struct macho_section sections[MACHO_MAX_SECTIONS];
+};
+
+/*
+ * Access to a thin or fat file on disk (macho_file.c). With MACHO_IO_MMAP
+ * the whole file is mapped read-only and reads return pointers into the
+ * mapping. With MACHO_IO_PREAD only the bytes asked for are read: the fat
+ * header, the start of each slice up to the end of its load commands, and
+ * the sections themselves, into buffers the caller frees; bytes_read counts
+ * them. MACHO_IO_AUTO uses pread for large files and for files on
+ * filesystems that are not local, where readahead around the few pages that
+ * are needed would pull in far more than that.
+ */
+enum macho_io {
+	MACHO_IO_AUTO,
+	MACHO_IO_MMAP,
+	MACHO_IO_PREAD,
+};
+
+#define MACHO_PREAD_MIN_SIZE (64 << 20)
+
+struct macho_file {
+	int fd;
+	enum macho_io io;
+	uint64_t size;
+	const uint8_t *map;
+	_Atomic uint64_t bytes_read;
+};
+
+int macho_slices(const void *file, size_t size, struct macho_slice *slices, uint32_t max, uint32_t *count);
+int macho_slices_header(const void *header, size_t avail, uint64_t filesize, struct macho_slice *slices, uint32_t max,
+    uint32_t *count);
+int macho_walker_init(struct macho_walker *w, const void *slice, size_t size);
+bool macho_walker_next(struct macho_walker *w, struct macho_load_command *lc);
+int macho_index_build(struct macho_index *idx, const void *slice, size_t size);
+const struct macho_section *macho_index_find(const struct macho_index *idx, const char *segname,
+    const char *sectname);
+bool macho_section_has_data(const struct macho_section *sect, uint64_t size);
+const void *macho_section_data(const struct macho_index *idx, const struct macho_section *sect);
+const char *macho_arch_name(cpu_type_t cputype, cpu_subtype_t cpusubtype);
+int macho_code_signature(const void *commands, size_t size, uint64_t slicesize, uint64_t *offset, uint64_t *len);
+int macho_signature_blob(const void *signature, size_t size, uint32_t magic, const void **data, size_t *len);
+
+int macho_file_open(struct macho_file *f, int fd, enum macho_io io);
+void macho_file_close(struct macho_file *f);
+int macho_file_read(struct macho_file *f, uint64_t offset, size_t len, const void **data, void **buf);
+int macho_file_slices(struct macho_file *f, struct macho_slice *slices, uint32_t max, uint32_t *count);
+int macho_file_commands(struct macho_file *f, const struct macho_slice *slice, const void **data, size_t *len,
+    void **buf);
+int macho_file_index(struct macho_file *f, const struct macho_slice *slice, struct macho_index *idx, void **buf);
+int macho_file_section(struct macho_file *f, const struct macho_slice *slice, const struct macho_section *sect,
+    const void **data, void **buf);
+#endif
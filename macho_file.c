@@ -0,0 +1,247 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __APPLE__
+#include <sys/mount.h>
+#else
+#include <sys/vfs.h>
+#endif
+
+#include <errno.h>
+#include <mach-o/loader.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "macho.h"
+#include "trace.h"
+
+// Covers a fat header and arch table with room to spare
+#define MACHO_FAT_READ 4096
+// Covers the header and load commands of most images, so one read usually does
+#define MACHO_HEADER_READ 16384
+
+static bool
+macho_fd_is_local(int fd)
+{
+	struct statfs sfs;
+
+	if (fstatfs(fd, &sfs) == -1)
+		return true;
+#ifdef MNT_LOCAL
+	return (sfs.f_flags & MNT_LOCAL) != 0;
+#else
+	switch ((uint32_t)sfs.f_type) {
+		case 0x6969: // NFS
+		case 0x517b: // SMB
+		case 0xfe534d42: // SMB2
+		case 0xff534d42: // CIFS
+		case 0x65735546: // FUSE
+			return false;
+		default:
+			return true;
+	}
+#endif
+}
+
+int
+macho_file_open(struct macho_file *f, int fd, enum macho_io io)
+{
+	struct stat st;
+
+	f->fd = fd;
+	f->map = NULL;
+	f->size = 0;
+	atomic_init(&f->bytes_read, 0);
+
+	if (fstat(fd, &st) == -1)
+		return errno;
+	f->size = (uint64_t)st.st_size;
+
+	if (io == MACHO_IO_AUTO)
+		io = f->size >= MACHO_PREAD_MIN_SIZE || !macho_fd_is_local(fd) ? MACHO_IO_PREAD : MACHO_IO_MMAP;
+	if (io == MACHO_IO_MMAP && f->size > 0) {
+		void *map = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED)
+			f->map = map;
+	}
+	f->io = f->map != NULL ? MACHO_IO_MMAP : MACHO_IO_PREAD;
+	return 0;
+}
+
+void
+macho_file_close(struct macho_file *f)
+{
+	if (f->map != NULL)
+		munmap((void *)f->map, f->size);
+	f->map = NULL;
+}
+
+/*
+ * Points data at len bytes at offset. In pread mode they are read into a
+ * new buffer that is also returned in buf for the caller to free; in mmap
+ * mode buf is NULL.
+ */
+int
+macho_file_read(struct macho_file *f, uint64_t offset, size_t len, const void **data, void **buf)
+{
+	uint8_t *p;
+	size_t done = 0;
+
+	*buf = NULL;
+	if (offset > f->size || len > f->size - offset)
+		return EBADMACHO;
+	if (f->map != NULL) {
+		*data = f->map + offset;
+		return 0;
+	}
+
+	if ((p = malloc(len == 0 ? 1 : len)) == NULL)
+		return ENOMEM;
+	while (done < len) {
+		ssize_t n = pread(f->fd, p + done, len - done, (off_t)(offset + done));
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			int err = n == 0 ? EIO : errno;
+			free(p);
+			return err;
+		}
+		done += (size_t)n;
+	}
+	atomic_fetch_add_explicit(&f->bytes_read, len, memory_order_relaxed);
+
+	*data = p;
+	*buf = p;
+	return 0;
+}
+
+int
+macho_file_slices(struct macho_file *f, struct macho_slice *slices, uint32_t max, uint32_t *count)
+{
+	const void *data;
+	void *buf;
+	int ret;
+
+	*count = 0;
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+	size_t len = f->size < MACHO_FAT_READ ? (size_t)f->size : MACHO_FAT_READ;
+	if ((ret = macho_file_read(f, 0, len, &data, &buf)) != 0)
+		return ret;
+	ret = macho_slices_header(data, len, f->size, slices, max, count);
+	free(buf);
+	LAUNCHCTL_TRACE_END("macho_slices", t, NULL, "\"slices\":%u,\"error\":%d", *count, ret);
+	return ret;
+}
+
+/*
+ * Reads the header and load commands of a slice. In mmap mode data covers
+ * the whole slice.
+ */
+int
+macho_file_commands(struct macho_file *f, const struct macho_slice *slice, const void **data, size_t *len,
+    void **buf)
+{
+	struct mach_header_64 mh = {};
+	size_t hdrsize;
+	int ret;
+
+	if (f->map != NULL) {
+		*buf = NULL;
+		*data = f->map + slice->offset;
+		*len = (size_t)slice->size;
+		return 0;
+	}
+
+	*len = slice->size < MACHO_HEADER_READ ? (size_t)slice->size : MACHO_HEADER_READ;
+	if ((ret = macho_file_read(f, slice->offset, *len, data, buf)) != 0)
+		return ret;
+	memcpy(&mh, *data, *len < sizeof(mh) ? *len : sizeof(mh));
+
+	if (mh.magic == MH_MAGIC_64) {
+		hdrsize = sizeof(struct mach_header_64);
+	} else if (mh.magic == MH_MAGIC) {
+		hdrsize = sizeof(struct mach_header);
+	} else {
+		free(*buf);
+		*buf = NULL;
+		return ENOEXEC;
+	}
+
+	// Load commands that do not fit in the first read are read again in full
+	if (*len >= hdrsize && mh.sizeofcmds > *len - hdrsize && mh.sizeofcmds <= slice->size - hdrsize) {
+		free(*buf);
+		*len = hdrsize + mh.sizeofcmds;
+		if ((ret = macho_file_read(f, slice->offset, *len, data, buf)) != 0)
+			return ret;
+	}
+	return 0;
+}
+
+/*
+ * Indexes a slice from its header and load commands. The index points into
+ * the returned buffer, which must outlive it; section data has to be fetched
+ * with macho_file_section().
+ */
+int
+macho_file_index(struct macho_file *f, const struct macho_slice *slice, struct macho_index *idx, void **buf)
+{
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+	const void *data;
+	size_t len;
+	int ret;
+
+	if ((ret = macho_file_commands(f, slice, &data, &len, buf)) != 0)
+		return ret;
+	if ((ret = macho_index_build(idx, data, len)) != 0) {
+		free(*buf);
+		*buf = NULL;
+	}
+	LAUNCHCTL_TRACE_END("macho_index", t, NULL, "\"offset\":%llu,\"bytes\":%zu,\"error\":%d",
+	    (unsigned long long)slice->offset, len, ret);
+	return ret;
+}
+
+int
+macho_file_section(struct macho_file *f, const struct macho_slice *slice, const struct macho_section *sect,
+    const void **data, void **buf)
+{
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+	int ret;
+
+	*buf = NULL;
+	if (!macho_section_has_data(sect, slice->size))
+		return EBADMACHO;
+	ret = macho_file_read(f, slice->offset + sect->offset, (size_t)sect->size, data, buf);
+	LAUNCHCTL_TRACE_END("macho_section", t, NULL, "\"bytes\":%llu,\"error\":%d", (unsigned long long)sect->size, ret);
+	return ret;
+}
@@ -26,218 +26,540 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <sys/fcntl.h>
-#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fts.h>
+#include <getopt.h>
 #include <mach-o/fat.h>
 #include <mach-o/loader.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
+#include "macho.h"
 #include "xpc_private.h"
 
+#define PLIST_MAX_SLICES 16
+
+struct plist_section {
+	const char *segment;
+	const char *section;
+};
+
+struct plist_options {
+	const struct plist_section *sections;
+	size_t nsections;
+	const char *arch;
+	bool all;
+	enum macho_io io;
+};
+
+struct plist_slice {
+	struct macho_slice slice;
+	const char *arch;
+	int error;
+	bool is64;
+	xpc_object_t *plists;
+};
+
+static int
+plist_parse_specifier(char *specifier, struct plist_section *out)
+{
+	char *comma = strchr(specifier, ',');
+	if (comma == NULL)
+		return EUSAGE;
+	*comma = '\0';
+	out->segment = specifier;
+	out->section = comma + 1;
+	return 0;
+}
+
+static bool
+plist_is_macho_magic(uint32_t magic)
+{
+	return magic == MH_MAGIC || magic == MH_MAGIC_64 || ntohl(magic) == FAT_MAGIC || ntohl(magic) == FAT_MAGIC_64;
+}
+
 static xpc_object_t
-get_plist_from_section_32(struct mach_header *header, const char *segmentname, const char *sectionname)
+plist_copy_section(struct macho_file *file, const struct macho_slice *slice, const struct macho_index *idx,
+    const struct plist_section *section)
 {
+	const struct macho_section *sect = macho_index_find(idx, section->segment, section->section);
 	xpc_object_t plist = NULL;
+	const void *data;
+	void *buf;
 
-	uint32_t loadCmdCount = header->ncmds;
-	uintptr_t loadCmdTable = (uintptr_t)header + sizeof(struct mach_header);
-
-	struct load_command *loadCmd = (struct load_command *)loadCmdTable;
-	for (uint32_t j = 0; j < loadCmdCount;
-	     j++, loadCmd = (struct load_command *)((uintptr_t)loadCmd + loadCmd->cmdsize)) {
-		if (loadCmd->cmd == LC_SEGMENT) {
-			struct segment_command *segmentCmd = (struct segment_command *)loadCmd;
-			if (strcmp(segmentCmd->segname, segmentname) == 0) {
-				uint32_t sectionCount = segmentCmd->nsects;
-				struct section *sectionTable = (struct section *)((uintptr_t)segmentCmd +
-				    sizeof(struct segment_command));
-
-				for (uint32_t k = 0; k < sectionCount; k++) {
-					struct section *section = &(sectionTable[k]);
-					if (strcmp(section->sectname, sectionname) == 0) {
-						size_t dataSize = (size_t)(section->size);
-						void *secdata = (void *)((uintptr_t)header + section->offset);
-						plist = xpc_create_from_plist(secdata, dataSize);
-						if (plist != NULL) {
-							return plist;
-						}
-					}
-				}
+	if (sect != NULL && macho_file_section(file, slice, sect, &data, &buf) == 0) {
+		plist = xpc_create_from_plist(data, sect->size);
+		free(buf);
+	}
+	return plist;
+}
+
+/*
+ * Picks the slices of a thin or fat file selected by opts (the first Mach-O
+ * slice, the slice named opts->arch, or all of them) and extracts the
+ * requested sections of each, parsing up to width slices concurrently.
+ * Returns ENOEXEC if the file has no Mach-O slice and EBADARCH if none
+ * matches opts->arch.
+ */
+static int
+plist_extract(struct macho_file *file, const struct plist_options *opts, size_t width, struct plist_slice *out,
+    uint32_t *nout)
+{
+	struct macho_slice slices[PLIST_MAX_SLICES];
+	uint32_t count, n = 0;
+	bool anyMachO = false;
+	int ret;
+
+	*nout = 0;
+	if ((ret = macho_file_slices(file, slices, PLIST_MAX_SLICES, &count)) != 0)
+		return ret;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const void *data;
+		void *buf;
+		uint32_t magic;
+		if (macho_file_read(file, slices[i].offset, sizeof(magic), &data, &buf) != 0)
+			continue;
+		memcpy(&magic, data, sizeof(magic));
+		free(buf);
+		if (magic != MH_MAGIC && magic != MH_MAGIC_64)
+			continue;
+		anyMachO = true;
+
+		const char *arch = macho_arch_name(slices[i].cputype, slices[i].cpusubtype);
+		if (opts->arch != NULL && strcmp(arch, opts->arch) != 0)
+			continue;
+		out[n++] = (struct plist_slice) { .slice = slices[i], .arch = arch };
+		if (!opts->all)
+			break;
+	}
+	if (n == 0)
+		return anyMachO ? EBADARCH : ENOEXEC;
+
+	const struct plist_section *sections = opts->sections;
+	size_t nsections = opts->nsections;
+	launchctl_concurrent_apply(n, width, ^(size_t i) {
+	    struct plist_slice *s = &out[i];
+	    struct macho_index idx;
+	    void *commands;
+	    if ((s->plists = calloc(nsections, sizeof(xpc_object_t))) == NULL) {
+		    s->error = ENOMEM;
+		    return;
+	    }
+	    if ((s->error = macho_file_index(file, &s->slice, &idx, &commands)) != 0)
+		    return;
+	    s->is64 = idx.is64;
+	    for (size_t j = 0; j < nsections; j++)
+		    s->plists[j] = plist_copy_section(file, &s->slice, &idx, &sections[j]);
+	    free(commands);
+	});
+
+	*nout = n;
+	return 0;
+}
+
+static void
+plist_slices_release(struct plist_slice *slices, uint32_t count, size_t nsections)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		if (slices[i].plists == NULL)
+			continue;
+		for (size_t j = 0; j < nsections; j++) {
+			if (slices[i].plists[j] != NULL)
+				xpc_release(slices[i].plists[j]);
+		}
+		free(slices[i].plists);
+	}
+}
+
+static void
+plist_print_differences(const char *baseName, xpc_object_t base, const char *name, xpc_object_t plist)
+{
+	printf("Differences between \"%s\" and \"%s\":\n", baseName, name);
+	if (xpc_get_type(base) != XPC_TYPE_DICTIONARY || xpc_get_type(plist) != XPC_TYPE_DICTIONARY) {
+		printf("\t~ (root)\n");
+		return;
+	}
+	(void)xpc_dictionary_apply(base, ^bool(const char *key, xpc_object_t value) {
+	    xpc_object_t other = xpc_dictionary_get_value(plist, key);
+	    if (other == NULL)
+		    printf("\t- \"%s\"\n", key);
+	    else if (!xpc_equal(value, other))
+		    printf("\t~ \"%s\"\n", key);
+	    return true;
+	});
+	(void)xpc_dictionary_apply(plist, ^bool(const char *key, xpc_object_t value) {
+	    if (xpc_dictionary_get_value(base, key) == NULL)
+		    printf("\t+ \"%s\"\n", key);
+	    return true;
+	});
+}
+
+/*
+ * Prints the extracted sections. With several slices the first slice that
+ * has a section is printed in full and every other slice is compared to it:
+ * identical slices are only named, differing ones are printed followed by
+ * the top-level keys that were added (+), removed (-) or changed (~).
+ */
+static int
+plist_print_slices(const struct plist_slice *slices, uint32_t count, const struct plist_section *sections,
+    size_t nsections)
+{
+	char name[64], baseName[64];
+	int ret = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (slices[i].error == ENOEXEC) {
+			fprintf(stderr, "File is not a valid Mach-O or fat file.\n");
+			ret = slices[i].error;
+		} else if (slices[i].error != 0) {
+			fprintf(stderr, "%s%sMach-O is invalid: %d: %s\n", count > 1 ? slices[i].arch : "",
+			    count > 1 ? ": " : "", slices[i].error, strerror(slices[i].error));
+			ret = slices[i].error;
+		}
+	}
+
+	for (size_t j = 0; j < nsections; j++) {
+		xpc_object_t base = NULL;
+
+		for (uint32_t i = 0; i < count; i++) {
+			if (slices[i].error != 0)
+				continue;
+
+			xpc_object_t plist = slices[i].plists[j];
+			if (plist == NULL) {
+				fprintf(stderr, "%s%s%d-bit Mach-O does not have a %s,%s or is invalid.\n\n",
+				    count > 1 ? slices[i].arch : "", count > 1 ? ": " : "", slices[i].is64 ? 64 : 32,
+				    sections[j].segment, sections[j].section);
+				ret = ENOENT;
+				continue;
+			}
+
+			if (count == 1 && nsections == 1) {
+				launchctl_xpc_object_print(plist, NULL, 0);
+				continue;
+			} else if (count == 1) {
+				snprintf(name, sizeof(name), "%s,%s", sections[j].segment, sections[j].section);
+			} else if (nsections == 1) {
+				snprintf(name, sizeof(name), "%s", slices[i].arch);
+			} else {
+				snprintf(name, sizeof(name), "%s %s,%s", slices[i].arch, sections[j].segment,
+				    sections[j].section);
+			}
+
+			if (base == NULL) {
+				base = plist;
+				strlcpy(baseName, name, sizeof(baseName));
+				launchctl_xpc_object_print(plist, name, 0);
+			} else if (xpc_equal(base, plist)) {
+				printf("\"%s\" is identical to \"%s\".\n", name, baseName);
+			} else {
+				launchctl_xpc_object_print(plist, name, 0);
+				plist_print_differences(baseName, base, name, plist);
 			}
 		}
 	}
 
-	fprintf(stderr, "32-bit Mach-O does not have a %s,%s or is invalid.\n\n", segmentname, sectionname);
-	return NULL;
+	return ret;
 }
 
-static xpc_object_t
-get_plist_from_section_64(struct mach_header_64 *header, const char *segmentname, const char *sectionname)
+/*
+ * Writes one NDJSON record to stdout for every selected slice of path that
+ * has at least one of the requested sections. With a single section "plist"
+ * is that property list, otherwise it is an object keyed by
+ * "segment,section".
+ */
+static void
+plist_scan_file(const char *path, const struct plist_options *opts)
 {
-	xpc_object_t plist = NULL;
+	struct plist_slice slices[PLIST_MAX_SLICES];
+	struct macho_file file;
+	struct stat status;
+	uint32_t magic, count = 0;
+	size_t len = 0;
+	bool opened = false;
+	char *buf = NULL;
+	bool found = false;
+	FILE *out;
+	int fd, err;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	// Most files in a bundle are not Mach-O, so check the magic before mapping anything
+	if (fstat(fd, &status) == -1 || status.st_size < (off_t)sizeof(magic) ||
+	    pread(fd, &magic, sizeof(magic), 0) != sizeof(magic) || !plist_is_macho_magic(magic))
+		goto end;
+
+	if ((err = macho_file_open(&file, fd, opts->io)) != 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(err));
+		goto end;
+	}
+	opened = true;
+
+	// Files are already processed concurrently, so slices are parsed one at a time
+	if (plist_extract(&file, opts, 1, slices, &count) != 0)
+		goto end;
 
-	uint32_t loadCmdCount = header->ncmds;
-	uintptr_t loadCmdTable = (uintptr_t)header + sizeof(struct mach_header_64);
-
-	struct load_command *loadCmd = (struct load_command *)loadCmdTable;
-	for (uint32_t j = 0; j < loadCmdCount;
-	     j++, loadCmd = (struct load_command *)((uintptr_t)loadCmd + loadCmd->cmdsize)) {
-		if (loadCmd->cmd == LC_SEGMENT_64) {
-			struct segment_command_64 *segmentCmd = (struct segment_command_64 *)loadCmd;
-			if (strcmp(segmentCmd->segname, segmentname) == 0) {
-				uint32_t sectionCount = segmentCmd->nsects;
-				struct section_64 *sectionTable = (struct section_64 *)((uintptr_t)segmentCmd +
-				    sizeof(struct segment_command_64));
-
-				for (uint32_t k = 0; k < sectionCount; k++) {
-					struct section_64 *section = &(sectionTable[k]);
-					if (strcmp(section->sectname, sectionname) == 0) {
-						size_t dataSize = (size_t)(section->size);
-						void *secdata = (void *)((uintptr_t)header + section->offset);
-						plist = xpc_create_from_plist(secdata, dataSize);
-						if (plist != NULL) {
-							return plist;
-						}
+	if ((out = open_memstream(&buf, &len)) == NULL)
+		goto end;
+
+	for (uint32_t i = 0; i < count; i++) {
+		bool sliceFound = false;
+
+		if (slices[i].error != 0) {
+			fprintf(stderr, "%s: %s: Mach-O is invalid: %d: %s\n", path, slices[i].arch, slices[i].error,
+			    strerror(slices[i].error));
+			continue;
+		}
+		for (size_t j = 0; j < opts->nsections; j++)
+			sliceFound |= slices[i].plists[j] != NULL;
+		if (!sliceFound)
+			continue;
+
+		fputs("{\"path\":", out);
+		launchctl_fprint_json_string(out, path);
+		fputs(",\"arch\":", out);
+		launchctl_fprint_json_string(out, slices[i].arch);
+		fputs(",\"plist\":", out);
+		if (opts->nsections > 1)
+			fputc('{', out);
+		for (size_t j = 0, n = 0; j < opts->nsections; j++) {
+			if (slices[i].plists[j] == NULL)
+				continue;
+			if (opts->nsections > 1) {
+				fprintf(out, "%s\"%s,%s\":", n++ > 0 ? "," : "", opts->sections[j].segment,
+				    opts->sections[j].section);
+			}
+			launchctl_xpc_object_fprint_json(out, slices[i].plists[j]);
+		}
+		if (opts->nsections > 1)
+			fputc('}', out);
+		fputs("}\n", out);
+		found = true;
+	}
+	fclose(out);
+
+	// A single fwrite keeps records from different workers from interleaving
+	if (found)
+		fwrite(buf, 1, len, stdout);
+	free(buf);
+
+end:
+	plist_slices_release(slices, count, opts->nsections);
+	if (opened)
+		macho_file_close(&file);
+	close(fd);
+}
+
+static int
+plist_scan_trees(char **roots, const struct plist_options *opts, size_t width)
+{
+	FTS *fts;
+	FTSENT *ent;
+	char **paths = NULL;
+	size_t count = 0, cap = 0;
+	int ret = 0;
+
+	if ((fts = fts_open(roots, FTS_PHYSICAL | FTS_NOCHDIR, NULL)) == NULL) {
+		ret = errno;
+		fprintf(stderr, "fts_open(): %d: %s\n", ret, strerror(ret));
+		return ret;
+	}
+
+	while ((ent = fts_read(fts)) != NULL) {
+		switch (ent->fts_info) {
+			case FTS_F:
+				if (ent->fts_statp->st_size < (off_t)sizeof(uint32_t))
+					break;
+				if (count == cap) {
+					cap = cap == 0 ? 1024 : cap * 2;
+					char **newPaths = realloc(paths, cap * sizeof(char *));
+					if (newPaths == NULL) {
+						ret = ENOMEM;
+						goto walked;
 					}
+					paths = newPaths;
 				}
-			}
+				if ((paths[count] = strdup(ent->fts_path)) == NULL) {
+					ret = ENOMEM;
+					goto walked;
+				}
+				count++;
+				break;
+			case FTS_DNR:
+			case FTS_ERR:
+			case FTS_NS:
+				fprintf(stderr, "%s: %s\n", ent->fts_path, strerror(ent->fts_errno));
+				ret = ent->fts_errno;
+				break;
 		}
 	}
 
-	fprintf(stderr, "64-bit Mach-O does not have a %s,%s or is invalid.\n\n", segmentname, sectionname);
-	return NULL;
+walked:
+	fts_close(fts);
+
+	launchctl_concurrent_apply(count, width, ^(size_t i) {
+	    plist_scan_file(paths[i], opts);
+	});
+
+	for (size_t i = 0; i < count; i++)
+		free(paths[i]);
+	free(paths);
+	return ret;
 }
 
 int
 plist_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 {
+	static const struct option longopts[] = {
+		{ "arch", required_argument, NULL, 'a' },
+		{ "all-arches", no_argument, NULL, 'A' },
+		{ "io", required_argument, NULL, 'i' },
+		{ NULL, 0, NULL, 0 },
+	};
 	int err = 0;
-	const char *wantedSegment = NULL;
-	const char *wantedSection = NULL;
 	const char *path = NULL;
 	int fd = -1;
-	size_t mappingSize = 0;
-	void *mapping = NULL;
-	xpc_object_t plist = NULL;
+	struct macho_file file;
+	bool opened = false;
+	uint32_t magic = 0;
+	struct plist_slice slices[PLIST_MAX_SLICES];
+	uint32_t count = 0;
+	struct plist_section *sections;
+	struct plist_options opts = {};
+	size_t nsections = 0, width = 8;
+	bool recursive = false;
+	int ch;
 
 	if (argc < 2) {
 		return EUSAGE;
 	}
 
-	if (argc != 3) {
-		wantedSegment = SEG_TEXT;
-		wantedSection = "__info_plist";
-		path = argv[1];
-	} else {
-		char *specifier = argv[1];
-		char *found = strchr(specifier, ',');
-		if (found == NULL) {
-			return EUSAGE;
+	sections = calloc(argc, sizeof(*sections));
+	if (sections == NULL)
+		return ENOMEM;
+
+	while ((ch = getopt_long(argc, argv, "s:rj:", longopts, NULL)) != -1) {
+		switch (ch) {
+			case 's':
+				if ((err = plist_parse_specifier(optarg, &sections[nsections++])) != 0)
+					goto end;
+				break;
+			case 'r':
+				recursive = true;
+				break;
+			case 'j':
+				if ((width = strtoul(optarg, NULL, 10)) == 0) {
+					err = EUSAGE;
+					goto end;
+				}
+				break;
+			case 'a':
+				opts.arch = optarg;
+				break;
+			case 'A':
+				opts.all = true;
+				break;
+			case 'i':
+				if (strcmp(optarg, "auto") == 0) {
+					opts.io = MACHO_IO_AUTO;
+				} else if (strcmp(optarg, "mmap") == 0) {
+					opts.io = MACHO_IO_MMAP;
+				} else if (strcmp(optarg, "pread") == 0) {
+					opts.io = MACHO_IO_PREAD;
+				} else {
+					err = EUSAGE;
+					goto end;
+				}
+				break;
+			default:
+				err = EUSAGE;
+				goto end;
 		}
-		*found = 0;
-		wantedSegment = specifier;
-		wantedSection = (char *)((uintptr_t)found + 1);
-		path = argv[2];
 	}
+	argc -= optind;
+	argv += optind;
 
-	fd = open(path, O_RDONLY);
-	if (fd == -1) {
-		fprintf(stderr, "open(): %d: %s\n", errno, strerror(errno));
+	if (recursive && argc > 0) {
+		path = argv[0];
+	} else if (argc == 2 && nsections == 0) {
+		if ((err = plist_parse_specifier(argv[0], &sections[nsections++])) != 0)
+			goto end;
+		path = argv[1];
+	} else if (argc == 1) {
+		path = argv[0];
+	} else {
+		err = EUSAGE;
 		goto end;
 	}
 
-	struct stat status = {};
-	err = fstat(fd, &status);
-	if (err == -1) {
-		fprintf(stderr, "fdstat(): %d: %s\n", errno, strerror(errno));
+	if (nsections == 0) {
+		sections[0].segment = SEG_TEXT;
+		sections[0].section = "__info_plist";
+		nsections = 1;
+	}
+	opts.sections = sections;
+	opts.nsections = nsections;
+
+	if (recursive) {
+		err = plist_scan_trees(argv, &opts, width);
 		goto end;
 	}
 
-	mappingSize = status.st_size;
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		err = errno;
+		fprintf(stderr, "open(): %d: %s\n", errno, strerror(errno));
+		goto end;
+	}
 
-	mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
-	if (mapping == MAP_FAILED) {
-		fprintf(stderr, "mmap(): %d: %s\n", errno, strerror(errno));
+	if ((err = macho_file_open(&file, fd, opts.io)) != 0) {
+		fprintf(stderr, "%s: %d: %s\n", path, err, strerror(err));
 		goto end;
 	}
+	opened = true;
 
-	if (mappingSize < sizeof(uint32_t) && mappingSize < sizeof(struct mach_header) &&
-	    mappingSize < sizeof(struct mach_header_64) && mappingSize < sizeof(struct fat_header)) {
+	if (file.size < sizeof(magic) || pread(fd, &magic, sizeof(magic), 0) != sizeof(magic)) {
+		err = ENOEXEC;
 		fprintf(stderr, "File is not a valid Mach-O or fat file.\n");
 		goto end;
 	}
 
-	uint32_t magic = *(uint32_t *)mapping;
-	if (magic == MH_MAGIC) {
-		plist = get_plist_from_section_32(mapping, wantedSegment, wantedSection);
-	} else if (magic == MH_MAGIC_64) {
-		plist = get_plist_from_section_64(mapping, wantedSegment, wantedSection);
-	} else if (magic == FAT_CIGAM || magic == FAT_CIGAM_64) {
-		struct fat_header *fatHeader = (struct fat_header *)mapping;
-		uint32_t archCount = ntohl(fatHeader->nfat_arch);
-		void *archTable = (void *)((uintptr_t)fatHeader + sizeof(struct fat_header));
-
-		for (uint32_t i = 0; i < archCount; i++) {
-			void *archMapping = NULL;
-			if (magic == FAT_CIGAM) {
-				struct fat_arch *arch = (struct fat_arch *)((uintptr_t)archTable +
-				    (i * sizeof(struct fat_arch)));
-				uint64_t archOffset = ntohl(arch->offset);
-				archMapping = (void *)((uintptr_t)mapping + archOffset);
-			} else if (magic == FAT_CIGAM_64) {
-				struct fat_arch_64 *arch = (struct fat_arch_64 *)((uintptr_t)archTable +
-				    (i * sizeof(struct fat_arch_64)));
-				uint64_t archOffset = ntohl(arch->offset);
-				archMapping = (void *)((uintptr_t)mapping + archOffset);
-			}
-
-			uint32_t archMagic = *(uint32_t *)archMapping;
-			if (archMagic == MH_MAGIC) {
-				plist = get_plist_from_section_32(archMapping, wantedSegment, wantedSection);
-				if (plist != NULL) {
-					goto print;
-				} else {
-					goto end;
-				}
-			} else if (archMagic == MH_MAGIC_64) {
-				plist = get_plist_from_section_64(archMapping, wantedSegment, wantedSection);
-				if (plist != NULL) {
-					goto print;
-				} else {
-					goto end;
-				}
-			}
-		}
+	err = plist_extract(&file, &opts, width, slices, &count);
+	if (err == 0) {
+		err = plist_print_slices(slices, count, sections, nsections);
+	} else if (err == EBADARCH) {
+		fprintf(stderr, "File does not contain a %s slice.\n", opts.arch);
+	} else if (err == ENOEXEC && plist_is_macho_magic(magic)) {
 		fprintf(stderr, "Fat file does not contain valid architectures.\n");
-		goto end;
-	} else {
+	} else if (err == ENOEXEC) {
 		fprintf(stderr, "File is not a valid Mach-O or fat file.\n");
-		goto end;
+	} else {
+		fprintf(stderr, "Mach-O is invalid: %d: %s\n", err, strerror(err));
 	}
 
-print:
-	launchctl_xpc_object_print(plist, NULL, 0);
-
 end:
-	if (plist != NULL) {
-		xpc_release(plist);
-	}
-	if (mapping != NULL) {
-		munmap(mapping, mappingSize);
+	plist_slices_release(slices, count, nsections);
+	if (opened) {
+		macho_file_close(&file);
 	}
 	if (fd != -1) {
 		close(fd);
 	}
+	free(sections);
 
-	return 0;
+	return err;
 }
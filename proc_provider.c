@@ -0,0 +1,374 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <libproc.h>
+#include <sys/proc_info.h>
+#endif
+
+#include "proc_provider.h"
+
+#ifdef __APPLE__
+/* #define PRIVATE
+   #include <sys/proc_info_private.h> */
+struct proc_uniqidentifierinfo {
+	uint8_t p_uuid[16];   /* UUID of the main executable */
+	uint64_t p_uniqueid;  /* 64 bit unique identifier for process */
+	uint64_t p_puniqueid; /* unique identifier for process's parent */
+	int32_t p_idversion;  /* pid version */
+	uint32_t p_reserve2;  /* reserved for future use */
+	uint64_t p_reserve3;  /* reserved for future use */
+	uint64_t p_reserve4;  /* reserved for future use */
+};
+
+struct proc_bsdinfowithuniqid {
+	struct proc_bsdinfo pbsd;
+	struct proc_uniqidentifierinfo p_uniqidentifier;
+};
+
+#define PROC_PIDT_BSDINFOWITHUNIQID 18
+#define PROC_PIDT_BSDINFOWITHUNIQID_SIZE (sizeof(struct proc_bsdinfowithuniqid))
+/* END <sys/proc_info_private.h> */
+
+static int
+darwin_get_info(pid_t pid, struct proc_info *info)
+{
+	struct proc_bsdinfowithuniqid procinfo;
+	static const struct {
+		uint32_t from;
+		uint32_t to;
+	} flagmap[] = {
+		{ PROC_FLAG_SYSTEM, PROC_INFO_FLAG_SYSTEM },
+		{ PROC_FLAG_TRACED, PROC_INFO_FLAG_TRACED },
+		{ PROC_FLAG_INEXIT, PROC_INFO_FLAG_INEXIT },
+		{ PROC_FLAG_PPWAIT, PROC_INFO_FLAG_PPWAIT },
+		{ PROC_FLAG_LP64, PROC_INFO_FLAG_LP64 },
+		{ PROC_FLAG_SLEADER, PROC_INFO_FLAG_SLEADER },
+		{ PROC_FLAG_CTTY, PROC_INFO_FLAG_CTTY },
+		{ PROC_FLAG_CONTROLT, PROC_INFO_FLAG_CONTROLT },
+		{ PROC_FLAG_THCWD, PROC_INFO_FLAG_THCWD },
+	};
+
+	int retval = proc_pidinfo(pid, PROC_PIDT_BSDINFOWITHUNIQID, 1, &procinfo, PROC_PIDT_BSDINFOWITHUNIQID_SIZE);
+	if (retval <= 0)
+		return errno;
+	if (retval != PROC_PIDT_BSDINFOWITHUNIQID_SIZE)
+		return ESRCH;
+
+	memset(info, 0, sizeof(*info));
+	info->pid = procinfo.pbsd.pbi_pid;
+	info->uniqueid = procinfo.p_uniqidentifier.p_uniqueid;
+	info->ppid = procinfo.pbsd.pbi_ppid;
+	info->pgid = procinfo.pbsd.pbi_pgid;
+	info->status = procinfo.pbsd.pbi_status;
+	for (size_t i = 0; i < sizeof(flagmap) / sizeof(flagmap[0]); i++) {
+		if (procinfo.pbsd.pbi_flags & flagmap[i].from)
+			info->flags |= flagmap[i].to;
+	}
+	info->uid = procinfo.pbsd.pbi_uid;
+	info->svuid = procinfo.pbsd.pbi_svuid;
+	info->ruid = procinfo.pbsd.pbi_ruid;
+	info->gid = procinfo.pbsd.pbi_gid;
+	info->svgid = procinfo.pbsd.pbi_svgid;
+	info->rgid = procinfo.pbsd.pbi_rgid;
+	strlcpy(info->comm, procinfo.pbsd.pbi_comm, sizeof(info->comm));
+	strlcpy(info->name, procinfo.pbsd.pbi_name, sizeof(info->name));
+	info->tdev = procinfo.pbsd.e_tdev;
+	info->tpgid = procinfo.pbsd.e_tpgid;
+	return 0;
+}
+
+static int
+darwin_get_dirty(pid_t pid, uint32_t *flags)
+{
+	uint32_t dflags;
+	if (proc_get_dirty(pid, &dflags) != 0)
+		return errno;
+
+	*flags = 0;
+	if (dflags & PROC_DIRTY_TRACKED)
+		*flags |= PROC_INFO_DIRTY_TRACKED;
+	if (dflags & PROC_DIRTY_IS_DIRTY)
+		*flags |= PROC_INFO_DIRTY_IS_DIRTY;
+	if (dflags & PROC_DIRTY_ALLOWS_IDLE_EXIT)
+		*flags |= PROC_INFO_DIRTY_ALLOWS_IDLE_EXIT;
+	return 0;
+}
+
+const struct proc_provider proc_provider_darwin = {
+	.name = "darwin",
+	.get_info = darwin_get_info,
+	.get_dirty = darwin_get_dirty,
+};
+#else
+// <linux/sched.h>
+#define PF_EXITING 0x00000004
+#define PF_KTHREAD 0x00200000
+
+const char *proc_provider_procfs_root = "/proc";
+
+/*
+ * Reads up to bufsz - 1 bytes of a file of the pid's procfs directory into
+ * buf and terminates it. An empty file, as left by a process being reaped,
+ * is reported as ESRCH.
+ */
+static int
+procfs_read(pid_t pid, const char *file, char *buf, size_t bufsz, size_t *len)
+{
+	char path[PATH_MAX];
+	ssize_t n;
+	int fd, ret = 0;
+
+	snprintf(path, sizeof(path), "%s/%d/%s", proc_provider_procfs_root, (int)pid, file);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return errno;
+	n = read(fd, buf, bufsz - 1);
+	if (n == -1)
+		ret = errno;
+	else if (n == 0)
+		ret = ESRCH;
+	close(fd);
+	if (ret != 0)
+		return ret;
+	buf[n] = '\0';
+	*len = (size_t)n;
+	return 0;
+}
+
+static void
+procfs_parse_ids(const char *status, const char *key, unsigned int ids[4])
+{
+	const char *line = strstr(status, key);
+	if (line != NULL)
+		sscanf(line + strlen(key), "%u %u %u %u", &ids[0], &ids[1], &ids[2], &ids[3]);
+}
+
+static int
+procfs_get_info(pid_t pid, struct proc_info *info)
+{
+	char stat[1024], status[4096], elf[6];
+	unsigned int uids[4] = { 0 }, gids[4] = { 0 };
+	int ppid, pgrp, session, tty_nr, tpgid;
+	unsigned int flags;
+	char state;
+	size_t len;
+	int ret;
+
+	if ((ret = procfs_read(pid, "stat", stat, sizeof(stat), &len)) != 0)
+		return ret;
+	if ((ret = procfs_read(pid, "status", status, sizeof(status), &len)) != 0)
+		return ret;
+
+	// comm may contain spaces and parentheses, so parse from the last ')'
+	char *lparen = strchr(stat, '('), *rparen = strrchr(stat, ')');
+	if (lparen == NULL || rparen == NULL || rparen < lparen)
+		return EINVAL;
+	if (sscanf(rparen + 1, " %c %d %d %d %d %d %u", &state, &ppid, &pgrp, &session, &tty_nr, &tpgid, &flags) != 7)
+		return EINVAL;
+
+	memset(info, 0, sizeof(*info));
+	info->pid = pid;
+	info->ppid = ppid;
+	info->pgid = pgrp;
+	switch (state) {
+		case 'T':
+		case 't':
+			info->status = PROC_INFO_STATUS_STOP;
+			break;
+		case 'Z':
+		case 'X':
+			info->status = PROC_INFO_STATUS_ZOMBIE;
+			break;
+		default:
+			info->status = PROC_INFO_STATUS_RUN;
+			break;
+	}
+
+	if (flags & PF_KTHREAD)
+		info->flags |= PROC_INFO_FLAG_SYSTEM;
+	if (flags & PF_EXITING)
+		info->flags |= PROC_INFO_FLAG_INEXIT;
+	if (session == pid)
+		info->flags |= PROC_INFO_FLAG_SLEADER;
+	if (tty_nr != 0)
+		info->flags |= PROC_INFO_FLAG_CTTY | PROC_INFO_FLAG_CONTROLT;
+	const char *tracer = strstr(status, "TracerPid:");
+	if (tracer != NULL && atoi(tracer + strlen("TracerPid:")) != 0)
+		info->flags |= PROC_INFO_FLAG_TRACED;
+	// EI_CLASS follows the ELF magic, 2 is ELFCLASS64
+	if (procfs_read(pid, "exe", elf, sizeof(elf), &len) == 0 && len == 5 && memcmp(elf, "\177ELF", 4) == 0 &&
+	    elf[4] == 2)
+		info->flags |= PROC_INFO_FLAG_LP64;
+
+	// Uid:/Gid: list real, effective, saved and filesystem ids
+	procfs_parse_ids(status, "\nUid:", uids);
+	procfs_parse_ids(status, "\nGid:", gids);
+	info->ruid = uids[0];
+	info->uid = uids[1];
+	info->svuid = uids[2];
+	info->rgid = gids[0];
+	info->gid = gids[1];
+	info->svgid = gids[2];
+
+	size_t commlen = (size_t)(rparen - lparen - 1);
+	if (commlen >= sizeof(info->comm))
+		commlen = sizeof(info->comm) - 1;
+	memcpy(info->comm, lparen + 1, commlen);
+	info->comm[commlen] = '\0';
+	memcpy(info->name, info->comm, commlen + 1);
+
+	info->tdev = (uint32_t)tty_nr;
+	info->tpgid = tpgid < 0 ? 0 : (uint32_t)tpgid;
+	return 0;
+}
+
+static int
+procfs_get_dirty(pid_t pid, uint32_t *flags)
+{
+	// Linux has no dirty/idle-exit tracking
+	(void)pid;
+	(void)flags;
+	return ENOTSUP;
+}
+
+const struct proc_provider proc_provider_procfs = {
+	.name = "procfs",
+	.get_info = procfs_get_info,
+	.get_dirty = procfs_get_dirty,
+};
+#endif
+
+const struct proc_provider *
+proc_provider_default(void)
+{
+#ifdef __APPLE__
+	return &proc_provider_darwin;
+#else
+	return &proc_provider_procfs;
+#endif
+}
+
+static void
+flags_append(char *buf, size_t bufsz, const char *str)
+{
+	size_t len = strlen(buf);
+	if (len < bufsz)
+		snprintf(buf + len, bufsz - len, "%s", str);
+}
+
+void
+proc_info_print(FILE *out, const struct proc_info *info)
+{
+	static const char *const status_strs[] = {
+		[PROC_INFO_STATUS_RUN - 1] = "running",
+		[PROC_INFO_STATUS_STOP - 1] = "stopped",
+		[PROC_INFO_STATUS_LOST - 1] = "lost to control",
+		[PROC_INFO_STATUS_ZOMBIE - 1] = "zombie",
+		[PROC_INFO_STATUS_CORE - 1] = "terminated (with core)",
+		[PROC_INFO_STATUS_IDLE - 1] = "idle",
+	};
+	const char *status_str = info->status - 1 < sizeof(status_strs) / sizeof(status_strs[0])
+	    ? status_strs[info->status - 1]
+	    : "(unknown)";
+
+	fprintf(out,
+	    "bsd proc info = {\n"
+	    "\tpid = %d\n"
+	    "\tunique pid = %llu\n"
+	    "\tppid = %d\n"
+	    "\tpgid = %d\n"
+	    "\tstatus = %s\n",
+	    info->pid, (unsigned long long)info->uniqueid, info->ppid, info->pgid, status_str);
+
+	char flagsbuf[1024] = { '\0' };
+	if (info->flags & PROC_INFO_FLAG_SYSTEM)
+		flags_append(flagsbuf, sizeof(flagsbuf), "system process|");
+	if (info->flags & PROC_INFO_FLAG_TRACED)
+		flags_append(flagsbuf, sizeof(flagsbuf), "traced|");
+	if (info->flags & PROC_INFO_FLAG_INEXIT)
+		flags_append(flagsbuf, sizeof(flagsbuf), "exiting|");
+	if (info->flags & PROC_INFO_FLAG_PPWAIT)
+		flags_append(flagsbuf, sizeof(flagsbuf), "pp wait|");
+	if (info->flags & PROC_INFO_FLAG_LP64)
+		flags_append(flagsbuf, sizeof(flagsbuf), "64-bit|");
+	if (info->flags & PROC_INFO_FLAG_SLEADER)
+		flags_append(flagsbuf, sizeof(flagsbuf), "session leader|");
+	if (info->flags & PROC_INFO_FLAG_CTTY)
+		flags_append(flagsbuf, sizeof(flagsbuf), "has controlling tty|");
+	if (info->flags & PROC_INFO_FLAG_CONTROLT)
+		flags_append(flagsbuf, sizeof(flagsbuf), "has controlling terminal|");
+	if (info->flags & PROC_INFO_FLAG_THCWD)
+		flags_append(flagsbuf, sizeof(flagsbuf), "has thread with cwd|");
+
+	size_t len = strlen(flagsbuf);
+	if (len > 0) {
+		flagsbuf[len - 1] = '\0';
+	} else {
+		flags_append(flagsbuf, sizeof(flagsbuf), "(none)");
+	}
+
+	fprintf(out,
+	    "\tflags = %s\n"
+	    "\tuid = %u\n"
+	    "\tsvuid = %u\n"
+	    "\truid = %u\n"
+	    "\tgid = %u\n"
+	    "\tsvgid = %u\n"
+	    "\trgid = %u\n"
+	    "\tcomm name = %s\n"
+	    "\tlong name = %s\n"
+	    "\tcontrolling tty devnode = 0x%x\n"
+	    "\tcontrolling tty pgid = %u\n"
+	    "}\n",
+	    flagsbuf, info->uid, info->svuid, info->ruid, info->gid, info->svgid, info->rgid, info->comm, info->name,
+	    info->tdev, info->tpgid);
+}
+
+void
+proc_dirty_print(FILE *out, uint32_t flags)
+{
+	fprintf(out,
+	    "pressured exit info = {\n"
+	    "\tdirty state tracked = %d\n"
+	    "\tdirty = %d\n"
+	    "\tpressured-exit capable = %d\n"
+	    "}\n\n",
+	    !!(flags & PROC_INFO_DIRTY_TRACKED), !!(flags & PROC_INFO_DIRTY_IS_DIRTY),
+	    !!(flags & PROC_INFO_DIRTY_ALLOWS_IDLE_EXIT));
+}
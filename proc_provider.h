@@ -0,0 +1,103 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/types.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef _LAUNCHCTL_PROC_PROVIDER_H_
+#define _LAUNCHCTL_PROC_PROVIDER_H_
+
+/*
+ * Process states as named by proc_info_print. The darwin backend passes
+ * pbi_status through unchanged so its output matches Apple's launchctl;
+ * other backends map their states onto these.
+ */
+#define PROC_INFO_STATUS_RUN 1
+#define PROC_INFO_STATUS_STOP 2
+#define PROC_INFO_STATUS_LOST 3
+#define PROC_INFO_STATUS_ZOMBIE 4
+#define PROC_INFO_STATUS_CORE 5
+#define PROC_INFO_STATUS_IDLE 6
+
+#define PROC_INFO_FLAG_SYSTEM 0x0001
+#define PROC_INFO_FLAG_TRACED 0x0002
+#define PROC_INFO_FLAG_INEXIT 0x0004
+#define PROC_INFO_FLAG_PPWAIT 0x0008
+#define PROC_INFO_FLAG_LP64 0x0010
+#define PROC_INFO_FLAG_SLEADER 0x0020
+#define PROC_INFO_FLAG_CTTY 0x0040
+#define PROC_INFO_FLAG_CONTROLT 0x0080
+#define PROC_INFO_FLAG_THCWD 0x0100
+
+#define PROC_INFO_DIRTY_TRACKED 0x1
+#define PROC_INFO_DIRTY_IS_DIRTY 0x2
+#define PROC_INFO_DIRTY_ALLOWS_IDLE_EXIT 0x4
+
+struct proc_info {
+	pid_t pid;
+	uint64_t uniqueid;
+	pid_t ppid;
+	pid_t pgid;
+	uint32_t status;
+	uint32_t flags;
+	uid_t uid;
+	uid_t svuid;
+	uid_t ruid;
+	gid_t gid;
+	gid_t svgid;
+	gid_t rgid;
+	char comm[17];
+	char name[33];
+	uint32_t tdev;
+	uint32_t tpgid;
+};
+
+/*
+ * Source of the "bsd proc info" and "pressured exit info" sections of
+ * procinfo. Functions return 0 or an errno value.
+ */
+struct proc_provider {
+	const char *name;
+	int (*get_info)(pid_t pid, struct proc_info *info);
+	int (*get_dirty)(pid_t pid, uint32_t *flags);
+};
+
+#ifdef __APPLE__
+extern const struct proc_provider proc_provider_darwin;
+#else
+extern const struct proc_provider proc_provider_procfs;
+// Where <pid>/{stat,status,exe} are read from; tools point it at fixtures
+extern const char *proc_provider_procfs_root;
+#endif
+
+const struct proc_provider *proc_provider_default(void);
+void proc_info_print(FILE *out, const struct proc_info *info);
+void proc_dirty_print(FILE *out, uint32_t flags);
+#endif
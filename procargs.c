@@ -0,0 +1,274 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/types.h>
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "procargs.h"
+
+static int
+procargs_reserve(struct procargs *pa, size_t size)
+{
+	if (pa->cap >= size)
+		return 0;
+	char *buf = realloc(pa->buf, size);
+	if (buf == NULL)
+		return ENOMEM;
+	pa->buf = buf;
+	pa->cap = size;
+	return 0;
+}
+
+#ifdef __APPLE__
+static int
+procargs_read_sysctl(struct procargs *pa, pid_t pid)
+{
+	static size_t argmax = 0;
+	int ret;
+
+	if (argmax == 0) {
+		int argmax_mib[2] = { CTL_KERN, KERN_ARGMAX };
+		int32_t val;
+		size_t val_size = sizeof(val);
+		if (sysctl(argmax_mib, 2, &val, &val_size, NULL, 0) == -1)
+			return errno;
+		argmax = (size_t)val;
+	}
+
+	if ((ret = procargs_reserve(pa, argmax)) != 0)
+		return ret;
+
+	// adv_cmds/ps/print.c
+	int procargs_mib[3] = { CTL_KERN, KERN_PROCARGS2, pid };
+	pa->len = argmax;
+	if (sysctl(procargs_mib, 3, pa->buf, &pa->len, NULL, 0) == -1)
+		return errno;
+	return 0;
+}
+#else
+const char *procargs_procfs_root = "/proc";
+
+static int
+procargs_append_file(struct procargs *pa, const char *path)
+{
+	int fd, ret = 0;
+	ssize_t n;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return errno;
+
+	for (;;) {
+		if (pa->cap - pa->len < 4096 && (ret = procargs_reserve(pa, pa->cap * 2)) != 0)
+			break;
+		n = read(fd, pa->buf + pa->len, pa->cap - pa->len);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			ret = errno;
+			break;
+		}
+		if (n == 0)
+			break;
+		pa->len += (size_t)n;
+	}
+
+	close(fd);
+	return ret;
+}
+
+static int
+procargs_read_proc(struct procargs *pa, pid_t pid)
+{
+	char path[PATH_MAX], exe[4096];
+	ssize_t exelen;
+	size_t start;
+	int ret, argc = 0;
+
+	if ((ret = procargs_reserve(pa, 64 * 1024)) != 0)
+		return ret;
+
+	snprintf(path, sizeof(path), "%s/%d/exe", procargs_procfs_root, (int)pid);
+	if ((exelen = readlink(path, exe, sizeof(exe) - 1)) == -1)
+		exelen = 0;
+	exe[exelen] = '\0';
+
+	// int argc, exec_path and its terminator, then one byte of padding
+	pa->len = sizeof(int);
+	memcpy(pa->buf + pa->len, exe, (size_t)exelen + 1);
+	pa->len += (size_t)exelen + 2;
+	pa->buf[pa->len - 1] = '\0';
+
+	start = pa->len;
+	snprintf(path, sizeof(path), "%s/%d/cmdline", procargs_procfs_root, (int)pid);
+	if ((ret = procargs_append_file(pa, path)) != 0)
+		return ret;
+	for (const char *p = pa->buf + start, *end = pa->buf + pa->len; p < end; argc++) {
+		const char *nul = memchr(p, '\0', (size_t)(end - p));
+		p = nul == NULL ? end : nul + 1;
+	}
+
+	snprintf(path, sizeof(path), "%s/%d/environ", procargs_procfs_root, (int)pid);
+	if ((ret = procargs_append_file(pa, path)) != 0)
+		return ret;
+
+	// Terminate the environment the way the kernel does before apple[]
+	if ((ret = procargs_reserve(pa, pa->len + 1)) != 0)
+		return ret;
+	pa->buf[pa->len++] = '\0';
+
+	memcpy(pa->buf, &argc, sizeof(int));
+	return 0;
+}
+#endif
+
+int
+procargs_read(struct procargs *pa, pid_t pid)
+{
+	int ret;
+
+	pa->len = 0;
+	pa->argc = 0;
+#ifdef __APPLE__
+	ret = procargs_read_sysctl(pa, pid);
+#else
+	ret = procargs_read_proc(pa, pid);
+#endif
+	if (ret != 0)
+		return ret;
+	if (pa->len < sizeof(int))
+		return EINVAL;
+
+	memcpy(&pa->argc, pa->buf, sizeof(int));
+	return 0;
+}
+
+void
+procargs_destroy(struct procargs *pa)
+{
+	free(pa->buf);
+	pa->buf = NULL;
+	pa->cap = pa->len = 0;
+	pa->argc = 0;
+}
+
+static inline const char *
+skip_nuls(const char *p, const char *end)
+{
+	while (p < end && *p == '\0')
+		p++;
+	return p;
+}
+
+static inline const char *
+string_end(const char *p, const char *end)
+{
+	const char *nul = memchr(p, '\0', (size_t)(end - p));
+	return nul == NULL ? end : nul;
+}
+
+const char *
+procargs_exec_path(const struct procargs *pa)
+{
+	const char *p = pa->buf + sizeof(int);
+	const char *end = pa->buf + pa->len;
+	if (p >= end || memchr(p, '\0', (size_t)(end - p)) == NULL)
+		return NULL;
+	return p;
+}
+
+/*
+ * Positions it at argv[0]. After argc calls to procargs_next_arg() and one to
+ * procargs_begin_env() it points at the environment.
+ */
+void
+procargs_begin(const struct procargs *pa, struct procargs_iter *it)
+{
+	const char *p = pa->buf + sizeof(int);
+	const char *end = pa->buf + pa->len;
+
+	it->end = end;
+	if (p >= end) {
+		it->p = end;
+		return;
+	}
+	// skip exec_path and padding
+	it->p = skip_nuls(string_end(p, end), end);
+}
+
+bool
+procargs_next_arg(struct procargs_iter *it, const char **str, size_t *len)
+{
+	if (it->p >= it->end)
+		return false;
+	const char *e = string_end(it->p, it->end);
+	*str = it->p;
+	*len = (size_t)(e - it->p);
+	it->p = e < it->end ? e + 1 : e;
+	return true;
+}
+
+/*
+ * Skips the padding between argv and the environment. Like Apple's
+ * launchctl, a process without any environment ends up at apple[0].
+ */
+void
+procargs_begin_env(struct procargs_iter *it)
+{
+	it->p = skip_nuls(it->p, it->end);
+}
+
+bool
+procargs_next_env(struct procargs_iter *it, const char **str, size_t *len)
+{
+	if (it->p >= it->end || *it->p == '\0')
+		return false;
+	const char *e = string_end(it->p, it->end);
+	*str = it->p;
+	*len = (size_t)(e - it->p);
+	it->p = e < it->end ? e + 1 : e;
+	return true;
+}
+
+// Length of the variable name, or len if the entry has no '='
+size_t
+procargs_env_keylen(const char *str, size_t len)
+{
+	const char *eq = memchr(str, '=', len);
+	return eq == NULL ? len : (size_t)(eq - str);
+}
@@ -0,0 +1,71 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/types.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef _LAUNCHCTL_PROCARGS_H_
+#define _LAUNCHCTL_PROCARGS_H_
+
+/*
+ * Decoder for the KERN_PROCARGS2 layout:
+ *
+ *	int argc, exec_path, NUL padding, argv[0..argc), env..., NUL, apple...
+ *
+ * On Darwin the buffer comes straight from sysctl(3). Elsewhere it is
+ * assembled in the same layout from /proc/<pid>/{exe,cmdline,environ}, so
+ * the decoder behaves identically on both. The buffer is kept between calls
+ * and only grows, so decoding many processes does not reallocate.
+ */
+struct procargs {
+	char *buf;
+	size_t cap;
+	size_t len;
+	int argc;
+};
+
+struct procargs_iter {
+	const char *p;
+	const char *end;
+};
+
+#ifndef __APPLE__
+// Where <pid>/{exe,cmdline,environ} are read from; tools point it at fixtures
+extern const char *procargs_procfs_root;
+#endif
+
+int procargs_read(struct procargs *pa, pid_t pid);
+void procargs_destroy(struct procargs *pa);
+const char *procargs_exec_path(const struct procargs *pa);
+void procargs_begin(const struct procargs *pa, struct procargs_iter *it);
+bool procargs_next_arg(struct procargs_iter *it, const char **str, size_t *len);
+void procargs_begin_env(struct procargs_iter *it);
+bool procargs_next_env(struct procargs_iter *it, const char **str, size_t *len);
+size_t procargs_env_keylen(const char *str, size_t len);
+#endif
@@ -27,20 +27,25 @@
  */
 #define __APPLE_API_UNSTABLE
 
-#include <sys/sysctl.h>
-
 #include <arpa/inet.h>
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <libproc.h>
 #include <mach/mach_traps.h>
+#include <os/lock.h>
 #include <signal.h>
 #include <spawn.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <xpc/xpc.h>
 
+#include "entitlements.h"
 #include "launchctl.h"
+#include "proc_provider.h"
+#include "procargs.h"
 #include "xpc_private.h"
 
 /* #include <mach/port_descriptions.h> */
@@ -50,29 +55,9 @@ const char *mach_task_special_port_description(int port);
 
 #include <sys/proc_info.h>
 
-/* #define PRIVATE
-   #include <sys/proc_info_private.h> */
-struct proc_uniqidentifierinfo {
-	uint8_t p_uuid[16];   /* UUID of the main executable */
-	uint64_t p_uniqueid;  /* 64 bit unique identifier for process */
-	uint64_t p_puniqueid; /* unique identifier for process's parent */
-	int32_t p_idversion;  /* pid version */
-	uint32_t p_reserve2;  /* reserved for future use */
-	uint64_t p_reserve3;  /* reserved for future use */
-	uint64_t p_reserve4;  /* reserved for future use */
-};
-
-struct proc_bsdinfowithuniqid {
-	struct proc_bsdinfo pbsd;
-	struct proc_uniqidentifierinfo p_uniqidentifier;
-};
-
-#define PROC_PIDT_BSDINFOWITHUNIQID 18
-#define PROC_PIDT_BSDINFOWITHUNIQID_SIZE (sizeof(struct proc_bsdinfowithuniqid))
-/* END <sys/proc_info_private.h> */
-
 /* #include <sys/codesign.h> */
 #define CS_OPS_STATUS 0			/* return status */
+#define CS_OPS_CDHASH 5			/* get code directory hash */
 #define CS_OPS_ENTITLEMENTS_BLOB 7	/* get entitlements blob */
 #define CS_OPS_DER_ENTITLEMENTS_BLOB 16 /* get der entitlements blob */
 
@@ -113,7 +98,8 @@ typedef struct __SC_GenericBlob {
 #define CS_PLATFORM_BINARY 0x04000000		 /* this is a platform binary */
 
 #define CSMAGIC_EMBEDDED_ENTITLEMENTS 0xfade7171
-#define CSMAGIC_EMBEDDED_DER_ENTITLEMENTS = 0xfade7172
+#define CSMAGIC_EMBEDDED_DER_ENTITLEMENTS 0xfade7172
+#define CS_CDHASH_LEN 20
 /* END <System/kern/cs_blobs.h> */
 
 static char *
@@ -138,8 +124,64 @@ safe_calloc(size_t size)
 	return retval;
 }
 
+struct port_type_entry {
+	mach_port_t port;
+	char *type;
+};
+
+/*
+ * Resolved port types for this invocation, keyed by port name. A name only
+ * identifies a port while this task holds a right to it, so every entry keeps
+ * an extra send right; otherwise the name could be reused for another task's
+ * port once the caller deallocates it.
+ */
+static struct {
+	os_unfair_lock lock;
+	struct port_type_entry *entries;
+	size_t count;
+	size_t cap;
+} port_type_cache = { OS_UNFAIR_LOCK_INIT, NULL, 0, 0 };
+
 static char *
-get_port_type(mach_port_t port)
+port_type_cache_lookup(mach_port_t port)
+{
+	char *type = NULL;
+	os_unfair_lock_lock(&port_type_cache.lock);
+	for (size_t i = 0; i < port_type_cache.count; i++) {
+		if (port_type_cache.entries[i].port == port) {
+			type = safe_strdup(port_type_cache.entries[i].type);
+			break;
+		}
+	}
+	os_unfair_lock_unlock(&port_type_cache.lock);
+	return type;
+}
+
+static void
+port_type_cache_insert(mach_port_t port, const char *type)
+{
+	if (mach_port_mod_refs(mach_task_self(), port, MACH_PORT_RIGHT_SEND, 1) != KERN_SUCCESS)
+		return;
+	os_unfair_lock_lock(&port_type_cache.lock);
+	if (port_type_cache.count == port_type_cache.cap) {
+		size_t cap = port_type_cache.cap == 0 ? 32 : port_type_cache.cap * 2;
+		struct port_type_entry *entries = realloc(port_type_cache.entries, cap * sizeof(*entries));
+		if (entries == NULL) {
+			os_unfair_lock_unlock(&port_type_cache.lock);
+			mach_port_deallocate(mach_task_self(), port);
+			return;
+		}
+		port_type_cache.entries = entries;
+		port_type_cache.cap = cap;
+	}
+	port_type_cache.entries[port_type_cache.count].port = port;
+	port_type_cache.entries[port_type_cache.count].type = safe_strdup(type);
+	port_type_cache.count++;
+	os_unfair_lock_unlock(&port_type_cache.lock);
+}
+
+static char *
+resolve_port_type(mach_port_t port)
 {
 	const char *type = NULL;
 	xpc_object_t dict = NULL, reply = NULL;
@@ -166,11 +208,55 @@ get_port_type(mach_port_t port)
 		type = "unknown";
 
 port_type_end:
+	port_type_cache_insert(port, type);
+	char *retval_str = safe_strdup(type);
 	if (reply)
 		xpc_release(reply);
 	if (dict)
 		xpc_release(dict);
-	return safe_strdup(type);
+	return retval_str;
+}
+
+static char *
+get_port_type(mach_port_t port)
+{
+	char *type = port_type_cache_lookup(port);
+	if (type == NULL)
+		type = resolve_port_type(port);
+	return type;
+}
+
+/*
+ * Resolves every uncached port in ports, LAUNCHCTL_REQUEST_WIDTH at a
+ * time, so that a task with many special and exception ports costs a few
+ * launchd round trips instead of one per port. Later get_port_type() calls
+ * are answered from the cache.
+ */
+static void
+prefetch_port_types(const mach_port_t *ports, size_t count)
+{
+	mach_port_t *pending = safe_calloc((count + 1) * sizeof(mach_port_t));
+	size_t npending = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if (!MACH_PORT_VALID(ports[i]) || ports[i] == mach_host_self())
+			continue;
+		char *cached = port_type_cache_lookup(ports[i]);
+		if (cached != NULL) {
+			free(cached);
+			continue;
+		}
+		bool dup = false;
+		for (size_t j = 0; j < npending && !dup; j++)
+			dup = pending[j] == ports[i];
+		if (!dup)
+			pending[npending++] = ports[i];
+	}
+
+	launchctl_concurrent_apply(npending, LAUNCHCTL_REQUEST_WIDTH, ^(size_t i) {
+	    free(resolve_port_type(pending[i]));
+	});
+	free(pending);
 }
 
 // hostinfo: isproc == 0, procinfo: isproc == 1
@@ -178,7 +264,7 @@ port_type_end:
  * This functions CONSUMES the old_behaviors!
 */
 static void
-print_exception_port_info(int64_t isproc, exception_mask_array_t masks, mach_msg_type_number_t masksCnt,
+print_exception_port_info(FILE *out, int64_t isproc, exception_mask_array_t masks, mach_msg_type_number_t masksCnt,
     exception_handler_array_t old_handlers)
 {
 	if (masksCnt == 0)
@@ -188,79 +274,79 @@ print_exception_port_info(int64_t isproc, exception_mask_array_t masks, mach_msg
 			continue;
 		char *info = get_port_type(old_handlers[i]);
 		if (isproc) {
-			printf("\t");
+			fprintf(out, "\t");
 		}
 		if (info[0] == '(') {
-			printf("exception port = 0x%x %s\n", old_handlers[i], info);
+			fprintf(out, "exception port = 0x%x %s\n", old_handlers[i], info);
 		} else {
-			printf("exception port = 0x%x (%s)\n", old_handlers[i], info);
+			fprintf(out, "exception port = 0x%x (%s)\n", old_handlers[i], info);
 		}
 		free(info);
 		exception_mask_t mask = masks[i];
 		if ((mask >> EXC_BAD_ACCESS) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_BAD_ACCESS\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_BAD_ACCESS\n");
 		}
 		if ((mask >> EXC_BAD_INSTRUCTION) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_BAD_INSTRUCTION\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_BAD_INSTRUCTION\n");
 		}
 		if ((mask >> EXC_ARITHMETIC) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_ARITHMETIC\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_ARITHMETIC\n");
 		}
 		if ((mask >> EXC_EMULATION) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_EMULATION\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_EMULATION\n");
 		}
 		if ((mask >> EXC_SOFTWARE) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_SOFTWARE\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_SOFTWARE\n");
 		}
 		if ((mask >> EXC_BREAKPOINT) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_BREAKPOINT\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_BREAKPOINT\n");
 		}
 		if ((mask >> EXC_SYSCALL) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_SYSCALL\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_SYSCALL\n");
 		}
 		if ((mask >> EXC_MACH_SYSCALL) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_MACH_SYSCALL\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_MACH_SYSCALL\n");
 		}
 		if ((mask >> EXC_RPC_ALERT) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_RPC_ALERT\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_RPC_ALERT\n");
 		}
 		if ((mask >> EXC_CRASH) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_CRASH\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_CRASH\n");
 		}
 		if ((mask >> EXC_RESOURCE) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_RESOURCE\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_RESOURCE\n");
 		}
 		if ((mask >> EXC_GUARD) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_GUARD\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_GUARD\n");
 		}
 		if ((mask >> EXC_CORPSE_NOTIFY) & 1) {
 			if (isproc)
-				printf("\t");
-			printf("\tEXC_CORPSE_NOTIFY\n");
+				fprintf(out, "\t");
+			fprintf(out, "\tEXC_CORPSE_NOTIFY\n");
 		}
 		mach_port_deallocate(mach_task_self(), old_handlers[i]);
 	}
@@ -316,7 +402,14 @@ xpc_object_t
 get_entitlements(pid_t pid, audit_token_t *token)
 {
 	xpc_object_t xdict = NULL;
-	xpc_object_t xdata = get_entitlements_internal(pid, token, CS_OPS_ENTITLEMENTS_BLOB);
+	xpc_object_t xdata = get_entitlements_internal(pid, token, CS_OPS_DER_ENTITLEMENTS_BLOB);
+	if (xdata) {
+		xdict = launchctl_entitlements_from_der(xpc_data_get_bytes_ptr(xdata), xpc_data_get_length(xdata));
+		xpc_release(xdata);
+		if (xdict)
+			return xdict;
+	}
+	xdata = get_entitlements_internal(pid, token, CS_OPS_ENTITLEMENTS_BLOB);
 	if (xdata) {
 		xdict = xpc_create_from_plist(xpc_data_get_bytes_ptr(xdata), xpc_data_get_length(xdata));
 		xpc_release(xdata);
@@ -324,27 +417,100 @@ get_entitlements(pid_t pid, audit_token_t *token)
 	return xdict;
 }
 
-int
-procinfo_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+struct entitlements_entry {
+	uint64_t uniqueid;
+	bool have_cdhash;
+	uint8_t cdhash[CS_CDHASH_LEN];
+	xpc_object_t entitlements; // NULL if the process has none
+};
+
+// Decoded entitlements for this invocation, keyed by unique pid and by cdhash
+static struct {
+	os_unfair_lock lock;
+	struct entitlements_entry *entries;
+	size_t count;
+	size_t cap;
+} entitlements_cache = { OS_UNFAIR_LOCK_INIT, NULL, 0, 0 };
+
+static bool
+entitlements_cache_lookup(uint64_t uniqueid, const uint8_t *cdhash, xpc_object_t *entitlements)
 {
-	if (argc < 2)
-		return EUSAGE;
+	bool found = false;
+	os_unfair_lock_lock(&entitlements_cache.lock);
+	for (size_t i = 0; i < entitlements_cache.count && !found; i++) {
+		struct entitlements_entry *e = &entitlements_cache.entries[i];
+		if (uniqueid != 0 && e->uniqueid == uniqueid)
+			found = true;
+		else if (cdhash != NULL && e->have_cdhash && memcmp(e->cdhash, cdhash, CS_CDHASH_LEN) == 0)
+			found = true;
+		if (found)
+			*entitlements = e->entitlements != NULL ? xpc_retain(e->entitlements) : NULL;
+	}
+	os_unfair_lock_unlock(&entitlements_cache.lock);
+	return found;
+}
+
+static void
+entitlements_cache_insert(uint64_t uniqueid, const uint8_t *cdhash, xpc_object_t entitlements)
+{
+	os_unfair_lock_lock(&entitlements_cache.lock);
+	if (entitlements_cache.count == entitlements_cache.cap) {
+		size_t cap = entitlements_cache.cap == 0 ? 64 : entitlements_cache.cap * 2;
+		struct entitlements_entry *entries = realloc(entitlements_cache.entries, cap * sizeof(*entries));
+		if (entries == NULL) {
+			os_unfair_lock_unlock(&entitlements_cache.lock);
+			return;
+		}
+		entitlements_cache.entries = entries;
+		entitlements_cache.cap = cap;
+	}
+	struct entitlements_entry *e = &entitlements_cache.entries[entitlements_cache.count++];
+	e->uniqueid = uniqueid;
+	e->have_cdhash = cdhash != NULL;
+	if (cdhash != NULL)
+		memcpy(e->cdhash, cdhash, CS_CDHASH_LEN);
+	e->entitlements = entitlements != NULL ? xpc_retain(entitlements) : NULL;
+	os_unfair_lock_unlock(&entitlements_cache.lock);
+}
+
+/*
+ * Processes running the same code share their entitlements, so once a cdhash
+ * has been decoded every other process with it only costs a CS_OPS_CDHASH.
+ */
+static xpc_object_t
+get_entitlements_cached(pid_t pid, uint64_t uniqueid)
+{
+	uint8_t cdhash[CS_CDHASH_LEN];
+	xpc_object_t ents = NULL;
 
-	pid_t pid = strtol(argv[1], NULL, 0);
+	if (uniqueid != 0 && entitlements_cache_lookup(uniqueid, NULL, &ents))
+		return ents;
 
-	if (!pid)
-		return EUSAGE;
-	if (pid == -1)
-		pid = getpid();
+	bool have_cdhash = csops(pid, CS_OPS_CDHASH, cdhash, sizeof(cdhash)) == 0;
+	if (have_cdhash && entitlements_cache_lookup(0, cdhash, &ents))
+		return ents;
+
+	ents = get_entitlements(pid, NULL);
+	entitlements_cache_insert(uniqueid, have_cdhash ? cdhash : NULL, ents);
+	return ents;
+}
 
+/*
+ * Prints everything known about pid to out, and what could not be found out
+ * to err, decoding its arguments into procargs.
+ */
+static void
+procinfo_print(FILE *out, FILE *err, struct procargs *procargs, pid_t pid)
+{
+	uint64_t uniqueid = 0;
 	char path[PATH_MAX];
 	memset(path, 0xaa, PATH_MAX);
 	int retval = proc_pidpath(pid, path, PATH_MAX);
 
 	if (retval < 1) {
-		printf("program path = (could not resolve path)\n");
+		fprintf(out, "program path = (could not resolve path)\n");
 	} else {
-		printf("program path = %s\n", path);
+		fprintf(out, "program path = %s\n", path);
 	}
 
 	mach_port_t task = 0;
@@ -352,7 +518,7 @@ procinfo_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple
 
 	if (kr != 0) {
 		// Yes, this goes to stdout
-		printf("Could not print Mach info for pid %d: 0x%x\n", pid, kr);
+		fprintf(out, "Could not print Mach info for pid %d: 0x%x\n", pid, kr);
 		goto procinfo_proc_info;
 	}
 
@@ -366,204 +532,124 @@ procinfo_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple
 
 	if (kr != 0) {
 		// this goes to stdout as well
-		printf("Could not print Mach exception info for pid %d: 0x%x\n", pid, kr);
+		fprintf(out, "Could not print Mach exception info for pid %d: 0x%x\n", pid, kr);
 		goto procinfo_proc_info;
 	}
 
-	printf("mach info = {\n");
+	// Special ports first, exception handlers after, resolved in one batch
+	mach_port_t task_ports[TASK_MAX_SPECIAL_PORT + EXC_TYPES_COUNT];
+	bool have_port[TASK_MAX_SPECIAL_PORT];
 	for (int i = 0; i < TASK_MAX_SPECIAL_PORT; i++) {
-		mach_port_t port;
-		kr = task_get_special_port(task, i, &port);
-		if (kr != 0)
+		have_port[i] = task_get_special_port(task, i, &task_ports[i]) == 0;
+		if (!have_port[i])
+			task_ports[i] = MACH_PORT_NULL;
+	}
+	memcpy(&task_ports[TASK_MAX_SPECIAL_PORT], old_handlers, masksCnt * sizeof(mach_port_t));
+	prefetch_port_types(task_ports, TASK_MAX_SPECIAL_PORT + masksCnt);
+
+	fprintf(out, "mach info = {\n");
+	for (int i = 0; i < TASK_MAX_SPECIAL_PORT; i++) {
+		mach_port_t port = task_ports[i];
+		if (!have_port[i])
 			continue;
 		char *port_info = get_port_type(port);
 		const char *port_description = mach_task_special_port_description(i);
 		if (port_info[0] == '(') {
-			printf("\ttask-%s port = 0x%x %s\n", port_description, port, port_info);
+			fprintf(out, "\ttask-%s port = 0x%x %s\n", port_description, port, port_info);
 		} else {
-			printf("\ttask-%s port = 0x%x (%s)\n", port_description, port, port_info);
+			fprintf(out, "\ttask-%s port = 0x%x (%s)\n", port_description, port, port_info);
 		}
 		kr = mach_port_deallocate(mach_task_self(), port);
 		free(port_info);
 	}
-	print_exception_port_info(1, masks, masksCnt, old_handlers);
-	printf("}\n");
+	print_exception_port_info(out, 1, masks, masksCnt, old_handlers);
+	fprintf(out, "}\n");
 
 procinfo_proc_info : {
 }
 	if (task)
 		mach_port_deallocate(mach_task_self(), task);
 
-	struct proc_bsdinfowithuniqid procinfo;
-	retval = proc_pidinfo(pid, PROC_PIDT_BSDINFOWITHUNIQID, 1, &procinfo, sizeof(struct proc_bsdinfowithuniqid));
-	char *procargs = NULL; // declare here because of goto
-
-	if (retval != sizeof(struct proc_bsdinfowithuniqid)) {
-		fprintf(stderr, "Could not get proc info PID %d: %d: %s\n", pid, errno, strerror(errno));
-		goto procinfo_pressured_exit_info;
-	}
-
-	int argmax_mib[2] = { CTL_KERN, KERN_ARGMAX };
-	int32_t argmax;
-	size_t argmax_size = sizeof(int32_t);
-	retval = sysctl(argmax_mib, 2, &argmax, &argmax_size, NULL, 0);
+	const struct proc_provider *provider = proc_provider_default();
+	struct proc_info procinfo;
+	retval = provider->get_info(pid, &procinfo);
 
 	if (retval) {
-		fprintf(stderr, "Could not get max argument size: %d: %s\n", errno, strerror(errno));
+		fprintf(err, "Could not get proc info PID %d: %d: %s\n", pid, retval, strerror(retval));
 		goto procinfo_pressured_exit_info;
 	}
+	uniqueid = procinfo.uniqueid;
 
-	procargs = safe_calloc((size_t)argmax);
-	size_t argmax2 = (size_t)argmax;
-	int procargs_mib[3] = { CTL_KERN, KERN_PROCARGS2, pid };
-	// adv_cmds/ps/print.c
-	retval = sysctl(procargs_mib, 3, procargs, &argmax2, NULL, 0);
+	retval = procargs_read(procargs, pid);
 
 	if (retval) {
-		fprintf(stderr, "Could not get process arguments: %d: %s\n", errno, strerror(errno));
+		fprintf(err, "Could not get process arguments: %d: %s\n", retval, strerror(retval));
 		goto procinfo_pressured_exit_info;
 	}
 
-	int proc_argc = *(int *)procargs;
-
-	if (proc_argc < 0) {
-		fprintf(stderr, "Process had negative number of arguments. Kernel bug?\n");
+	if (procargs->argc < 0) {
+		fprintf(err, "Process had negative number of arguments. Kernel bug?\n");
 		goto procinfo_pressured_exit_info;
 	}
 
-	printf("argument count = %d\n", proc_argc);
+	fprintf(out, "argument count = %d\n", procargs->argc);
 
-	char *p = procargs;
-	for (p += 4; *p != '\0' && p < &procargs[argmax]; p++)
-		; /* skip args and exec_path */
-	assert(p < &procargs[argmax]);
-
-	for (; *p == '\0' && p < &procargs[argmax]; p++)
-		; /* skip padding */
-	assert(p < &procargs[argmax]);
+	struct procargs_iter it;
+	const char *str;
+	size_t len;
+	procargs_begin(procargs, &it);
 
 	// reached argv[0]
-	printf("argument vector = {\n");
-	for (int32_t i = 0; i < proc_argc && p < &procargs[argmax]; i++) {
-		printf("\t[%d] = %s\n", i, p);
-		p += strlen(p);
-		for (; *p == '\0' && p < &procargs[argmax]; p++)
-			; /* skip padding */
-	}
-	printf("}\n");
+	fprintf(out, "argument vector = {\n");
+	for (int32_t i = 0; i < procargs->argc && procargs_next_arg(&it, &str, &len); i++)
+		fprintf(out, "\t[%d] = %.*s\n", i, (int)len, str);
+	fprintf(out, "}\n");
 
 	// Bug-to-bug compatibility: If process has no environment at all Apple's
 	// launchctl will print the first element in apple (ptr_munge) so we do that too.
-	for (; *p == '\0' && p < &procargs[argmax]; p++)
-		; /* skip padding (or nonexistent environment) */
+	procargs_begin_env(&it);
 
 	// Now print environment (or ptr_munge)
-	printf("environment vector = {\n");
-	while (p < &procargs[argmax] && *p != '\0') {
-		char *eq = strrchr(p, '=');
-		if (!eq) {
-			printf("\t%s (malformed)\n", p);
-		} else {
-			*eq = '\0';
-			printf("\t%s => %s\n", p, eq + 1);
-			*eq = '=';
-		}
-		p += strlen(p);
-		p++;
-	}
-
-	printf("}\n");
-
-	static const char *const status_strs[] = { "running", "stopped", "lost to control", "zombie",
-		"terminated (with core)", "idle" };
-	const char *status_str = procinfo.pbsd.pbi_status < 7 ? status_strs[procinfo.pbsd.pbi_status - 1] : "(unknown)";
-
-	printf("bsd proc info = {\n"
-	       "\tpid = %d\n"
-	       "\tunique pid = %llu\n"
-	       "\tppid = %d\n"
-	       "\tpgid = %d\n"
-	       "\tstatus = %s\n",
-	    procinfo.pbsd.pbi_pid, procinfo.p_uniqidentifier.p_uniqueid, procinfo.pbsd.pbi_ppid, procinfo.pbsd.pbi_pgid,
-	    status_str);
-
-	char flagsbuf[1024] = { '\0' };
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_SYSTEM)
-		strlcat(flagsbuf, "system process|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_TRACED)
-		strlcat(flagsbuf, "traced|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_INEXIT)
-		strlcat(flagsbuf, "exiting|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_PPWAIT)
-		strlcat(flagsbuf, "pp wait|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_LP64)
-		strlcat(flagsbuf, "64-bit|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_SLEADER)
-		strlcat(flagsbuf, "session leader|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_CTTY)
-		strlcat(flagsbuf, "has controlling tty|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_CONTROLT)
-		strlcat(flagsbuf, "has controlling terminal|", 1024);
-	if (procinfo.pbsd.pbi_flags & PROC_FLAG_THCWD)
-		strlcat(flagsbuf, "has thread with cwd|", 1024);
-
-	size_t len = strlen(flagsbuf);
-	if (len > 0) {
-		flagsbuf[len - 1] = '\0';
-	} else {
-		strlcat(flagsbuf, "(none)", 1024);
-	}
-
-	printf("\tflags = %s\n"
-	       "\tuid = %u\n"
-	       "\tsvuid = %u\n"
-	       "\truid = %u\n"
-	       "\tgid = %u\n"
-	       "\tsvgid = %u\n"
-	       "\trgid = %u\n"
-	       "\tcomm name = %s\n"
-	       "\tlong name = %s\n"
-	       "\tcontrolling tty devnode = 0x%x\n"
-	       "\tcontrolling tty pgid = %u\n"
-	       "}\n",
-	    flagsbuf, procinfo.pbsd.pbi_uid, procinfo.pbsd.pbi_svuid, procinfo.pbsd.pbi_ruid, procinfo.pbsd.pbi_gid,
-	    procinfo.pbsd.pbi_svgid, procinfo.pbsd.pbi_rgid, procinfo.pbsd.pbi_comm, procinfo.pbsd.pbi_name,
-	    procinfo.pbsd.e_tdev, procinfo.pbsd.e_tpgid);
+	fprintf(out, "environment vector = {\n");
+	while (procargs_next_env(&it, &str, &len)) {
+		size_t keylen = procargs_env_keylen(str, len);
+		if (keylen == len)
+			fprintf(out, "\t%.*s (malformed)\n", (int)len, str);
+		else
+			fprintf(out, "\t%.*s => %.*s\n", (int)keylen, str, (int)(len - keylen - 1), str + keylen + 1);
+	}
+
+	fprintf(out, "}\n");
+
+	proc_info_print(out, &procinfo);
 
 procinfo_pressured_exit_info : {
 }
-	free(procargs);
 	uint32_t dflags;
-	retval = proc_get_dirty(pid, &dflags);
+	retval = provider->get_dirty(pid, &dflags);
 	if (retval) {
-		fprintf(stderr, "proc_get_dirty(): %d: %s\n", errno, strerror(errno));
+		fprintf(err, "proc_get_dirty(): %d: %s\n", retval, strerror(retval));
 		goto procinfo_entitlements;
 	}
-	printf("pressured exit info = {\n"
-	       "\tdirty state tracked = %d\n"
-	       "\tdirty = %d\n"
-	       "\tpressured-exit capable = %d\n"
-	       "}\n\n",
-	    !!(dflags & PROC_DIRTY_TRACKED), !!(dflags & PROC_DIRTY_IS_DIRTY),
-	    !!(dflags & PROC_DIRTY_ALLOWS_IDLE_EXIT));
+	proc_dirty_print(out, dflags);
 
 procinfo_entitlements : {
 }
-	xpc_object_t xents = get_entitlements(pid, NULL);
+	xpc_object_t xents = get_entitlements_cached(pid, uniqueid);
 	if (!xents) {
-		printf("entitlements = (no entitlements)\n");
+		fprintf(out, "entitlements = (no entitlements)\n");
 		goto procinfo_cs_info;
 	}
-	printf("entitlements = "); // unquoted so we print it here
-	launchctl_xpc_object_print(xents, NULL, 0);
+	fprintf(out, "entitlements = "); // unquoted so we print it here
+	launchctl_xpc_object_fprint(out, xents, NULL, 0);
 	xpc_release(xents);
-	printf("\n");
+	fprintf(out, "\n");
 procinfo_cs_info : {
 }
 	uint32_t csflags;
 	retval = csops(pid, CS_OPS_STATUS, &csflags, sizeof(uint32_t));
 	if (retval) {
-		printf("Could not get code signing info: %d: %s\n", errno, strerror(errno));
+		fprintf(out, "Could not get code signing info: %d: %s\n", errno, strerror(errno));
 		goto procinfo_launchd_info;
 	}
 
@@ -601,51 +687,251 @@ procinfo_cs_info : {
 	if (csflags & CS_PLATFORM_BINARY)
 		strlcat(cs_info_str, "\n\tplatform binary", 1024);
 
-	printf("code signing info = %s\n", cs_info_str);
+	fprintf(out, "code signing info = %s\n", cs_info_str);
 
 procinfo_launchd_info : {
 }
-	printf("\n");
+	fprintf(out, "\n");
 	xpc_object_t dict, reply;
 	vm_address_t addr;
 	vm_size_t sz = 0x100000;
 	dict = xpc_dictionary_create(NULL, NULL, 0);
 	xpc_dictionary_set_int64(dict, "pid", pid);
 
+	FILE *tmp = NULL;
+
 	if (__builtin_available(macOS 12.0, iOS 15.0, tvOS 15.0, watchOS 8.0, bridgeOS 6.0, *)) {
 		addr = launchctl_create_shmem(dict, sz);
-	} else {
+	} else if (out == stdout || (tmp = tmpfile()) == NULL) {
 		xpc_dictionary_set_fd(dict, "fd", STDOUT_FILENO);
+	} else {
+		// launchd writes straight to the fd, so stage it for buffered output
+		xpc_dictionary_set_fd(dict, "fd", fileno(tmp));
 	}
 	retval = launchctl_send_xpc_to_launchd(XPC_ROUTINE_PRINT_SERVICE, dict, &reply);
 	if (retval == 0) {
 		if (__builtin_available(macOS 12.0, iOS 15.0, tvOS 15.0, watchOS 8.0, bridgeOS 6.0, *)) {
-			launchctl_print_shmem(reply, addr, sz, stdout);
+			launchctl_print_shmem(reply, addr, sz, out);
 			vm_deallocate(mach_task_self(), addr, sz);
+		} else if (tmp != NULL) {
+			char buf[4096];
+			size_t n;
+			rewind(tmp);
+			while ((n = fread(buf, 1, sizeof(buf), tmp)) != 0)
+				fwrite(buf, 1, n, out);
 		}
 	} else {
 		if (retval == EINVAL)
-			fprintf(stderr, "Bad request.\n");
+			fprintf(err, "Bad request.\n");
 		else if (retval == ENOSERVICE)
-			printf("(pid %d is not managed by launchd)\n", pid);
+			fprintf(out, "(pid %d is not managed by launchd)\n", pid);
+		else
+			fprintf(err, "Could not print service: %d: %s\n", retval, xpc_strerror(retval));
+	}
+	if (tmp != NULL)
+		fclose(tmp);
+	fprintf(out, "\n");
+}
+
+struct pid_list {
+	pid_t *pids;
+	size_t count;
+	size_t cap;
+};
+
+static void
+pid_list_append(struct pid_list *list, pid_t pid)
+{
+	if (list->count == list->cap) {
+		list->cap = list->cap == 0 ? 64 : list->cap * 2;
+		pid_t *pids = safe_calloc(list->cap * sizeof(pid_t));
+		if (list->count != 0)
+			memcpy(pids, list->pids, list->count * sizeof(pid_t));
+		free(list->pids);
+		list->pids = pids;
+	}
+	list->pids[list->count++] = pid;
+}
+
+static int
+compare_pids(const void *a, const void *b)
+{
+	pid_t x = *(const pid_t *)a, y = *(const pid_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static int
+procinfo_add_all_pids(struct pid_list *list)
+{
+	int count = proc_listallpids(NULL, 0);
+	if (count <= 0)
+		return errno;
+
+	// Leave some room for processes spawned in between the two calls
+	size_t cap = (size_t)count + 64;
+	pid_t *pids = safe_calloc(cap * sizeof(pid_t));
+	count = proc_listallpids(pids, (int)(cap * sizeof(pid_t)));
+	for (int i = 0; i < count; i++) {
+		if (pids[i] != 0)
+			pid_list_append(list, pids[i]);
+	}
+	free(pids);
+	return 0;
+}
+
+static int
+procinfo_add_service_pids(xpc_object_t *msg, char *target, struct pid_list *list)
+{
+	xpc_object_t dict, services;
+	const char *name = NULL;
+	int ret;
+
+	// Only the last --service is kept for the messages printed by main()
+	dict = xpc_dictionary_create(NULL, NULL, 0);
+	if (*msg != NULL)
+		xpc_release(*msg);
+	*msg = dict;
+	if ((ret = launchctl_setup_xpc_dict_for_service_name(target, dict, &name)) != 0)
+		return ret;
+	if ((ret = launchctl_copy_service_list(dict, &services)) != 0)
+		return ret;
+
+	if (name != NULL) {
+		xpc_object_t service = xpc_dictionary_get_value(services, name);
+		if (service == NULL)
+			ret = ENOSERVICE;
+		else if (xpc_dictionary_get_int64(service, "pid") == 0)
+			fprintf(stderr, "%s is not running.\n", name);
 		else
-			fprintf(stderr, "Could not print service: %d: %s\n", retval, xpc_strerror(retval));
+			pid_list_append(list, (pid_t)xpc_dictionary_get_int64(service, "pid"));
+	} else {
+		(void)xpc_dictionary_apply(services, ^bool(const char *key, xpc_object_t value) {
+		    int64_t pid = xpc_dictionary_get_int64(value, "pid");
+		    if (pid != 0)
+			    pid_list_append(list, (pid_t)pid);
+		    return true;
+		});
+	}
+
+	xpc_release(services);
+	return ret;
+}
+
+int
+procinfo_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+{
+	if (argc < 2)
+		return EUSAGE;
+
+	struct pid_list list = { NULL, 0, 0 };
+	size_t width = 8;
+	int ret = 0;
+
+	*msg = NULL;
+
+	// Parsed by hand because "-1" is a valid pid argument
+	for (int i = 1; i < argc && ret == 0; i++) {
+		if (strcmp(argv[i], "--all") == 0) {
+			ret = procinfo_add_all_pids(&list);
+		} else if (strcmp(argv[i], "--service") == 0) {
+			if (++i == argc)
+				ret = EUSAGE;
+			else
+				ret = procinfo_add_service_pids(msg, argv[i], &list);
+		} else if (strcmp(argv[i], "--jobs") == 0) {
+			if (++i == argc || (width = strtoul(argv[i], NULL, 10)) == 0)
+				ret = EUSAGE;
+		} else {
+			pid_t pid = strtol(argv[i], NULL, 0);
+			if (!pid)
+				ret = EUSAGE;
+			else
+				pid_list_append(&list, pid == -1 ? getpid() : pid);
+		}
+	}
+
+	if (ret != 0 || list.count == 0) {
+		free(list.pids);
+		return ret;
+	}
+
+	if (list.count == 1) {
+		struct procargs procargs = {};
+		procinfo_print(stdout, stderr, &procargs, list.pids[0]);
+		procargs_destroy(&procargs);
+		free(list.pids);
+		return 0;
 	}
-	printf("\n");
+
+	qsort(list.pids, list.count, sizeof(pid_t), compare_pids);
+	size_t n = 0;
+	for (size_t i = 0; i < list.count; i++) {
+		if (n == 0 || list.pids[n - 1] != list.pids[i])
+			list.pids[n++] = list.pids[i];
+	}
+
+	/*
+	 * Every process renders its output and its errors into buffers of its
+	 * own, which are then written out in pid order. At most width workers
+	 * run at once, so that many decode buffers are shared among them.
+	 */
+	char **bufs = safe_calloc(n * sizeof(char *)), **errbufs = safe_calloc(n * sizeof(char *));
+	size_t *lens = safe_calloc(n * sizeof(size_t)), *errlens = safe_calloc(n * sizeof(size_t));
+	struct procargs *pool = safe_calloc(width * sizeof(struct procargs));
+	bool *busy = safe_calloc(width * sizeof(bool));
+	__block os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+	pid_t *pids = list.pids;
+	launchctl_concurrent_apply(n, width, ^(size_t i) {
+	    FILE *out = open_memstream(&bufs[i], &lens[i]), *err = open_memstream(&errbufs[i], &errlens[i]);
+	    size_t slot = 0;
+	    if (out != NULL && err != NULL) {
+		    os_unfair_lock_lock(&lock);
+		    while (busy[slot])
+			    slot++;
+		    busy[slot] = true;
+		    os_unfair_lock_unlock(&lock);
+		    procinfo_print(out, err, &pool[slot], pids[i]);
+		    os_unfair_lock_lock(&lock);
+		    busy[slot] = false;
+		    os_unfair_lock_unlock(&lock);
+	    }
+	    if (out != NULL)
+		    fclose(out);
+	    if (err != NULL)
+		    fclose(err);
+	});
+
+	for (size_t i = 0; i < n; i++) {
+		printf("procinfo for pid %d:\n", pids[i]);
+		if (bufs[i] != NULL)
+			fwrite(bufs[i], 1, lens[i], stdout);
+		if (errbufs[i] != NULL && errlens[i] != 0) {
+			fflush(stdout);
+			fwrite(errbufs[i], 1, errlens[i], stderr);
+		}
+		free(bufs[i]);
+		free(errbufs[i]);
+	}
+
+	for (size_t i = 0; i < width; i++)
+		procargs_destroy(&pool[i]);
+	free(pool);
+	free(busy);
+	free(bufs);
+	free(errbufs);
+	free(lens);
+	free(errlens);
+	free(list.pids);
 	return 0;
 }
 
 int
 hostinfo_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
 {
+	mach_port_t host_ports[HOST_MAX_SPECIAL_PORT + EXC_TYPES_COUNT];
 	for (int i = 0; i < HOST_MAX_SPECIAL_PORT; i++) {
-		mach_port_t port;
-		int retval = host_get_special_port(mach_host_self(), HOST_LOCAL_NODE, i, &port);
-		if (retval || !MACH_PORT_VALID(port))
-			continue;
-		char *type = get_port_type(port);
-		printf("host-%s port = 0x%x %s\n", mach_host_special_port_description(i), port, type);
-		free(type);
+		if (host_get_special_port(mach_host_self(), HOST_LOCAL_NODE, i, &host_ports[i]) != 0)
+			host_ports[i] = MACH_PORT_NULL;
 	}
 
 	exception_mask_t masks[EXC_TYPES_COUNT];
@@ -655,10 +941,25 @@ hostinfo_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple
 	thread_state_flavor_t old_flavors[EXC_TYPES_COUNT];
 	kern_return_t kr = host_get_exception_ports(mach_host_self(), 0x3ffe, masks, &masksCnt, old_handlers,
 	    old_behaviors, old_flavors);
+
+	if (kr != 0)
+		masksCnt = 0;
+	memcpy(&host_ports[HOST_MAX_SPECIAL_PORT], old_handlers, masksCnt * sizeof(mach_port_t));
+	prefetch_port_types(host_ports, HOST_MAX_SPECIAL_PORT + masksCnt);
+
+	for (int i = 0; i < HOST_MAX_SPECIAL_PORT; i++) {
+		mach_port_t port = host_ports[i];
+		if (!MACH_PORT_VALID(port))
+			continue;
+		char *type = get_port_type(port);
+		printf("host-%s port = 0x%x %s\n", mach_host_special_port_description(i), port, type);
+		free(type);
+	}
+
 	if (kr) {
 		fprintf(stderr, "host_get_exception_ports(): 0x%x\n", kr);
 	} else {
-		print_exception_port_info(0, masks, masksCnt, old_handlers);
+		print_exception_port_info(stdout, 0, masks, masksCnt, old_handlers);
 	}
 	return 0;
 }
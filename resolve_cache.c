@@ -0,0 +1,236 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <xpc/xpc.h>
+
+#include "launchctl.h"
+#include "xpc_private.h"
+
+#define RESOLVE_CACHE_TTL 5
+// The file is started over once it grows past this
+#define RESOLVE_CACHE_FILE_MAX (64 << 10)
+
+/*
+ * Remembers which type of domain a bare system/<name> target resolved to,
+ * so that repeating a command against it does not probe launchd again. Only
+ * domains that answered a probe are recorded. The handle is not: for the
+ * foreground user's domain it is asked for again on every use, since the
+ * foreground user can change while an entry is live. Entries live for
+ * LAUNCHCTL_RESOLVE_CACHE_TTL seconds (default 5), and with
+ * LAUNCHCTL_RESOLVE_CACHE=<file> they are also shared between processes
+ * through that file, one "<expiry> <type> <name>" per line.
+ */
+struct resolve_entry {
+	char *name;
+	uint64_t type;
+	time_t expires;
+};
+
+static pthread_mutex_t resolve_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct resolve_entry *entries;
+static size_t nentries, capentries;
+static const char *resolve_path;
+static time_t resolve_ttl = RESOLVE_CACHE_TTL;
+static bool resolve_loaded;
+
+static bool foreground_known;
+static uint64_t foreground_uid;
+
+static struct resolve_entry *
+resolve_find(const char *name)
+{
+	for (size_t i = 0; i < nentries; i++) {
+		if (strcmp(entries[i].name, name) == 0)
+			return &entries[i];
+	}
+	return NULL;
+}
+
+static void
+resolve_put(const char *name, uint64_t type, time_t expires)
+{
+	struct resolve_entry *e = resolve_find(name);
+
+	if (e == NULL) {
+		if (nentries == capentries) {
+			size_t cap = capentries == 0 ? 16 : capentries * 2;
+			struct resolve_entry *grown = realloc(entries, cap * sizeof(*entries));
+			if (grown == NULL)
+				return;
+			entries = grown;
+			capentries = cap;
+		}
+		if ((name = strdup(name)) == NULL)
+			return;
+		e = &entries[nentries++];
+		e->name = (char *)name;
+	}
+	e->type = type;
+	e->expires = expires;
+}
+
+// Another user able to write the file could point our requests at a different domain
+static bool
+resolve_file_trusted(int fd)
+{
+	struct stat sb;
+
+	return fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_uid == geteuid() &&
+	    (sb.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+static void
+resolve_load(void)
+{
+	const char *env;
+	char line[512], name[256], *end;
+	uint64_t type;
+	long long expires;
+	time_t now = time(NULL);
+	FILE *f;
+	int fd, n;
+
+	resolve_loaded = true;
+	if ((env = getenv("LAUNCHCTL_RESOLVE_CACHE_TTL")) != NULL) {
+		long ttl;
+		errno = 0;
+		ttl = strtol(env, &end, 10);
+		if (*env == '\0' || *end != '\0' || errno != 0 || ttl < 0)
+			fprintf(stderr, "Ignoring invalid LAUNCHCTL_RESOLVE_CACHE_TTL: %s\n", env);
+		else
+			resolve_ttl = ttl;
+	}
+	// A TTL of 0 turns the cache off, including entries other processes left in the file
+	if (resolve_ttl <= 0)
+		return;
+	if ((env = getenv("LAUNCHCTL_RESOLVE_CACHE")) == NULL || *env == '\0')
+		return;
+	resolve_path = env;
+
+	if ((fd = open(resolve_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC)) == -1)
+		return;
+	if (!resolve_file_trusted(fd) || (f = fdopen(fd, "r")) == NULL) {
+		close(fd);
+		return;
+	}
+	// Lines with anything after the name, like those that also had a handle, are skipped
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (sscanf(line, "%lld %" SCNu64 " %255s%n", &expires, &type, name, &n) == 3 &&
+		    (line[n] == '\n' || line[n] == '\0') && expires > now)
+			resolve_put(name, type, (time_t)expires);
+	}
+	fclose(f);
+}
+
+static void
+resolve_save(const char *name, uint64_t type, time_t expires)
+{
+	struct stat sb;
+	char line[512];
+	int fd, len;
+
+	if (resolve_path == NULL || strpbrk(name, " \t\n") != NULL)
+		return;
+	len = snprintf(line, sizeof(line), "%lld %" PRIu64 " %s\n", (long long)expires, type, name);
+	if (len < 0 || (size_t)len >= sizeof(line))
+		return;
+
+	if ((fd = open(resolve_path, O_WRONLY | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600)) == -1)
+		return;
+	if (resolve_file_trusted(fd)) {
+		if (fstat(fd, &sb) == 0 && sb.st_size > RESOLVE_CACHE_FILE_MAX)
+			ftruncate(fd, 0);
+		// One short O_APPEND write per entry, so concurrent writers do not interleave
+		(void)write(fd, line, len);
+	}
+	close(fd);
+}
+
+bool
+launchctl_resolve_cache_lookup(const char *name, uint64_t *type)
+{
+	struct resolve_entry *e;
+	bool found = false;
+
+	pthread_mutex_lock(&resolve_lock);
+	if (!resolve_loaded)
+		resolve_load();
+	if (resolve_ttl > 0 && (e = resolve_find(name)) != NULL && e->expires > time(NULL)) {
+		*type = e->type;
+		found = true;
+	}
+	pthread_mutex_unlock(&resolve_lock);
+	return found;
+}
+
+void
+launchctl_resolve_cache_store(const char *name, uint64_t type)
+{
+	pthread_mutex_lock(&resolve_lock);
+	if (!resolve_loaded)
+		resolve_load();
+	if (resolve_ttl > 0) {
+		time_t expires = time(NULL) + resolve_ttl;
+		resolve_put(name, type, expires);
+		resolve_save(name, type, expires);
+	}
+	pthread_mutex_unlock(&resolve_lock);
+}
+
+/*
+ * xpc_user_sessions_get_foreground_uid() asks launchd every time; the
+ * answer is kept for the life of the process.
+ */
+uint64_t
+launchctl_foreground_uid(void)
+{
+	uint64_t uid = 0;
+
+	pthread_mutex_lock(&resolve_lock);
+	if (!foreground_known) {
+		if (__builtin_available(macOS 13.0, iOS 16.0, tvOS 16.0, watchOS 9.0, bridgeOS 7.0, *)) {
+			foreground_uid = xpc_user_sessions_get_foreground_uid(0);
+		}
+		foreground_known = true;
+	}
+	uid = foreground_uid;
+	pthread_mutex_unlock(&resolve_lock);
+	return uid;
+}
@@ -30,17 +30,61 @@
 #include <errno.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <mach/mach_time.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
+#include "runstats_ring.h"
+#include "sketch.h"
+#include "trace.h"
 #include "xpc_private.h"
 
-static void
-print_runstats(size_t index, xpc_object_t dict, void *ctx)
+struct runstats_summary {
+	uint64_t runs;
+	uint64_t dirty_exits;
+	uint64_t idle_exits;
+	uint64_t jettisons;
+	struct sketch duration;
+	struct sketch utime;
+	struct sketch stime;
+	struct sketch maxrss;
+	struct sketch minflt;
+	struct sketch majflt;
+	struct sketch csw;
+};
+
+static const char *const runstats_columns[] = { "pid", "reason", "start", "end", "forks", "execs", "dirty_exit",
+	"idle_exit", "jettisoned", "utime_us", "stime_us", "maxrss", "minflt", "majflt", "nswap", "inblock", "oublock",
+	"msgsnd", "msgrcv", "nsignals", "nvcsw", "nivcsw" };
+#define RUNSTATS_NCOLUMNS (sizeof(runstats_columns) / sizeof(runstats_columns[0]))
+#define RUNSTATS_COLUMN_PID 0
+#define RUNSTATS_COLUMN_START 2
+#define RUNSTATS_COLUMN_END 3
+
+_Static_assert(RUNSTATS_NCOLUMNS == RUNSTATS_RING_NVALUES, "ring records must hold every runstats column");
+
+// Magic of the columnar export, "LCRS" in little-endian
+#define RUNSTATS_COLUMNAR_MAGIC 0x5352434c
+#define RUNSTATS_COLUMNAR_VERSION 1
+
+struct runstats_table {
+	size_t nservices;
+	char **services;
+	size_t nrows;
+	uint32_t *service;
+	int64_t *columns[RUNSTATS_NCOLUMNS];
+};
+
+static const struct rusage *
+runstats_get_rusage(xpc_object_t dict)
 {
 	size_t ru_len = 0;
 	const struct rusage *ru = (const struct rusage *)xpc_dictionary_get_data(dict, "rusage", &ru_len);
@@ -48,6 +92,19 @@ print_runstats(size_t index, xpc_object_t dict, void *ctx)
 		fprintf(stderr, "runstats ipc routine returned incorrectly sized struct rusage\n");
 		exit(1);
 	}
+	return ru;
+}
+
+static uint64_t
+timeval_to_usec(struct timeval tv)
+{
+	return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+static void
+print_runstats(size_t index, xpc_object_t dict, void *ctx)
+{
+	const struct rusage *ru = runstats_get_rusage(dict);
 	int64_t pid = xpc_dictionary_get_int64(dict, "pid");
 	int64_t reason = xpc_dictionary_get_int64(dict, "run-reason");
 	uint64_t start = xpc_dictionary_get_uint64(dict, "start");
@@ -90,47 +147,779 @@ print_runstats(size_t index, xpc_object_t dict, void *ctx)
 	return;
 }
 
-int
-runstats_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+// launchd stamps runs with mach_absolute_time(), whose unit depends on the hardware
+static uint64_t
+runstats_mach_to_usec(uint64_t ticks)
 {
-	if (argc != 2)
-		return EUSAGE;
+	static mach_timebase_info_data_t timebase;
 
-	xpc_object_t dict, reply;
-	const char *name = NULL;
-	xpc_object_t runs;
-	int ret;
+	if (timebase.denom == 0 && mach_timebase_info(&timebase) != KERN_SUCCESS)
+		timebase = (mach_timebase_info_data_t) { 1, 1 };
+	return (uint64_t)((double)ticks * timebase.numer / timebase.denom / 1000);
+}
 
-	dict = xpc_dictionary_create(NULL, NULL, 0);
-	*msg = dict;
+static void
+summarize_runstats(size_t index, xpc_object_t dict, void *ctx)
+{
+	struct runstats_summary *sum = ctx;
+	const struct rusage *ru = runstats_get_rusage(dict);
+	uint64_t start = xpc_dictionary_get_uint64(dict, "start");
+	uint64_t end = xpc_dictionary_get_uint64(dict, "end");
+
+	sum->runs++;
+	// Runs that are still in progress have no end time yet
+	if (end >= start)
+		sketch_add(&sum->duration, runstats_mach_to_usec(end - start));
+	sketch_add(&sum->utime, timeval_to_usec(ru->ru_utime));
+	sketch_add(&sum->stime, timeval_to_usec(ru->ru_stime));
+	sketch_add(&sum->maxrss, (uint64_t)ru->ru_maxrss);
+	sketch_add(&sum->minflt, (uint64_t)ru->ru_minflt);
+	sketch_add(&sum->majflt, (uint64_t)ru->ru_majflt);
+	sketch_add(&sum->csw, (uint64_t)(ru->ru_nvcsw + ru->ru_nivcsw));
+	if (xpc_dictionary_get_bool(dict, "dirty-exit"))
+		sum->dirty_exits++;
+	if (xpc_dictionary_get_bool(dict, "idle-exit"))
+		sum->idle_exits++;
+	if (xpc_dictionary_get_bool(dict, "jettisoned"))
+		sum->jettisons++;
+}
+
+static void
+merge_runstats_summary(struct runstats_summary *dst, const struct runstats_summary *src)
+{
+	dst->runs += src->runs;
+	dst->dirty_exits += src->dirty_exits;
+	dst->idle_exits += src->idle_exits;
+	dst->jettisons += src->jettisons;
+	sketch_merge(&dst->duration, &src->duration);
+	sketch_merge(&dst->utime, &src->utime);
+	sketch_merge(&dst->stime, &src->stime);
+	sketch_merge(&dst->maxrss, &src->maxrss);
+	sketch_merge(&dst->minflt, &src->minflt);
+	sketch_merge(&dst->majflt, &src->majflt);
+	sketch_merge(&dst->csw, &src->csw);
+}
+
+static void
+print_sketch(const char *label, const struct sketch *sk)
+{
+	printf("\t%s = { p50 = %" PRIu64 ", p90 = %" PRIu64 ", p99 = %" PRIu64 ", max = %" PRIu64 " }\n", label,
+	    sketch_quantile(sk, 0.50), sketch_quantile(sk, 0.90), sketch_quantile(sk, 0.99), sk->max);
+}
+
+static void
+print_runstats_summary(const char *name, const struct runstats_summary *sum)
+{
+	double runs = sum->runs == 0 ? 1.0 : (double)sum->runs;
 
-	if ((ret = launchctl_setup_xpc_dict_for_service_name(argv[1], dict, &name))) {
+	printf("\"%s\" = {\n", name);
+	printf("\truns = %" PRIu64 "\n", sum->runs);
+	print_sketch("duration (us)", &sum->duration);
+	print_sketch("user time (us)", &sum->utime);
+	print_sketch("system time (us)", &sum->stime);
+	print_sketch("max resident set", &sum->maxrss);
+	print_sketch("page reclaims", &sum->minflt);
+	print_sketch("page faults", &sum->majflt);
+	print_sketch("context switches", &sum->csw);
+	printf("\tdirty exit rate = %.2f%%\n", 100.0 * (double)sum->dirty_exits / runs);
+	printf("\tidle exit rate = %.2f%%\n", 100.0 * (double)sum->idle_exits / runs);
+	printf("\tjettison rate = %.2f%%\n", 100.0 * (double)sum->jettisons / runs);
+	printf("}\n");
+}
+
+static int
+runstats_fetch(char *target, xpc_object_t dict, const char **name, xpc_object_t *runs)
+{
+	xpc_object_t reply = NULL;
+	int ret;
+
+	*runs = NULL;
+	if ((ret = launchctl_setup_xpc_dict_for_service_name(target, dict, name))) {
 		return ret;
 	}
-	if (name == NULL)
+	if (*name == NULL)
 		return EBADNAME;
 
 	ret = launchctl_send_xpc_to_launchd(XPC_ROUTINE_RUNSTATS, dict, &reply);
 	if (ret == ENOTSUP) {
 		fprintf(stderr, "Performance logging is not enabled.\n");
-		return ret;
 	} else if (ret == ENOENT) {
 		fprintf(stderr, "No resource statistics gathered for service yet.\n");
-		return ret;
 	} else if (ret == EINVAL) {
 		fprintf(stderr, "Bad Request.\n");
+	} else if (ret == 0) {
+		xpc_object_t list = xpc_dictionary_get_value(reply, "runs");
+		if (list == NULL || xpc_get_type(list) != XPC_TYPE_ARRAY)
+			ret = EINVAL;
+		else
+			*runs = xpc_retain(list);
+	}
+
+	if (reply != NULL)
+		xpc_release(reply);
+	return ret;
+}
+
+static void
+runstats_decode(xpc_object_t run, int64_t *row)
+{
+	const struct rusage *ru = runstats_get_rusage(run);
+	int64_t values[RUNSTATS_NCOLUMNS] = {
+		xpc_dictionary_get_int64(run, "pid"),
+		xpc_dictionary_get_int64(run, "run-reason"),
+		(int64_t)xpc_dictionary_get_uint64(run, "start"),
+		(int64_t)xpc_dictionary_get_uint64(run, "end"),
+		(int64_t)xpc_dictionary_get_uint64(run, "forks"),
+		(int64_t)xpc_dictionary_get_uint64(run, "execs"),
+		xpc_dictionary_get_bool(run, "dirty-exit"),
+		xpc_dictionary_get_bool(run, "idle-exit"),
+		xpc_dictionary_get_bool(run, "jettisoned"),
+		(int64_t)timeval_to_usec(ru->ru_utime),
+		(int64_t)timeval_to_usec(ru->ru_stime),
+		ru->ru_maxrss,
+		ru->ru_minflt,
+		ru->ru_majflt,
+		ru->ru_nswap,
+		ru->ru_inblock,
+		ru->ru_oublock,
+		ru->ru_msgsnd,
+		ru->ru_msgrcv,
+		ru->ru_nsignals,
+		ru->ru_nvcsw,
+		ru->ru_nivcsw,
+	};
+	memcpy(row, values, sizeof(values));
+}
+
+static int
+compare_labels(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void
+runstats_table_free(struct runstats_table *table)
+{
+	for (size_t i = 0; i < table->nservices; i++)
+		free(table->services[i]);
+	free(table->services);
+	free(table->service);
+	for (size_t c = 0; c < RUNSTATS_NCOLUMNS; c++)
+		free(table->columns[c]);
+}
+
+/*
+ * Lists the services of the domain in dict and fetches their runstats with at
+ * most width requests in flight. Services without any runs are dropped.
+ */
+static int
+runstats_collect_domain(xpc_object_t dict, size_t width, struct runstats_table *table)
+{
+	xpc_object_t services;
+	int ret;
+
+	if ((ret = launchctl_copy_service_list(dict, &services)) != 0)
 		return ret;
-	} else if (ret) {
+
+	size_t count = xpc_dictionary_get_count(services);
+	char **labels = calloc(count + 1, sizeof(char *));
+	xpc_object_t *results = calloc(count + 1, sizeof(xpc_object_t));
+	if (labels == NULL || results == NULL) {
+		free(labels);
+		free(results);
+		xpc_release(services);
+		return ENOMEM;
+	}
+
+	size_t __block n = 0;
+	(void)xpc_dictionary_apply(services, ^bool(const char *key, xpc_object_t value) {
+	    if ((labels[n] = strdup(key)) == NULL)
+		    return false;
+	    return ++n < count;
+	});
+	xpc_release(services);
+	if (n < count) {
+		for (size_t i = 0; i < n; i++)
+			free(labels[i]);
+		free(labels);
+		free(results);
+		return ENOMEM;
+	}
+	qsort(labels, n, sizeof(char *), compare_labels);
+
+	uint64_t type = xpc_dictionary_get_uint64(dict, "type");
+	uint64_t handle = xpc_dictionary_get_uint64(dict, "handle");
+	launchctl_concurrent_apply(n, width, ^(size_t i) {
+	    xpc_object_t req = xpc_dictionary_create(NULL, NULL, 0);
+	    xpc_object_t reply = NULL;
+	    xpc_dictionary_set_uint64(req, "type", type);
+	    xpc_dictionary_set_uint64(req, "handle", handle);
+	    xpc_dictionary_set_string(req, "name", labels[i]);
+	    if (launchctl_send_xpc_to_launchd(XPC_ROUTINE_RUNSTATS, req, &reply) == 0) {
+		    xpc_object_t runs = xpc_dictionary_get_value(reply, "runs");
+		    if (runs != NULL && xpc_get_type(runs) == XPC_TYPE_ARRAY && xpc_array_get_count(runs) != 0)
+			    results[i] = xpc_retain(runs);
+	    }
+	    if (reply != NULL)
+		    xpc_release(reply);
+	    xpc_release(req);
+	});
+
+	memset(table, 0, sizeof(*table));
+	for (size_t i = 0; i < n; i++) {
+		if (results[i] != NULL)
+			table->nrows += xpc_array_get_count(results[i]);
+	}
+	table->services = calloc(n + 1, sizeof(char *));
+	table->service = calloc(table->nrows + 1, sizeof(uint32_t));
+	bool nomem = table->services == NULL || table->service == NULL;
+	for (size_t c = 0; c < RUNSTATS_NCOLUMNS; c++) {
+		table->columns[c] = calloc(table->nrows + 1, sizeof(int64_t));
+		nomem = nomem || table->columns[c] == NULL;
+	}
+	if (nomem) {
+		for (size_t i = 0; i < n; i++) {
+			free(labels[i]);
+			if (results[i] != NULL)
+				xpc_release(results[i]);
+		}
+		runstats_table_free(table);
+		free(labels);
+		free(results);
+		return ENOMEM;
+	}
+
+	size_t row = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (results[i] == NULL) {
+			free(labels[i]);
+			continue;
+		}
+		uint32_t svc = (uint32_t)table->nservices;
+		table->services[table->nservices++] = labels[i];
+		size_t nruns = xpc_array_get_count(results[i]);
+		for (size_t r = 0; r < nruns; r++, row++) {
+			int64_t values[RUNSTATS_NCOLUMNS];
+			runstats_decode(xpc_array_get_value(results[i], r), values);
+			table->service[row] = svc;
+			for (size_t c = 0; c < RUNSTATS_NCOLUMNS; c++)
+				table->columns[c][row] = values[c];
+		}
+		xpc_release(results[i]);
+	}
+
+	free(labels);
+	free(results);
+	return 0;
+}
+
+static void
+write_csv_field(FILE *out, const char *str)
+{
+	if (strpbrk(str, ",\"\r\n") == NULL) {
+		fputs(str, out);
+		return;
+	}
+	fputc('"', out);
+	for (; *str != '\0'; str++) {
+		if (*str == '"')
+			fputc('"', out);
+		fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+static void
+runstats_write_csv(FILE *out, const struct runstats_table *table)
+{
+	fputs("service", out);
+	for (size_t c = 0; c < RUNSTATS_NCOLUMNS; c++)
+		fprintf(out, ",%s", runstats_columns[c]);
+	fputc('\n', out);
+
+	for (size_t row = 0; row < table->nrows; row++) {
+		write_csv_field(out, table->services[table->service[row]]);
+		for (size_t c = 0; c < RUNSTATS_NCOLUMNS; c++)
+			fprintf(out, ",%" PRId64, table->columns[c][row]);
+		fputc('\n', out);
+	}
+}
+
+/*
+ * Columnar layout, all integers in host (little-endian) byte order:
+ *
+ *	uint32 magic, uint32 version, uint64 nrows, uint32 nservices, uint32 ncolumns
+ *	nservices x { uint16 length, char name[length] }
+ *	uint32 service[nrows] (index into the service names)
+ *	ncolumns x { uint8 length, char name[length], int64 values[nrows] }
+ */
+static void
+runstats_write_columnar(FILE *out, const struct runstats_table *table)
+{
+	uint32_t magic = RUNSTATS_COLUMNAR_MAGIC, version = RUNSTATS_COLUMNAR_VERSION;
+	uint64_t nrows = table->nrows;
+	uint32_t nservices = (uint32_t)table->nservices, ncolumns = RUNSTATS_NCOLUMNS;
+
+	fwrite(&magic, sizeof(magic), 1, out);
+	fwrite(&version, sizeof(version), 1, out);
+	fwrite(&nrows, sizeof(nrows), 1, out);
+	fwrite(&nservices, sizeof(nservices), 1, out);
+	fwrite(&ncolumns, sizeof(ncolumns), 1, out);
+
+	for (size_t i = 0; i < table->nservices; i++) {
+		size_t len = strlen(table->services[i]);
+		uint16_t len16 = len > UINT16_MAX ? UINT16_MAX : (uint16_t)len;
+		fwrite(&len16, sizeof(len16), 1, out);
+		fwrite(table->services[i], 1, len16, out);
+	}
+
+	fwrite(table->service, sizeof(uint32_t), table->nrows, out);
+	for (size_t c = 0; c < RUNSTATS_NCOLUMNS; c++) {
+		uint8_t len = (uint8_t)strlen(runstats_columns[c]);
+		fwrite(&len, sizeof(len), 1, out);
+		fwrite(runstats_columns[c], 1, len, out);
+		fwrite(table->columns[c], sizeof(int64_t), table->nrows, out);
+	}
+}
+
+static int
+runstats_all_cmd(xpc_object_t *msg, char *target, bool columnar, const char *outpath, size_t width)
+{
+	struct runstats_table table;
+	const char *name = NULL;
+	xpc_object_t dict;
+	FILE *out = stdout;
+	int ret;
+
+	dict = xpc_dictionary_create(NULL, NULL, 0);
+	*msg = dict;
+
+	if ((ret = launchctl_setup_xpc_dict_for_service_name(target, dict, &name)) != 0)
+		return ret;
+	if (name != NULL)
+		return EBADNAME;
+
+	if (outpath != NULL && (out = fopen(outpath, columnar ? "wb" : "w")) == NULL) {
+		ret = errno;
+		fprintf(stderr, "Could not open %s: %d: %s\n", outpath, ret, strerror(ret));
+		return ret;
+	}
+
+	if ((ret = runstats_collect_domain(dict, width, &table)) == 0) {
+		uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+		if (columnar)
+			runstats_write_columnar(out, &table);
+		else
+			runstats_write_csv(out, &table);
+		LAUNCHCTL_TRACE_END("render", t, columnar ? "columnar" : "csv", "\"rows\":%zu", table.nrows);
+		runstats_table_free(&table);
+	}
+
+	if (out != stdout)
+		fclose(out);
+	else
+		fflush(out);
+	return ret;
+}
+
+struct runstats_seen {
+	uint64_t service; // runstats_service_hash() of the label
+	uint64_t key; // runstats_run_key() of the run
+};
+
+struct runstats_keyset {
+	struct runstats_seen *runs;
+	size_t count;
+	size_t cap;
+};
+
+static volatile sig_atomic_t runstats_collect_stop;
+
+static void
+runstats_collect_signal(int sig)
+{
+	runstats_collect_stop = 1;
+}
+
+static uint64_t
+runstats_service_hash(const char *service)
+{
+	// FNV-1a over the label as stored in the ring
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < RUNSTATS_RING_SERVICE_LEN - 1 && service[i] != '\0'; i++) {
+		h ^= (uint8_t)service[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static uint64_t
+runstats_run_key(uint64_t service, int64_t pid, int64_t start)
+{
+	uint64_t h = service;
+	h ^= (uint64_t)pid;
+	h *= 0x100000001b3ULL;
+	h ^= (uint64_t)start;
+	h *= 0x100000001b3ULL;
+	return h;
+}
+
+static int
+compare_keys(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static int
+compare_seen(const void *a, const void *b)
+{
+	return compare_keys(&((const struct runstats_seen *)a)->key, &((const struct runstats_seen *)b)->key);
+}
+
+static bool
+runstats_keyset_add(struct runstats_keyset *set, uint64_t service, uint64_t key)
+{
+	if (set->count == set->cap) {
+		size_t cap = set->cap == 0 ? 256 : set->cap * 2;
+		struct runstats_seen *runs = realloc(set->runs, cap * sizeof(*runs));
+		if (runs == NULL)
+			return false;
+		set->runs = runs;
+		set->cap = cap;
+	}
+	set->runs[set->count++] = (struct runstats_seen){ service, key };
+	return true;
+}
+
+static bool
+runstats_keyset_contains(const struct runstats_keyset *set, uint64_t key)
+{
+	struct runstats_seen needle = { 0, key };
+	return set->count != 0 && bsearch(&needle, set->runs, set->count, sizeof(needle), compare_seen) != NULL;
+}
+
+/*
+ * Appends every completed run that was not present in the previous poll to
+ * the ring. Runs still in progress are picked up once they have ended, so a
+ * run is only ever recorded with its final rusage. Services that could not be
+ * polled this time keep their previous keys, so their runs are not appended
+ * again once they can be. Returns ENOMEM if a key could not be kept, since
+ * collection would then record duplicates.
+ */
+static int
+runstats_collect_append(struct runstats_ring *ring, xpc_object_t names, xpc_object_t *results,
+    const struct runstats_keyset *prev, struct runstats_keyset *cur)
+{
+	size_t count = xpc_array_get_count(names), npolled = 0;
+	uint64_t *polled = calloc(count + 1, sizeof(uint64_t));
+	int ret = polled == NULL ? ENOMEM : 0;
+
+	cur->count = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (results[i] == NULL)
+			continue;
+		const char *service = xpc_array_get_string(names, i);
+		uint64_t hash = runstats_service_hash(service);
+		size_t nruns = xpc_array_get_count(results[i]);
+		if (polled != NULL)
+			polled[npolled++] = hash;
+		for (size_t r = 0; r < nruns && ret == 0; r++) {
+			xpc_object_t run = xpc_array_get_value(results[i], r);
+			int64_t values[RUNSTATS_NCOLUMNS];
+			runstats_decode(run, values);
+			if (values[RUNSTATS_COLUMN_END] < values[RUNSTATS_COLUMN_START])
+				continue;
+			uint64_t key = runstats_run_key(hash, values[RUNSTATS_COLUMN_PID], values[RUNSTATS_COLUMN_START]);
+			if (!runstats_keyset_add(cur, hash, key)) {
+				ret = ENOMEM;
+				break;
+			}
+			if (!runstats_keyset_contains(prev, key))
+				runstats_ring_append(ring, service, values);
+		}
+		xpc_release(results[i]);
+		results[i] = NULL;
+	}
+
+	if (ret == 0) {
+		qsort(polled, npolled, sizeof(uint64_t), compare_keys);
+		for (size_t i = 0; i < prev->count && ret == 0; i++) {
+			if (bsearch(&prev->runs[i].service, polled, npolled, sizeof(uint64_t), compare_keys) != NULL)
+				continue;
+			if (!runstats_keyset_add(cur, prev->runs[i].service, prev->runs[i].key))
+				ret = ENOMEM;
+		}
+	}
+	free(polled);
+	qsort(cur->runs, cur->count, sizeof(*cur->runs), compare_seen);
+	return ret;
+}
+
+static int
+runstats_collect_cmd(xpc_object_t *msg, int argc, char **argv, double interval, const char *ringpath, uint32_t slots,
+    size_t width)
+{
+	struct runstats_keyset prev = { 0 }, cur = { 0 };
+	struct runstats_ring ring;
+	struct sigaction sa = { 0 };
+	xpc_object_t targets;
+	int ret = 0;
+
+	*msg = xpc_dictionary_create(NULL, NULL, 0);
+
+	// Domain targets are re-listed on every poll so new services are picked up
+	targets = xpc_array_create(NULL, 0);
+	for (int i = 0; i < argc; i++) {
+		xpc_object_t dict = xpc_dictionary_create(NULL, NULL, 0);
+		if ((ret = launchctl_setup_xpc_dict_for_service_name(argv[i], dict, NULL)) != 0) {
+			xpc_release(*msg);
+			*msg = dict;
+			xpc_release(targets);
+			return ret;
+		}
+		xpc_array_append_value(targets, dict);
+		xpc_release(dict);
+	}
+
+	if ((ret = runstats_ring_open(ringpath, slots, &ring)) == EEXIST) {
+		fprintf(stderr, "Ring %s already exists with a different number of slots than --slots %u\n", ringpath, slots);
+		xpc_release(targets);
+		return ret;
+	} else if (ret != 0) {
+		fprintf(stderr, "Could not open ring %s: %d: %s\n", ringpath, ret, strerror(ret));
+		xpc_release(targets);
 		return ret;
 	}
 
-	ret = 0;
-	runs = xpc_dictionary_get_value(reply, "runs");
-	if (runs == NULL || xpc_get_type(runs) != XPC_TYPE_ARRAY) {
-		return EINVAL;
+	// Seed the dedup set from what is already in the ring
+	uint64_t head = atomic_load(&ring.header->head);
+	uint64_t first = head > ring.header->capacity ? head - ring.header->capacity : 0;
+	for (uint64_t n = first; n < head && ret == 0; n++) {
+		struct runstats_ring_record rec;
+		if (!runstats_ring_read(&ring, n, &rec))
+			continue;
+		uint64_t hash = runstats_service_hash(rec.service);
+		if (!runstats_keyset_add(&prev, hash,
+		        runstats_run_key(hash, rec.values[RUNSTATS_COLUMN_PID], rec.values[RUNSTATS_COLUMN_START])))
+			ret = ENOMEM;
+	}
+	qsort(prev.runs, prev.count, sizeof(*prev.runs), compare_seen);
+
+	// Stop between polls on SIGINT or SIGTERM so the ring is closed cleanly
+	sa.sa_handler = runstats_collect_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while (ret == 0 && !runstats_collect_stop) {
+		xpc_object_t names = xpc_array_create(NULL, 0);
+		xpc_object_t domains = xpc_array_create(NULL, 0);
+
+		for (size_t i = 0; i < xpc_array_get_count(targets); i++) {
+			xpc_object_t target = xpc_array_get_value(targets, i);
+			const char *name = xpc_dictionary_get_string(target, "name");
+			if (name != NULL) {
+				xpc_array_set_string(names, XPC_ARRAY_APPEND, name);
+				xpc_array_append_value(domains, target);
+				continue;
+			}
+			xpc_object_t services;
+			if (launchctl_copy_service_list(target, &services) != 0)
+				continue;
+			(void)xpc_dictionary_apply(services, ^bool(const char *key, xpc_object_t value) {
+			    xpc_array_set_string(names, XPC_ARRAY_APPEND, key);
+			    xpc_array_append_value(domains, target);
+			    return true;
+			});
+			xpc_release(services);
+		}
+
+		size_t count = xpc_array_get_count(names);
+		xpc_object_t *results = calloc(count + 1, sizeof(xpc_object_t));
+		if (results == NULL) {
+			xpc_release(names);
+			xpc_release(domains);
+			ret = ENOMEM;
+			break;
+		}
+		launchctl_concurrent_apply(count, width, ^(size_t i) {
+		    xpc_object_t domain = xpc_array_get_value(domains, i);
+		    xpc_object_t req = xpc_dictionary_create(NULL, NULL, 0);
+		    xpc_object_t reply = NULL;
+		    xpc_dictionary_set_uint64(req, "type", xpc_dictionary_get_uint64(domain, "type"));
+		    xpc_dictionary_set_uint64(req, "handle", xpc_dictionary_get_uint64(domain, "handle"));
+		    xpc_dictionary_set_string(req, "name", xpc_array_get_string(names, i));
+		    if (launchctl_send_xpc_to_launchd(XPC_ROUTINE_RUNSTATS, req, &reply) == 0) {
+			    xpc_object_t runs = xpc_dictionary_get_value(reply, "runs");
+			    if (runs != NULL && xpc_get_type(runs) == XPC_TYPE_ARRAY)
+				    results[i] = xpc_retain(runs);
+		    }
+		    if (reply != NULL)
+			    xpc_release(reply);
+		    xpc_release(req);
+		});
+
+		ret = runstats_collect_append(&ring, names, results, &prev, &cur);
+		struct runstats_keyset tmp = prev;
+		prev = cur;
+		cur = tmp;
+
+		free(results);
+		xpc_release(names);
+		xpc_release(domains);
+
+		if (ret == 0 && !runstats_collect_stop) {
+			struct timespec ts = { (time_t)interval, (long)((interval - (double)(time_t)interval) * 1e9) };
+			nanosleep(&ts, NULL);
+		}
+	}
+	if (ret == ENOMEM)
+		fprintf(stderr, "Could not track collected runs: %d: %s\n", ret, strerror(ret));
+
+	free(prev.runs);
+	free(cur.runs);
+	runstats_ring_close(&ring);
+	xpc_release(targets);
+	return ret;
+}
+
+static int
+runstats_summary_cmd(xpc_object_t *msg, int argc, char **argv)
+{
+	struct runstats_summary *sum, *total;
+	const char *name = NULL;
+	xpc_object_t dict, runs;
+	int ret = 0;
+
+	sum = calloc(1, sizeof(*sum));
+	total = calloc(1, sizeof(*total));
+	if (sum == NULL || total == NULL) {
+		free(sum);
+		free(total);
+		return ENOMEM;
+	}
+
+	dict = xpc_dictionary_create(NULL, NULL, 0);
+	*msg = dict;
+	for (int i = 0; i < argc; i++) {
+		if ((ret = runstats_fetch(argv[i], dict, &name, &runs)) != 0)
+			break;
+
+		memset(sum, 0, sizeof(*sum));
+		xpc_array_apply_f(runs, sum, summarize_runstats);
+		xpc_release(runs);
+		print_runstats_summary(name, sum);
+		merge_runstats_summary(total, sum);
 	}
 
+	if (ret == 0 && argc > 1)
+		print_runstats_summary("(all services)", total);
+
+	free(sum);
+	free(total);
+	return ret;
+}
+
+int
+runstats_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+{
+	static const struct option longopts[] = {
+		{ "summary", no_argument, NULL, 's' },
+		{ "all", no_argument, NULL, 'a' },
+		{ "format", required_argument, NULL, 'f' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "jobs", required_argument, NULL, 'j' },
+		{ "collect", required_argument, NULL, 'c' },
+		{ "ring", required_argument, NULL, 'r' },
+		{ "slots", required_argument, NULL, 'n' },
+		{ NULL, 0, NULL, 0 },
+	};
+	bool summary = false, all = false, columnar = false;
+	const char *outpath = NULL, *ringpath = NULL;
+	size_t width = 8;
+	double interval = 0;
+	uint32_t slots = 0; // That of an existing ring, or RUNSTATS_RING_DEFAULT_CAPACITY
+	xpc_object_t dict;
+	const char *name = NULL;
+	xpc_object_t runs;
+	int ret, ch;
+
+	while ((ch = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+		switch (ch) {
+			case 's':
+				summary = true;
+				break;
+			case 'a':
+				all = true;
+				break;
+			case 'f':
+				if (strcmp(optarg, "csv") == 0)
+					columnar = false;
+				else if (strcmp(optarg, "columnar") == 0)
+					columnar = true;
+				else
+					return EUSAGE;
+				break;
+			case 'o':
+				outpath = optarg;
+				break;
+			case 'j':
+				width = strtoul(optarg, NULL, 10);
+				if (width == 0)
+					return EUSAGE;
+				break;
+			case 'c':
+				interval = strtod(optarg, NULL);
+				if (interval <= 0)
+					return EUSAGE;
+				break;
+			case 'r':
+				ringpath = optarg;
+				break;
+			case 'n':
+				slots = (uint32_t)strtoul(optarg, NULL, 10);
+				if (slots == 0)
+					return EUSAGE;
+				break;
+			default:
+				return EUSAGE;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (interval != 0 || ringpath != NULL) {
+		if (interval == 0 || ringpath == NULL || argc < 1 || summary || all)
+			return EUSAGE;
+		return runstats_collect_cmd(msg, argc, argv, interval, ringpath, slots, width);
+	}
+
+	if (all) {
+		if (argc != 1 || summary)
+			return EUSAGE;
+		return runstats_all_cmd(msg, argv[0], columnar, outpath, width);
+	}
+
+	if (summary) {
+		if (argc < 1)
+			return EUSAGE;
+		return runstats_summary_cmd(msg, argc, argv);
+	}
+
+	if (argc != 1)
+		return EUSAGE;
+
+	dict = xpc_dictionary_create(NULL, NULL, 0);
+	*msg = dict;
+
+	if ((ret = runstats_fetch(argv[0], dict, &name, &runs)) != 0)
+		return ret;
+
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
 	printf("\"%s\"\n", name);
 	xpc_array_apply_f(runs, NULL, print_runstats);
-	return ret;
+	LAUNCHCTL_TRACE_END("render", t, "runstats", "\"runs\":%zu", xpc_array_get_count(runs));
+	xpc_release(runs);
+	return 0;
 }
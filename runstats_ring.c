@@ -0,0 +1,216 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "runstats_ring.h"
+
+int
+runstats_ring_open(const char *path, uint32_t capacity, struct runstats_ring *ring)
+{
+	struct runstats_ring_header *hdr;
+	struct stat sb;
+	size_t size;
+	int fd, err;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1)
+		return errno;
+
+	// Only one collector may write to a ring at a time
+	if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+		err = errno == EWOULDBLOCK ? EBUSY : errno;
+		close(fd);
+		return err;
+	}
+
+	if (fstat(fd, &sb) == -1)
+		goto fail;
+
+	if ((size_t)sb.st_size >= sizeof(struct runstats_ring_header)) {
+		struct runstats_ring_header existing;
+		if (pread(fd, &existing, sizeof(existing), 0) != (ssize_t)sizeof(existing))
+			goto fail;
+		if (existing.magic != RUNSTATS_RING_MAGIC || existing.version != RUNSTATS_RING_VERSION ||
+		    existing.record_size != sizeof(struct runstats_ring_record)) {
+			close(fd);
+			return EFTYPE;
+		}
+		if (capacity != 0 && capacity != existing.capacity) {
+			close(fd);
+			return EEXIST;
+		}
+		capacity = existing.capacity;
+	} else if (sb.st_size != 0) {
+		close(fd);
+		return EFTYPE;
+	} else if (capacity == 0) {
+		capacity = RUNSTATS_RING_DEFAULT_CAPACITY;
+	}
+
+	if (capacity == 0) {
+		close(fd);
+		return EFTYPE;
+	}
+
+	size = sizeof(struct runstats_ring_header) + (size_t)capacity * sizeof(struct runstats_ring_record);
+	if ((size_t)sb.st_size != size && ftruncate(fd, (off_t)size) == -1)
+		goto fail;
+
+	hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		goto fail;
+
+	if (hdr->magic != RUNSTATS_RING_MAGIC) {
+		hdr->version = RUNSTATS_RING_VERSION;
+		hdr->capacity = capacity;
+		hdr->record_size = sizeof(struct runstats_ring_record);
+		atomic_store_explicit(&hdr->head, 0, memory_order_relaxed);
+		// Publish the magic last so readers never see a half-initialized header
+		atomic_thread_fence(memory_order_release);
+		hdr->magic = RUNSTATS_RING_MAGIC;
+	}
+
+	ring->fd = fd;
+	ring->size = size;
+	ring->header = hdr;
+	ring->records = (struct runstats_ring_record *)(hdr + 1);
+	return 0;
+
+fail:
+	err = errno;
+	close(fd);
+	return err;
+}
+
+int
+runstats_ring_open_readonly(const char *path, struct runstats_ring *ring)
+{
+	struct runstats_ring_header existing, *hdr;
+	struct stat sb;
+	size_t size;
+	int fd, err;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+		return errno;
+	if (fstat(fd, &sb) == -1)
+		goto fail;
+	if ((size_t)sb.st_size < sizeof(existing)) {
+		close(fd);
+		return EFTYPE;
+	}
+	if (pread(fd, &existing, sizeof(existing), 0) != (ssize_t)sizeof(existing))
+		goto fail;
+	size = sizeof(struct runstats_ring_header) + (size_t)existing.capacity * sizeof(struct runstats_ring_record);
+	if (existing.magic != RUNSTATS_RING_MAGIC || existing.version != RUNSTATS_RING_VERSION ||
+	    existing.record_size != sizeof(struct runstats_ring_record) || existing.capacity == 0 ||
+	    (size_t)sb.st_size < size) {
+		close(fd);
+		return EFTYPE;
+	}
+
+	hdr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED)
+		goto fail;
+	// The mapping outlives the descriptor, and readers take no lock
+	close(fd);
+
+	ring->size = size;
+	ring->header = hdr;
+	ring->records = (struct runstats_ring_record *)(hdr + 1);
+	return 0;
+
+fail:
+	err = errno;
+	close(fd);
+	return err;
+}
+
+void
+runstats_ring_append(struct runstats_ring *ring, const char *service, const int64_t *values)
+{
+	struct runstats_ring_header *hdr = ring->header;
+	uint64_t n = atomic_load_explicit(&hdr->head, memory_order_relaxed);
+	struct runstats_ring_record *rec = &ring->records[n % hdr->capacity];
+
+	atomic_store_explicit(&rec->seq, 2 * n + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	memset(rec->service, 0, sizeof(rec->service));
+	strncpy(rec->service, service, sizeof(rec->service) - 1);
+	memcpy(rec->values, values, sizeof(rec->values));
+
+	atomic_store_explicit(&rec->seq, 2 * n + 2, memory_order_release);
+	atomic_store_explicit(&hdr->head, n + 1, memory_order_release);
+}
+
+bool
+runstats_ring_read(const struct runstats_ring *ring, uint64_t n, struct runstats_ring_record *out)
+{
+	struct runstats_ring_record *rec = &ring->records[n % ring->header->capacity];
+	uint64_t before, after;
+
+	before = atomic_load_explicit(&rec->seq, memory_order_acquire);
+	if (before != 2 * n + 2)
+		return false; // overwritten or not written yet
+
+	memcpy(out->service, rec->service, sizeof(out->service));
+	memcpy(out->values, rec->values, sizeof(out->values));
+	atomic_thread_fence(memory_order_acquire);
+
+	after = atomic_load_explicit(&rec->seq, memory_order_relaxed);
+	out->service[sizeof(out->service) - 1] = '\0';
+	atomic_store_explicit(&out->seq, after, memory_order_relaxed);
+	return before == after;
+}
+
+void
+runstats_ring_close(struct runstats_ring *ring)
+{
+	if (ring->header != NULL)
+		munmap(ring->header, ring->size);
+	if (ring->fd != -1)
+		close(ring->fd);
+	ring->header = NULL;
+	ring->records = NULL;
+	ring->fd = -1;
+}
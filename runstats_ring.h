@@ -0,0 +1,89 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef _LAUNCHCTL_RUNSTATS_RING_H_
+#define _LAUNCHCTL_RUNSTATS_RING_H_
+
+/*
+ * On-disk ring of runstats records written by `runstats --collect`.
+ *
+ * There is exactly one writer, runstats_ring_open() (enforced with
+ * flock(2)), and any number of readers, runstats_ring_open_readonly(), which
+ * map the file read-only and take no lock. Each record carries a sequence number:
+ * it is odd while the record is being written and 2 * (n + 1) once record n
+ * is complete, so a reader copies a record and accepts it only if the
+ * sequence number was even and unchanged across the copy. head is the total
+ * number of records ever appended; record n lives in slot n % capacity.
+ * values are in the column order of `runstats --all`. A ring keeps the
+ * capacity it was created with; opening it with another one fails.
+ */
+#define RUNSTATS_RING_MAGIC 0x474e5252 // "RRNG"
+#define RUNSTATS_RING_VERSION 1
+#define RUNSTATS_RING_NVALUES 22
+#define RUNSTATS_RING_SERVICE_LEN 120
+#define RUNSTATS_RING_DEFAULT_CAPACITY 4096
+
+struct runstats_ring_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;
+	uint32_t record_size;
+	_Atomic uint64_t head;
+	uint64_t reserved[5];
+};
+
+struct runstats_ring_record {
+	_Atomic uint64_t seq;
+	char service[RUNSTATS_RING_SERVICE_LEN];
+	int64_t values[RUNSTATS_RING_NVALUES];
+};
+
+struct runstats_ring {
+	int fd;
+	size_t size;
+	struct runstats_ring_header *header;
+	struct runstats_ring_record *records;
+};
+
+/*
+ * Opens or creates the ring at path for writing. A capacity of 0 takes that
+ * of an existing ring, or RUNSTATS_RING_DEFAULT_CAPACITY for a new one.
+ * Returns EBUSY if another writer has it open, EFTYPE if the file is not a
+ * ring and EEXIST if it is one with a different capacity.
+ */
+int runstats_ring_open(const char *path, uint32_t capacity, struct runstats_ring *ring);
+// Maps an existing ring read-only, for runstats_ring_read(), alongside a writer
+int runstats_ring_open_readonly(const char *path, struct runstats_ring *ring);
+void runstats_ring_append(struct runstats_ring *ring, const char *service, const int64_t *values);
+bool runstats_ring_read(const struct runstats_ring *ring, uint64_t n, struct runstats_ring_record *out);
+void runstats_ring_close(struct runstats_ring *ring);
+#endif
@@ -0,0 +1,101 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sketch.h"
+
+// gamma = (1 + a) / (1 - a) with a relative accuracy a of 0.02
+#define SKETCH_GAMMA 1.0408163265306123
+#define SKETCH_LN_GAMMA 0.040005334613699206
+
+static inline int
+sketch_index(uint64_t value)
+{
+	int idx = (int)ceil(log((double)value) / SKETCH_LN_GAMMA);
+	if (idx < 0)
+		idx = 0;
+	if (idx >= SKETCH_NBINS)
+		idx = SKETCH_NBINS - 1;
+	return idx;
+}
+
+void
+sketch_init(struct sketch *sk)
+{
+	memset(sk, 0, sizeof(*sk));
+}
+
+void
+sketch_add(struct sketch *sk, uint64_t value)
+{
+	sk->count++;
+	if (value > sk->max)
+		sk->max = value;
+	if (value == 0)
+		sk->zero_count++;
+	else
+		sk->bins[sketch_index(value)]++;
+}
+
+void
+sketch_merge(struct sketch *dst, const struct sketch *src)
+{
+	dst->count += src->count;
+	dst->zero_count += src->zero_count;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	for (int i = 0; i < SKETCH_NBINS; i++)
+		dst->bins[i] += src->bins[i];
+}
+
+uint64_t
+sketch_quantile(const struct sketch *sk, double q)
+{
+	if (sk->count == 0)
+		return 0;
+	if (q >= 1.0)
+		return sk->max;
+
+	uint64_t rank = (uint64_t)(q * (double)(sk->count - 1));
+	uint64_t seen = sk->zero_count;
+	if (rank < seen)
+		return 0;
+
+	for (int i = 0; i < SKETCH_NBINS; i++) {
+		seen += sk->bins[i];
+		if (rank < seen) {
+			// midpoint of the bucket (gamma^(i-1), gamma^i] in relative terms
+			double est = 2.0 * pow(SKETCH_GAMMA, i) / (SKETCH_GAMMA + 1.0);
+			uint64_t val = (uint64_t)llround(est);
+			return val > sk->max ? sk->max : val;
+		}
+	}
+	return sk->max;
+}
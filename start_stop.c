@@ -26,48 +26,194 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
+#include "trace.h"
 #include "xpc_private.h"
 
-int
-stop_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+struct start_stop_result {
+	int error;
+	int64_t pid;
+	uint64_t sent; // When the request was sent, from launchctl_trace_now()
+	uint64_t reached; // When the service was first seen in the requested state, or 0
+};
+
+/*
+ * Resolves legacy labels in the default domain into entries like those of
+ * launchctl_expand_service_targets(). Labels with glob characters are
+ * matched against one list of the domain.
+ */
+static int
+start_stop_expand(int count, char **labels, xpc_object_t *out)
 {
-	if (argc < 2)
-		return EUSAGE;
+	xpc_object_t domain = xpc_dictionary_create(NULL, NULL, 0);
+	xpc_object_t snapshots = xpc_dictionary_create(NULL, NULL, 0);
+	int ret = 0;
 
-	xpc_object_t dict, reply;
+	launchctl_setup_xpc_dict(domain);
+	*out = xpc_array_create(NULL, 0);
+	for (int i = 0; i < count && ret == 0; i++) {
+		if (strpbrk(labels[i], "*?[") != NULL) {
+			ret = launchctl_expand_glob(domain, NULL, labels[i], snapshots, *out);
+			continue;
+		}
+		xpc_object_t target = xpc_dictionary_create(NULL, NULL, 0);
+		xpc_dictionary_set_uint64(target, "type", xpc_dictionary_get_uint64(domain, "type"));
+		xpc_dictionary_set_uint64(target, "handle", xpc_dictionary_get_uint64(domain, "handle"));
+		xpc_dictionary_set_string(target, "name", labels[i]);
+		xpc_dictionary_set_string(target, "target", labels[i]);
+		xpc_array_append_value(*out, target);
+		xpc_release(target);
+	}
+	xpc_release(snapshots);
+	xpc_release(domain);
+	if (ret != 0) {
+		xpc_release(*out);
+		*out = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Starts or stops every service the labels expand to, concurrently, then
+ * optionally waits until each is running, or no longer running. One line
+ * per service is printed at the end.
+ */
+static int
+start_stop_labels(bool start, int count, char **labels, double timeout)
+{
+	const char *verb = start ? "start" : "stop";
+	struct launchctl_results res = {};
+	struct start_stop_result *results;
+	xpc_object_t list;
+	size_t n;
 	int ret;
 
-	dict = xpc_dictionary_create(NULL, NULL, 0);
-	launchctl_setup_xpc_dict(dict);
-	xpc_dictionary_set_string(dict, "name", argv[1]);
-	*msg = dict;
-	ret = launchctl_send_xpc_to_launchd(XPC_ROUTINE_SERVICE_STOP, dict, &reply);
-	if (ret == EPERM) {
-		fprintf(stderr, "Not privileged to stop service.\n");
+	if ((ret = start_stop_expand(count, labels, &list)) != 0)
+		return ret;
+	if ((n = xpc_array_get_count(list)) == 0) {
+		xpc_release(list);
+		return ENOSERVICE;
+	}
+	if ((results = calloc(n, sizeof(*results))) == NULL) {
+		xpc_release(list);
+		return ENOMEM;
+	}
+
+	launchctl_concurrent_apply(n, LAUNCHCTL_REQUEST_WIDTH, ^(size_t i) {
+	    xpc_object_t dict = launchctl_target_request(xpc_array_get_value(list, i)), reply = NULL;
+	    results[i].sent = launchctl_trace_now();
+	    results[i].error = launchctl_send_xpc_to_launchd(
+	        start ? XPC_ROUTINE_SERVICE_START : XPC_ROUTINE_SERVICE_STOP, dict, &reply);
+	    if (reply != NULL)
+		    xpc_release(reply);
+	    xpc_release(dict);
+	});
+
+	if (timeout > 0) {
+		(void)launchctl_wait_services(list, 0, n, timeout, ^bool(size_t i, int64_t pid) {
+		    struct start_stop_result *r = &results[i];
+		    if (r->error != 0 && r->error != EALREADY)
+			    return true;
+		    if (start ? pid > 0 : pid == 0) {
+			    r->pid = pid;
+			    r->reached = launchctl_trace_now();
+			    return true;
+		    }
+		    r->pid = pid;
+		    return false;
+		});
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		const char *label = xpc_dictionary_get_string(xpc_array_get_value(list, i), "target");
+		struct start_stop_result *r = &results[i];
+
+		if (r->error == EPERM)
+			launchctl_result_fail(&res, label, r->error, "Not privileged to %s service", verb);
+		else if (r->error != 0 && r->error != EALREADY)
+			launchctl_result_fail(&res, label, r->error, "%d: %s", r->error, xpc_strerror(r->error));
+		else if (timeout <= 0)
+			launchctl_result_ok(&res, label, "%s",
+			    r->error == EALREADY ? (start ? "already running" : "not running") : (start ? "started" : "stopped"));
+		else if (r->reached != 0 && start)
+			launchctl_result_ok(&res, label, "running with pid %" PRId64 " after %.1f ms", r->pid,
+			    (r->reached - r->sent) / 1e6);
+		else if (r->reached != 0)
+			launchctl_result_ok(&res, label, "stopped after %.1f ms", (r->reached - r->sent) / 1e6);
+		else if (start)
+			launchctl_result_fail(&res, label, ETIMEDOUT, "not running after %g s", timeout);
+		else
+			launchctl_result_fail(&res, label, ETIMEDOUT, "still running with pid %" PRId64 " after %g s", r->pid,
+			    timeout);
 	}
-	return ret == EALREADY ? 0 : ret;
+	ret = launchctl_results_finish(&res, n, start ? "Started" : "Stopped", NULL);
+
+	free(results);
+	xpc_release(list);
+	return ret;
 }
 
-int
-start_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+static int
+start_stop_cmd(bool start, xpc_object_t *msg, int argc, char **argv)
 {
-	if (argc < 2)
-		return EUSAGE;
-
+	static const struct option longopts[] = {
+		{ "wait", required_argument, NULL, 'w' },
+		{ NULL, 0, NULL, 0 },
+	};
 	xpc_object_t dict, reply;
-	int ret;
+	double timeout = 0;
+	char *end;
+	int ch, ret;
 
 	dict = xpc_dictionary_create(NULL, NULL, 0);
 	launchctl_setup_xpc_dict(dict);
-	xpc_dictionary_set_string(dict, "name", argv[1]);
 	*msg = dict;
-	ret = launchctl_send_xpc_to_launchd(XPC_ROUTINE_SERVICE_START, dict, &reply);
+
+	while ((ch = getopt_long(argc, argv, "w:", longopts, NULL)) != -1) {
+		switch (ch) {
+			case 'w':
+				timeout = strtod(optarg, &end);
+				if (*end != '\0' || timeout <= 0)
+					return EUSAGE;
+				break;
+			default:
+				return EUSAGE;
+		}
+	}
+	if (argc <= optind)
+		return EUSAGE;
+
+	if (argc - optind > 1 || timeout > 0 || strpbrk(argv[optind], "*?[") != NULL)
+		return start_stop_labels(start, argc - optind, argv + optind, timeout);
+
+	xpc_dictionary_set_string(dict, "name", argv[optind]);
+	ret = launchctl_send_xpc_to_launchd(start ? XPC_ROUTINE_SERVICE_START : XPC_ROUTINE_SERVICE_STOP, dict, &reply);
 	if (ret == EPERM) {
-		fprintf(stderr, "Not privileged to start service.\n");
+		fprintf(stderr, "Not privileged to %s service.\n", start ? "start" : "stop");
+	} else if (ret == EALREADY) {
+		// Nothing to do, which is not an error, but say so rather than pretend it was done
+		printf("%s: %s\n", argv[optind], start ? "already running" : "not running");
+		ret = 0;
 	}
-	return ret == EALREADY ? 0 : ret;
+	return ret;
+}
+
+int
+stop_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+{
+	return start_stop_cmd(false, msg, argc, argv);
+}
+
+int
+start_cmd(xpc_object_t *msg, int argc, char **argv, char **envp, char **apple)
+{
+	return start_stop_cmd(true, msg, argc, argv);
 }
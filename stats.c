@@ -0,0 +1,266 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/resource.h>
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <xpc/xpc.h>
+
+#include "launchctl.h"
+#include "xpc_private.h"
+
+#define STATS_MAX_ROUTINES 32
+#define STATS_MAX_ERRORS 8
+
+struct stats_routine {
+	uint64_t routine;
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t min_ns;
+	uint64_t max_ns;
+	uint64_t request_bytes;
+	uint64_t reply_bytes;
+	uint64_t shmem_bytes;
+	uint32_t nerrors;
+	struct {
+		int code;
+		uint64_t count;
+	} errors[STATS_MAX_ERRORS];
+};
+
+bool launchctl_stats_enabled;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct stats_routine stats[STATS_MAX_ROUTINES];
+static uint32_t nstats;
+static _Atomic uint64_t stdout_bytes, stderr_bytes;
+static int stdout_fd = STDOUT_FILENO, stderr_fd = STDERR_FILENO;
+
+static const char *
+stats_routine_name(uint64_t routine)
+{
+	switch (routine) {
+		case XPC_ROUTINE_KICKSTART_SERVICE:
+			return "kickstart";
+		case XPC_ROUTINE_ATTACH_SERVICE:
+			return "attach";
+		case XPC_ROUTINE_BLAME_SERVICE:
+			return "blame";
+		case XPC_ROUTINE_PRINT_SERVICE:
+			return "print-service";
+		case XPC_ROUTINE_RUNSTATS:
+			return "runstats";
+		case XPC_ROUTINE_UNKNOWN:
+			return "unknown";
+		case XPC_ROUTINE_LOAD:
+			return "load";
+		case XPC_ROUTINE_UNLOAD:
+			return "unload";
+		case XPC_ROUTINE_ENABLE:
+			return "enable";
+		case XPC_ROUTINE_DISABLE:
+			return "disable";
+		case XPC_ROUTINE_SERVICE_KILL:
+			return "kill";
+		case XPC_ROUTINE_SERVICE_START:
+			return "start";
+		case XPC_ROUTINE_SERVICE_STOP:
+			return "stop";
+		case XPC_ROUTINE_LIST:
+			return "list";
+		case XPC_ROUTINE_REMOVE:
+			return "remove";
+		case XPC_ROUTINE_SETENV:
+			return "setenv";
+		case XPC_ROUTINE_GETENV:
+			return "getenv";
+		case XPC_ROUTINE_RESOLVE_PORT:
+			return "resolve-port";
+		case XPC_ROUTINE_LIMIT:
+			return "limit";
+		case XPC_ROUTINE_EXAMINE:
+			return "examine";
+		case XPC_ROUTINE_PRINT:
+			return "print";
+		case XPC_ROUTINE_DUMPSTATE:
+			return "dumpstate";
+		case XPC_ROUTINE_DUMPJPCATEGORY:
+			return "dumpjpcategory";
+		case XPC_ROUTINE_DUMP_XSC:
+			return "dump-xsc";
+		default:
+			return "?";
+	}
+}
+
+/*
+ * Approximates the encoded size of an object: its keys, strings and data
+ * plus a word for every other value. libxpc does not expose the size of a
+ * serialized message, but this tracks it closely enough to compare routines.
+ */
+static uint64_t
+stats_object_size(xpc_object_t obj)
+{
+	xpc_type_t t = xpc_get_type(obj);
+	if (t == XPC_TYPE_DICTIONARY) {
+		__block uint64_t size = 8;
+		(void)xpc_dictionary_apply(obj, ^bool(const char *key, xpc_object_t value) {
+		    size += strlen(key) + 1 + stats_object_size(value);
+		    return true;
+		});
+		return size;
+	} else if (t == XPC_TYPE_ARRAY) {
+		__block uint64_t size = 8;
+		(void)xpc_array_apply(obj, ^bool(size_t index, xpc_object_t value) {
+		    size += stats_object_size(value);
+		    return true;
+		});
+		return size;
+	} else if (t == XPC_TYPE_STRING)
+		return 4 + xpc_string_get_length(obj) + 1;
+	else if (t == XPC_TYPE_DATA)
+		return 4 + xpc_data_get_length(obj);
+	return 8;
+}
+
+void
+launchctl_stats_record(uint64_t routine, xpc_object_t msg, xpc_object_t reply, int error, uint64_t ns)
+{
+	uint64_t request = stats_object_size(msg);
+	uint64_t response = reply != NULL ? stats_object_size(reply) : 0;
+	uint64_t shmem = reply != NULL ? xpc_dictionary_get_uint64(reply, "bytes-written") : 0;
+	struct stats_routine *s = NULL;
+
+	pthread_mutex_lock(&stats_lock);
+	for (uint32_t i = 0; i < nstats; i++) {
+		if (stats[i].routine == routine) {
+			s = &stats[i];
+			break;
+		}
+	}
+	if (s == NULL && nstats < STATS_MAX_ROUTINES) {
+		s = &stats[nstats++];
+		s->routine = routine;
+		s->min_ns = UINT64_MAX;
+	}
+	if (s != NULL) {
+		s->calls++;
+		s->total_ns += ns;
+		s->min_ns = ns < s->min_ns ? ns : s->min_ns;
+		s->max_ns = ns > s->max_ns ? ns : s->max_ns;
+		s->request_bytes += request;
+		s->reply_bytes += response;
+		s->shmem_bytes += shmem;
+		if (error != 0) {
+			uint32_t i = 0;
+			while (i < s->nerrors && s->errors[i].code != error)
+				i++;
+			if (i == s->nerrors && i < STATS_MAX_ERRORS) {
+				s->errors[i].code = error;
+				s->nerrors++;
+			}
+			if (i < s->nerrors)
+				s->errors[i].count++;
+		}
+	}
+	pthread_mutex_unlock(&stats_lock);
+}
+
+static int
+stats_write(void *cookie, const char *buf, int len)
+{
+	int fd = *(int *)cookie;
+	ssize_t n = write(fd, buf, len);
+	if (n > 0)
+		atomic_fetch_add_explicit(fd == stdout_fd ? &stdout_bytes : &stderr_bytes, n, memory_order_relaxed);
+	return (int)n;
+}
+
+static void
+stats_report(void)
+{
+	struct rusage ru;
+
+	fflush(stdout);
+	fflush(stderr);
+	uint64_t out = atomic_load(&stdout_bytes), err = atomic_load(&stderr_bytes);
+
+	pthread_mutex_lock(&stats_lock);
+	fprintf(stderr, "\n%-20s %7s %11s %10s %10s %12s %12s %12s  %s\n", "routine", "calls", "total_ms", "min_ms",
+	    "max_ms", "request_b", "reply_b", "shmem_b", "errors");
+	for (uint32_t i = 0; i < nstats; i++) {
+		struct stats_routine *s = &stats[i];
+		char name[32];
+
+		snprintf(name, sizeof(name), "%s (%" PRIu64 ")", stats_routine_name(s->routine), s->routine);
+		fprintf(stderr, "%-20s %7" PRIu64 " %11.3f %10.3f %10.3f %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "  ",
+		    name, s->calls, s->total_ns / 1e6, s->min_ns / 1e6, s->max_ns / 1e6, s->request_bytes, s->reply_bytes,
+		    s->shmem_bytes);
+		if (s->nerrors == 0)
+			fputc('-', stderr);
+		for (uint32_t j = 0; j < s->nerrors; j++)
+			fprintf(stderr, "%s%d: %s (x%" PRIu64 ")", j == 0 ? "" : ", ", s->errors[j].code,
+			    xpc_strerror(s->errors[j].code), s->errors[j].count);
+		fputc('\n', stderr);
+	}
+	pthread_mutex_unlock(&stats_lock);
+
+	getrusage(RUSAGE_SELF, &ru);
+	fprintf(stderr, "peak rss: %ld KB, output: %" PRIu64 " bytes (stdout %" PRIu64 ", stderr %" PRIu64 ")\n",
+	    ru.ru_maxrss / 1024, out + err, out, err);
+	fflush(stderr);
+}
+
+/*
+ * Starts collecting per-routine statistics, printed to stderr at exit.
+ * stdout and stderr are replaced with streams that count what passes
+ * through them; output launchd writes straight to a descriptor is not seen.
+ */
+void
+launchctl_stats_start(void)
+{
+	FILE *out, *err;
+
+	launchctl_stats_enabled = true;
+	if ((out = funopen(&stdout_fd, NULL, stats_write, NULL, NULL)) != NULL) {
+		setvbuf(out, NULL, isatty(stdout_fd) ? _IOLBF : _IOFBF, BUFSIZ);
+		stdout = out;
+	}
+	if ((err = funopen(&stderr_fd, NULL, stats_write, NULL, NULL)) != NULL) {
+		setvbuf(err, NULL, _IONBF, 0);
+		stderr = err;
+	}
+	atexit(stats_report);
+}
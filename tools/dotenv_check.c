@@ -0,0 +1,135 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dotenv.h"
+
+/*
+ * Runs the setenv --from-file parser in dotenv.c over a table of inputs and
+ * compares what it reports, entry by entry or as the line and message of the
+ * error env.c prints as <path>:<line>: <message>. Needs neither launchd nor
+ * libxpc.
+ */
+
+struct dotenv_case {
+	const char *name;
+	const char *input;
+	bool need_value;
+	const char *want; // KEY=value entries joined with '|', KEY alone for a NULL value
+	int line;         // Expected error line, 0 when parsing should succeed
+	const char *message;
+};
+
+static const struct dotenv_case cases[] = {
+	{ "plain", "A=1\nB=two words\n", true, "A=1|B=two words", 0, NULL },
+	{ "no trailing newline", "A=1\nB=2", true, "A=1|B=2", 0, NULL },
+	{ "blank and comment lines", "\n# comment\n  \t\nA=1\n\n#B=2\n", true, "A=1", 0, NULL },
+	{ "spaces around", "  A =  spaced out  \n", true, "A=spaced out", 0, NULL },
+	{ "empty value", "A=\nB=\"\"\nC=''\n", true, "A=|B=|C=", 0, NULL },
+	{ "export", "export A=1\nexport\tB=2\nexported=3\n", true, "A=1|B=2|exported=3", 0, NULL },
+	{ "trailing comment", "A=1 # one\nB=2#3\nC=#x\nD=4\t# four\n", true, "A=1|B=2#3|C=|D=4", 0, NULL },
+	{ "single quotes are literal", "A='a \\n $B \"x\"'\n", true, "A=a \\n $B \"x\"", 0, NULL },
+	{ "double quote escapes", "A=\"1\\n2\\t3\\r4\\\"5\\\\6\\$7\\q\"\n", true, "A=1\n2\t3\r4\"5\\6$7\\q", 0, NULL },
+	{ "comment after quotes", "A=\"x # not a comment\" # comment\nB='y'  \n", true, "A=x # not a comment|B=y", 0,
+	    NULL },
+	{ "multi-line quoted", "A=\"one\ntwo\"\nB='three\nfour'\nC=5\n", true, "A=one\ntwo|B=three\nfour|C=5", 0, NULL },
+	{ "crlf", "A=1\r\nB=\"2\"\r\n# c\r\nC=3 # d\r\n", true, "A=1|B=2|C=3", 0, NULL },
+	{ "bare keys", "A\nexport B\nC # comment\nD=4\n", false, "A|B|C|D=4", 0, NULL },
+	{ "bare key at end of file", "A", false, "A", 0, NULL },
+	{ "bare key needs value", "A=1\n\nB\n", true, "A=1", 3, "expected '=' after variable name" },
+	{ "invalid name", "A=1\n1A=2\n", true, "A=1", 2, "invalid variable name" },
+	{ "invalid character in name", "A-B=1\n", true, "", 1, "expected '=' after variable name" },
+	{ "export without name", "export =1\n", true, "", 1, "invalid variable name" },
+	{ "unterminated double quote", "A=1\nB=\"two\nthree\n", true, "A=1", 2, "unterminated quoted value" },
+	{ "unterminated single quote", "A='x", true, "", 1, "unterminated quoted value" },
+	{ "text after quotes", "A=\"x\"y\n", true, "", 1, "unexpected characters after quoted value" },
+	{ "error line after multi-line value", "A=\"1\n2\n3\"\nB=\"x\" y\n", true, "A=1\n2\n3", 4,
+	    "unexpected characters after quoted value" },
+	{ "error line after crlf", "A=1\r\n\r\n-=2\r\n", true, "A=1", 3, "invalid variable name" },
+};
+
+struct collect {
+	char buf[512];
+	size_t len;
+};
+
+static void
+collect_entry(const char *key, const char *value, void *ctx)
+{
+	struct collect *c = ctx;
+
+	c->len += (size_t)snprintf(c->buf + c->len, sizeof(c->buf) - c->len, "%s%s%s%s", c->len != 0 ? "|" : "", key,
+	    value != NULL ? "=" : "", value != NULL ? value : "");
+	if (c->len >= sizeof(c->buf))
+		c->len = sizeof(c->buf) - 1;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *filter = argc > 1 ? argv[1] : NULL;
+	int checks = 0, failures = 0;
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		const struct dotenv_case *t = &cases[i];
+		struct dotenv_error err = {};
+		struct collect c = {};
+		size_t len;
+		char *buf;
+		int ret;
+
+		if (filter != NULL && strstr(t->name, filter) == NULL)
+			continue;
+		// The parser unquotes in place, so give it a writable copy like env_read_file does
+		len = strlen(t->input);
+		buf = strdup(t->input);
+		if (buf == NULL) {
+			perror("strdup");
+			return 1;
+		}
+		ret = dotenv_parse(buf, len, t->need_value, collect_entry, &c, &err);
+		free(buf);
+
+		checks++;
+		if (strcmp(c.buf, t->want) != 0 || (t->line == 0 && ret != 0) ||
+		    (t->line != 0 && (ret == 0 || err.line != t->line || strcmp(err.message, t->message) != 0))) {
+			failures++;
+			fprintf(stderr, "FAIL %s: entries \"%s\", want \"%s\"", t->name, c.buf, t->want);
+			if (ret != 0)
+				fprintf(stderr, "; <path>:%d: %s", err.line, err.message);
+			if (t->line != 0)
+				fprintf(stderr, ", want <path>:%d: %s", t->line, t->message);
+			fputc('\n', stderr);
+		}
+	}
+	printf("checks=%d failed=%d\n", checks, failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <mach/machine.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xpc/xpc.h>
+
+#include "fixtures.h"
+#include "launchctl.h"
+#include "macho_corpus.h"
+
+/*
+ * A launchd job with nkeys entries spread over ProgramArguments,
+ * EnvironmentVariables and MachServices, which is where large jobs grow.
+ */
+char *
+fixture_plist(size_t nkeys, size_t *len)
+{
+	char *buf = NULL;
+	FILE *out = open_memstream(&buf, len);
+
+	fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	      "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" "
+	      "\"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+	      "<plist version=\"1.0\">\n"
+	      "<dict>\n"
+	      "\t<key>Label</key>\n"
+	      "\t<string>com.example.fixture</string>\n"
+	      "\t<key>KeepAlive</key>\n"
+	      "\t<true/>\n"
+	      "\t<key>ProgramArguments</key>\n"
+	      "\t<array>\n"
+	      "\t\t<string>/usr/libexec/fixtured</string>\n",
+	    out);
+	for (size_t i = 0; i < nkeys / 3; i++)
+		fprintf(out, "\t\t<string>--option-%zu=value-%zu</string>\n", i, i * 7919);
+	fputs("\t</array>\n\t<key>EnvironmentVariables</key>\n\t<dict>\n", out);
+	for (size_t i = 0; i < nkeys / 3; i++)
+		fprintf(out, "\t\t<key>FIXTURE_VARIABLE_%zu</key>\n\t\t<string>%zu</string>\n", i, i * 104729);
+	fputs("\t</dict>\n\t<key>MachServices</key>\n\t<dict>\n", out);
+	for (size_t i = 0; i < nkeys - 2 * (nkeys / 3); i++)
+		fprintf(out, "\t\t<key>com.example.fixture.service-%zu</key>\n\t\t<true/>\n", i);
+	fputs("\t</dict>\n</dict>\n</plist>\n", out);
+
+	fclose(out);
+	return buf;
+}
+
+/*
+ * A setenv --from-file file of nvars variables, cycling through the forms
+ * the parser accepts: plain, `export`ed, single and double quoted with
+ * escapes, with trailing comments, between comment and blank lines.
+ */
+char *
+fixture_dotenv(size_t nvars, size_t *len)
+{
+	char *buf = NULL;
+	FILE *out = open_memstream(&buf, len);
+
+	fputs("# Generated by fixture_dotenv\n\n", out);
+	for (size_t i = 0; i < nvars; i++) {
+		switch (i % 5) {
+			case 0:
+				fprintf(out, "FIXTURE_VARIABLE_%zu=%zu\n", i, i * 104729);
+				break;
+			case 1:
+				fprintf(out, "export FIXTURE_VARIABLE_%zu=/usr/local/fixture/%zu\n", i, i);
+				break;
+			case 2:
+				fprintf(out, "FIXTURE_VARIABLE_%zu='literal $HOME \\n %zu'\n", i, i);
+				break;
+			case 3:
+				fprintf(out, "FIXTURE_VARIABLE_%zu=\"line one\\nline \\\"two\\\" %zu\" # quoted\n", i, i);
+				break;
+			case 4:
+				fprintf(out, "FIXTURE_VARIABLE_%zu = value %zu # comment\n\n# FIXTURE_VARIABLE_%zu=skipped\n", i, i, i);
+				break;
+		}
+	}
+
+	fclose(out);
+	return buf;
+}
+
+// { "services": { label: { "pid", "status" } } }, as printed by `launchctl list`
+xpc_object_t
+fixture_list_reply(size_t nservices)
+{
+	xpc_object_t reply = xpc_dictionary_create(NULL, NULL, 0);
+	xpc_object_t services = xpc_dictionary_create(NULL, NULL, 0);
+	char label[64];
+
+	for (size_t i = 0; i < nservices; i++) {
+		xpc_object_t service = xpc_dictionary_create(NULL, NULL, 0);
+		snprintf(label, sizeof(label), "com.example.fixture.%zu", i);
+		// Roughly a third of the services are running, the rest exited or were killed
+		xpc_dictionary_set_int64(service, "pid", i % 3 == 0 ? (int64_t)(100 + i) : 0);
+		xpc_dictionary_set_int64(service, "status", i % 7 == 0 ? SIGKILL : (int64_t)(i % 5) << 8);
+		xpc_dictionary_set_value(services, label, service);
+		xpc_release(service);
+	}
+	xpc_dictionary_set_value(reply, "services", services);
+	xpc_release(services);
+	return reply;
+}
+
+// { "runs": [ run... ] } with the keys runstats.c reads from every run
+xpc_object_t
+fixture_runstats_reply(size_t nruns)
+{
+	xpc_object_t reply = xpc_dictionary_create(NULL, NULL, 0);
+	xpc_object_t runs = xpc_array_create(NULL, 0);
+
+	for (size_t i = 0; i < nruns; i++) {
+		xpc_object_t run = xpc_dictionary_create(NULL, NULL, 0);
+		struct rusage ru = {};
+		ru.ru_utime.tv_sec = (time_t)(i % 13);
+		ru.ru_utime.tv_usec = (suseconds_t)(i * 7919 % 1000000);
+		ru.ru_stime.tv_usec = (suseconds_t)(i * 104729 % 1000000);
+		ru.ru_maxrss = (long)(1 << 20) + (long)i * 4096;
+		ru.ru_minflt = (long)i * 3;
+		ru.ru_inblock = (long)i % 17;
+		xpc_dictionary_set_int64(run, "pid", (int64_t)(1000 + i));
+		xpc_dictionary_set_int64(run, "run-reason", (int64_t)(i % 4));
+		xpc_dictionary_set_uint64(run, "start", 1000000000ull * i);
+		xpc_dictionary_set_uint64(run, "end", 1000000000ull * i + 250000000ull);
+		xpc_dictionary_set_uint64(run, "forks", i % 3);
+		xpc_dictionary_set_uint64(run, "execs", 1);
+		xpc_dictionary_set_bool(run, "dirty-exit", i % 11 == 0);
+		xpc_dictionary_set_bool(run, "idle-exit", i % 2 == 0);
+		xpc_dictionary_set_bool(run, "jettisoned", i % 29 == 0);
+		xpc_dictionary_set_data(run, "rusage", &ru, sizeof(ru));
+		xpc_array_append_value(runs, run);
+		xpc_release(run);
+	}
+	xpc_dictionary_set_value(reply, "runs", runs);
+	xpc_release(runs);
+	return reply;
+}
+
+// A universal binary with nslices 64-bit slices of textsize bytes of code each
+uint8_t *
+fixture_fat_binary(size_t nslices, size_t textsize, size_t *size)
+{
+	static const struct {
+		cpu_type_t cputype;
+		cpu_subtype_t cpusubtype;
+	} archs[] = {
+		{ CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL },
+		{ CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL },
+		{ CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E },
+	};
+	static const char plist[] = "<plist version=\"1.0\"><dict><key>CFBundleIdentifier</key>"
+				    "<string>com.example.fixture</string></dict></plist>";
+	struct corpus_file slices[sizeof(archs) / sizeof(archs[0])] = {};
+	uint8_t *text = calloc(1, textsize), *fat;
+
+	if (nslices > sizeof(archs) / sizeof(archs[0]))
+		nslices = sizeof(archs) / sizeof(archs[0]);
+	const struct corpus_section sections[] = {
+		{ "__TEXT", "__text", text, textsize, 0 },
+		{ "__TEXT", "__info_plist", plist, sizeof(plist) - 1, 0 },
+		{ "__DATA", "__data", text, 4096, 0 },
+	};
+	for (size_t i = 0; i < nslices; i++) {
+		struct corpus_image img = { true, archs[i].cputype, archs[i].cpusubtype, sections, 3 };
+		slices[i].data = corpus_build_thin(&img, &slices[i].size);
+	}
+	fat = corpus_build_fat(false, slices, nslices, size);
+	for (size_t i = 0; i < nslices; i++)
+		free(slices[i].data);
+	free(text);
+	return fat;
+}
+
+/*
+ * A KERN_PROCARGS2 buffer: argc, the exec path and its padding, argv, the
+ * environment and the apple strings.
+ */
+char *
+fixture_procargs(int argc, size_t nenv, size_t *len)
+{
+	char *buf = NULL;
+	FILE *out = open_memstream(&buf, len);
+
+	fwrite(&argc, sizeof(argc), 1, out);
+	fputs("/usr/libexec/fixtured", out);
+	fwrite("\0\0\0\0\0\0\0", 1, 8, out);
+	for (int i = 0; i < argc; i++) {
+		fprintf(out, "--argument-%d", i);
+		fputc('\0', out);
+	}
+	for (size_t i = 0; i < nenv; i++) {
+		fprintf(out, "FIXTURE_VARIABLE_%zu=/some/reasonably/long/value/%zu", i, i * 7919);
+		fputc('\0', out);
+	}
+	fputc('\0', out);
+	fputs("executable_path=/usr/libexec/fixtured", out);
+	fputc('\0', out);
+	fputs("ptr_munge=", out);
+	fputc('\0', out);
+
+	fclose(out);
+	return buf;
+}
+
+static int
+fixture_write_file(const char *dir, const char *name, const void *data, size_t size)
+{
+	char path[1024];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	if ((f = fopen(path, "wb")) == NULL || fwrite(data, 1, size, f) != size) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		if (f != NULL)
+			fclose(f);
+		return 1;
+	}
+	fclose(f);
+	return 0;
+}
+
+static int
+fixture_write_json(const char *dir, const char *name, xpc_object_t obj)
+{
+	char path[1024];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	if ((f = fopen(path, "w")) == NULL) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	launchctl_xpc_object_fprint_json(f, obj);
+	fputc('\n', f);
+	fclose(f);
+	return 0;
+}
+
+// Writes every fixture the benchmarks use to dir, for inspection or for use with launchctl itself
+int
+fixture_write(const char *dir)
+{
+	static const size_t plists[] = { 16, 256, 4096 };
+	char name[64];
+	size_t len;
+	int ret = 0;
+
+	if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		return 1;
+	}
+
+	for (size_t i = 0; i < sizeof(plists) / sizeof(plists[0]); i++) {
+		char *plist = fixture_plist(plists[i], &len);
+		snprintf(name, sizeof(name), "job-%zu.plist", plists[i]);
+		ret |= fixture_write_file(dir, name, plist, len);
+		free(plist);
+	}
+
+	char *env = fixture_dotenv(256, &len);
+	ret |= fixture_write_file(dir, "env-256", env, len);
+	free(env);
+
+	uint8_t *fat = fixture_fat_binary(3, 4 << 20, &len);
+	ret |= fixture_write_file(dir, "universal", fat, len);
+	free(fat);
+
+	char *procargs = fixture_procargs(64, 256, &len);
+	ret |= fixture_write_file(dir, "procargs2", procargs, len);
+	free(procargs);
+
+	xpc_object_t reply = fixture_list_reply(1000);
+	ret |= fixture_write_json(dir, "list-1000.json", reply);
+	xpc_release(reply);
+	reply = fixture_runstats_reply(1000);
+	ret |= fixture_write_json(dir, "runstats-1000.json", reply);
+	xpc_release(reply);
+
+	return ret;
+}
@@ -0,0 +1,48 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <xpc/xpc.h>
+
+#ifndef _LAUNCHCTL_FIXTURES_H_
+#define _LAUNCHCTL_FIXTURES_H_
+
+/*
+ * Synthetic inputs for launchctl_bench: launchd job plists, setenv
+ * --from-file files, the replies launchd sends for XPC_ROUTINE_LIST and
+ * XPC_ROUTINE_RUNSTATS, universal binaries and KERN_PROCARGS2 buffers. Everything is derived from the
+ * sizes asked for, so a given size always produces the same fixture.
+ */
+char *fixture_plist(size_t nkeys, size_t *len);
+char *fixture_dotenv(size_t nvars, size_t *len);
+xpc_object_t fixture_list_reply(size_t nservices);
+xpc_object_t fixture_runstats_reply(size_t nruns);
+uint8_t *fixture_fat_binary(size_t nslices, size_t textsize, size_t *size);
+char *fixture_procargs(int argc, size_t nenv, size_t *len);
+int fixture_write(const char *dir);
+#endif
@@ -0,0 +1,329 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <xpc/xpc.h>
+
+#include "fixtures.h"
+#include "launchctl.h"
+#include "macho.h"
+#include "procargs.h"
+
+#define BENCH_REPEATS 5
+
+static const char *filter;
+static double scale = 1;
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Runs fn iterations times, BENCH_REPEATS times over, and prints one line
+ * of key=value pairs: the median and fastest time per call and, if the
+ * case processes a known number of bytes per call, the throughput.
+ */
+static void
+run(const char *name, int iterations, size_t bytes, void (*fn)(void *), void *ctx)
+{
+	double samples[BENCH_REPEATS];
+
+	if (filter != NULL && strstr(name, filter) == NULL)
+		return;
+	iterations = (int)(iterations * scale);
+	if (iterations < 1)
+		iterations = 1;
+
+	fn(ctx); // warm up caches and lazy initialization
+	for (int r = 0; r < BENCH_REPEATS; r++) {
+		double start = now();
+		for (int i = 0; i < iterations; i++)
+			fn(ctx);
+		samples[r] = (now() - start) / iterations;
+	}
+	qsort(samples, BENCH_REPEATS, sizeof(double), compare_double);
+
+	printf("%s iterations=%d repeats=%d ns_per_op=%.1f min_ns_per_op=%.1f", name, iterations, BENCH_REPEATS,
+	    samples[BENCH_REPEATS / 2] * 1e9, samples[0] * 1e9);
+	if (bytes != 0)
+		printf(" bytes_per_op=%zu mb_per_sec=%.1f", bytes, bytes / samples[BENCH_REPEATS / 2] / 1e6);
+	printf("\n");
+	fflush(stdout);
+}
+
+static void
+bench_service_name(void *ctx)
+{
+	char target[128];
+	xpc_object_t dict = xpc_dictionary_create(NULL, NULL, 0);
+
+	// The target is split in place, so each call needs a fresh copy
+	strlcpy(target, ctx, sizeof(target));
+	(void)launchctl_setup_xpc_dict_for_service_name(target, dict, NULL);
+	xpc_release(dict);
+}
+
+struct load_unload {
+	int count;
+	char **paths;
+};
+
+static void
+bench_load_unload(void *ctx)
+{
+	struct load_unload *lu = ctx;
+	xpc_release(launchctl_parse_load_unload(0, lu->count, lu->paths));
+}
+
+static FILE *devnull;
+
+static void
+bench_object_print(void *ctx)
+{
+	launchctl_xpc_object_fprint(devnull, ctx, NULL, 0);
+}
+
+static void
+bench_object_print_json(void *ctx)
+{
+	launchctl_xpc_object_fprint_json(devnull, ctx);
+}
+
+static void
+bench_from_plist(void *ctx)
+{
+	xpc_object_t plist = launchctl_xpc_from_plist(ctx);
+	if (plist == NULL) {
+		fprintf(stderr, "%s: cannot be parsed\n", (const char *)ctx);
+		exit(1);
+	}
+	xpc_release(plist);
+}
+
+struct macho_case {
+	const char *path;
+	enum macho_io io;
+};
+
+// What plist_cmd does per file: pick the first slice and fetch __TEXT,__info_plist
+static void
+bench_macho(void *ctx)
+{
+	const struct macho_case *mc = ctx;
+	struct macho_file file;
+	struct macho_slice slices[16];
+	struct macho_index idx;
+	const struct macho_section *sect;
+	const void *data;
+	void *commands = NULL, *buf = NULL;
+	uint32_t count;
+	int fd;
+
+	if ((fd = open(mc->path, O_RDONLY)) == -1 || macho_file_open(&file, fd, mc->io) != 0) {
+		perror(mc->path);
+		exit(1);
+	}
+	if (macho_file_slices(&file, slices, 16, &count) != 0 || count == 0 ||
+	    macho_file_index(&file, &slices[0], &idx, &commands) != 0 ||
+	    (sect = macho_index_find(&idx, "__TEXT", "__info_plist")) == NULL ||
+	    macho_file_section(&file, &slices[0], sect, &data, &buf) != 0) {
+		fprintf(stderr, "%s: lookup failed\n", mc->path);
+		exit(1);
+	}
+	free(buf);
+	free(commands);
+	macho_file_close(&file);
+	close(fd);
+}
+
+// The walk procinfo does over every process: argv, then the environment split into keys and values
+static void
+bench_procargs_decode(void *ctx)
+{
+	const struct procargs *pa = ctx;
+	struct procargs_iter it;
+	const char *str;
+	size_t len, total = 0;
+
+	procargs_begin(pa, &it);
+	for (int i = 0; i < pa->argc && procargs_next_arg(&it, &str, &len); i++)
+		total += len;
+	procargs_begin_env(&it);
+	while (procargs_next_env(&it, &str, &len))
+		total += procargs_env_keylen(str, len);
+	if (total == 0)
+		abort();
+}
+
+static void
+bench_procargs_read(void *ctx)
+{
+	if (procargs_read(ctx, getpid()) != 0) {
+		perror("procargs_read");
+		exit(1);
+	}
+}
+
+static int
+write_fixture(const char *dir, const char *name, const void *data, size_t size, char *path, size_t pathsize)
+{
+	snprintf(path, pathsize, "%s/%s", dir, name);
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1 || write(fd, data, size) != (ssize_t)size) {
+		perror(path);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *outdir = NULL;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "f:s:w:")) != -1) {
+		switch (ch) {
+			case 'f':
+				filter = optarg;
+				break;
+			case 's':
+				scale = atof(optarg);
+				break;
+			case 'w':
+				outdir = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-f filter] [-s scale] [-w fixture-dir]\n", getprogname());
+				return 64;
+		}
+	}
+	if (outdir != NULL)
+		return fixture_write(outdir);
+	if (scale <= 0) {
+		fprintf(stderr, "usage: %s [-f filter] [-s scale] [-w fixture-dir]\n", getprogname());
+		return 64;
+	}
+
+	if ((devnull = fopen("/dev/null", "w")) == NULL) {
+		perror("/dev/null");
+		return 1;
+	}
+
+	// Domain targets only: "system/<name>" can ask launchd whether the service lives in the foreground user
+	run("service_name.gui", 200000, 0, bench_service_name, "gui/501/com.example.fixture");
+	run("service_name.user", 200000, 0, bench_service_name, "user/501/com.example.fixture");
+	run("service_name.pid", 200000, 0, bench_service_name, "pid/1/com.example.fixture");
+	run("service_name.system", 200000, 0, bench_service_name, "system");
+
+	char *paths[64];
+	for (int i = 0; i < 64; i++)
+		asprintf(&paths[i], "LaunchDaemons/com.example.fixture.%d.plist", i);
+	struct load_unload lu = { 64, paths };
+	run("parse_load_unload.64", 2000, 0, bench_load_unload, &lu);
+	for (int i = 0; i < 64; i++)
+		free(paths[i]);
+
+	xpc_object_t list = fixture_list_reply(1000), runstats = fixture_runstats_reply(1000);
+	run("object_print.list1000", 50, 0, bench_object_print, list);
+	run("object_print.runstats1000", 20, 0, bench_object_print, runstats);
+	run("object_print_json.list1000", 50, 0, bench_object_print_json, list);
+	run("object_print_json.runstats1000", 20, 0, bench_object_print_json, runstats);
+	xpc_release(list);
+	xpc_release(runstats);
+
+	char dir[] = "/tmp/launchctl_bench.XXXXXX", path[1024];
+	if (mkdtemp(dir) == NULL) {
+		perror(dir);
+		return 1;
+	}
+
+	static const struct {
+		const char *name;
+		size_t nkeys;
+		int iterations;
+	} plists[] = {
+		{ "from_plist.16", 16, 20000 },
+		{ "from_plist.256", 256, 2000 },
+		{ "from_plist.4096", 4096, 100 },
+	};
+	for (size_t i = 0; i < sizeof(plists) / sizeof(plists[0]); i++) {
+		size_t len;
+		char *plist = fixture_plist(plists[i].nkeys, &len);
+		if (write_fixture(dir, "job.plist", plist, len, path, sizeof(path)) == 0)
+			run(plists[i].name, plists[i].iterations, len, bench_from_plist, path);
+		unlink(path);
+		free(plist);
+	}
+
+	size_t size;
+	uint8_t *fat = fixture_fat_binary(3, 4 << 20, &size);
+	if (write_fixture(dir, "universal", fat, size, path, sizeof(path)) == 0) {
+		struct macho_case mmapCase = { path, MACHO_IO_MMAP }, preadCase = { path, MACHO_IO_PREAD };
+		run("macho_plist.mmap", 20000, 0, bench_macho, &mmapCase);
+		run("macho_plist.pread", 20000, 0, bench_macho, &preadCase);
+	}
+	unlink(path);
+	free(fat);
+	rmdir(dir);
+
+	struct procargs pa = {};
+	pa.buf = fixture_procargs(64, 256, &pa.len);
+	pa.cap = pa.len;
+	memcpy(&pa.argc, pa.buf, sizeof(pa.argc));
+	run("procargs_decode.64x256", 100000, pa.len, bench_procargs_decode, &pa);
+	procargs_destroy(&pa);
+
+	struct procargs self = {};
+	run("procargs_read.self", 20000, 0, bench_procargs_read, &self);
+	procargs_destroy(&self);
+
+	fclose(devnull);
+	return 0;
+}
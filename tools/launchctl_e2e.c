@@ -0,0 +1,473 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fixtures.h"
+
+extern char **environ;
+
+/*
+ * One run of a subcommand per row. "@SERVICE", "@PLIST", "@BINARY",
+ * "@TARGETS", "@ENV" and "@PID" in the arguments are replaced by a service
+ * of the simulated domain, a job plist, a universal binary, a file of
+ * service targets, a setenv --from-file file and the pid of this process.
+ * Globs match services 40 to 49, which every domain size has.
+ */
+#define MAX_ARGS 8
+
+static const struct {
+	const char *row;
+	const char *command;
+	const char *args[MAX_ARGS];
+} invocations[] = {
+	{ "bootstrap", "bootstrap", { "system", "@PLIST" } },
+	{ "bootout", "bootout", { "@SERVICE" } },
+	{ "enable", "enable", { "@SERVICE" } },
+	{ "enable.many", "enable", { "system/com.example.fixture.1", "system/com.example.fixture.2", "@SERVICE" } },
+	{ "enable.glob", "enable", { "system/com.example.fixture.4?" } },
+	{ "enable.from-file", "enable", { "--from-file", "@TARGETS" } },
+	{ "disable", "disable", { "@SERVICE" } },
+	{ "disable.glob", "disable", { "system/com.example.fixture.4?" } },
+	{ "uncache", "uncache", { "com.example.fixture.1" } },
+	{ "kickstart", "kickstart", { "@SERVICE" } },
+	{ "kickstart.many", "kickstart", { "system/com.example.fixture.1", "system/com.example.fixture.2", "@SERVICE" } },
+	{ "kickstart.wait", "kickstart", { "-w", "5", "system/com.example.fixture.4?" } },
+	{ "restart", "restart", { "--rolling", "--timeout", "1", "@SERVICE" } },
+	{ "debug", "debug", { "@SERVICE" } },
+	{ "kill", "kill", { "TERM", "@SERVICE" } },
+	{ "kill.many", "kill", { "TERM", "system/com.example.fixture.1", "system/com.example.fixture.2", "@SERVICE" } },
+	{ "kill.glob", "kill", { "TERM", "system/com.example.fixture.4?" } },
+	{ "blame", "blame", { "@SERVICE" } },
+	{ "print.domain", "print", { "system" } },
+	{ "print.service", "print", { "@SERVICE" } },
+	{ "print-cache", "print-cache", {} },
+	{ "print-disabled", "print-disabled", {} },
+	{ "plist", "plist", { "@BINARY" } },
+	{ "entitlements", "entitlements", { "@BINARY" } },
+	{ "procinfo", "procinfo", { "@PID" } },
+	{ "hostinfo", "hostinfo", {} },
+	{ "resolveport", "resolveport", { "@PID", "0x103" } },
+	{ "limit", "limit", {} },
+	{ "runstats.service", "runstats", { "@SERVICE" } },
+	{ "runstats.all", "runstats", { "--all", "system" } },
+	{ "config", "config", {} },
+	{ "dumpstate", "dumpstate", {} },
+	{ "dump-xsc", "dump-xsc", {} },
+	{ "dumpjpcategory", "dumpjpcategory", {} },
+	{ "load", "load", { "@PLIST" } },
+	{ "unload", "unload", { "@PLIST" } },
+	{ "remove", "remove", { "com.example.fixture.1" } },
+	{ "list.domain", "list", {} },
+	{ "list.service", "list", { "com.example.fixture.1" } },
+	{ "start", "start", { "com.example.fixture.1" } },
+	{ "start.many", "start", { "com.example.fixture.1", "com.example.fixture.2", "com.example.fixture.4" } },
+	{ "start.wait", "start", { "-w", "5", "com.example.fixture.4?" } },
+	{ "stop", "stop", { "com.example.fixture.1" } },
+	{ "stop.wait", "stop", { "-w", "5", "com.example.fixture.4?" } },
+	{ "setenv", "setenv", { "FIXTURE", "value" } },
+	{ "setenv.from-file", "setenv", { "--from-file", "@ENV" } },
+	{ "setenv.diff", "setenv", { "--diff", "--from-file", "@ENV" } },
+	{ "unsetenv", "unsetenv", { "FIXTURE" } },
+	{ "unsetenv.from-file", "unsetenv", { "--from-file", "@ENV" } },
+	{ "getenv", "getenv", { "FIXTURE" } },
+	{ "submit", "submit", { "-l", "com.example.fixture", "--", "/usr/bin/true" } },
+	{ "managerpid", "managerpid", {} },
+	{ "manageruid", "manageruid", {} },
+	{ "managername", "managername", {} },
+	{ "error", "error", { "posix", "1" } },
+	{ "variant", "variant", {} },
+	{ "version", "version", {} },
+	{ "help", "help", {} },
+};
+
+// These start a debugger or another program, reboot, or switch users, stand-in or not
+static const char *const skipped[] = { "attach", "examine", "reboot", "enter-rem", "enter-rem-dev", "userswitch",
+	"bsexec", "asuser" };
+
+// Files the "@..." arguments stand for
+struct files {
+	char plist[1024];
+	char binary[1024];
+	char targets[1024];
+	char env[1024];
+};
+
+struct sample {
+	double wall;
+	double cpu;
+	long rss;
+	size_t bytes;
+	int status;
+};
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of n sorted values
+static double
+percentile(const double *sorted, int n, double p)
+{
+	int rank = (int)ceil(p * n);
+	return sorted[rank < 1 ? 0 : rank - 1];
+}
+
+/*
+ * Runs launchctl once with stdout and stderr on a pipe that is drained and
+ * counted, and takes CPU time and peak RSS from wait4(2).
+ */
+static int
+measure(const char *launchctl, char **argv, char **envp, struct sample *s)
+{
+	posix_spawn_file_actions_t actions;
+	struct rusage ru;
+	char buf[65536];
+	int fds[2], status, ret;
+	ssize_t n;
+	pid_t pid;
+
+	if (pipe(fds) == -1)
+		return errno;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+	posix_spawn_file_actions_addclose(&actions, fds[0]);
+
+	double start = now();
+	ret = posix_spawn(&pid, launchctl, &actions, NULL, argv, envp);
+	posix_spawn_file_actions_destroy(&actions);
+	close(fds[1]);
+	if (ret != 0) {
+		close(fds[0]);
+		return ret;
+	}
+
+	s->bytes = 0;
+	while ((n = read(fds[0], buf, sizeof(buf))) != 0) {
+		if (n == -1 && errno != EINTR)
+			break;
+		if (n > 0)
+			s->bytes += (size_t)n;
+	}
+	close(fds[0]);
+	while (wait4(pid, &status, 0, &ru) == -1 && errno == EINTR)
+		;
+	s->wall = now() - start;
+	s->cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+	s->rss = ru.ru_maxrss;
+	s->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+	return 0;
+}
+
+static bool
+is_covered(const char *command)
+{
+	for (size_t i = 0; i < sizeof(invocations) / sizeof(invocations[0]); i++) {
+		if (strcmp(invocations[i].command, command) == 0)
+			return true;
+	}
+	for (size_t i = 0; i < sizeof(skipped) / sizeof(skipped[0]); i++) {
+		if (strcmp(skipped[i], command) == 0)
+			return true;
+	}
+	return false;
+}
+
+// Lists the subcommands `launchctl help` knows about that have no row here, so the table cannot silently fall behind
+static int
+check_coverage(const char *launchctl, char **envp)
+{
+	char *argv[] = { (char *)launchctl, "help", NULL };
+	char path[] = "/tmp/launchctl_e2e.help.XXXXXX", line[256];
+	posix_spawn_file_actions_t actions;
+	bool commands = false;
+	int fd, status, missing = 0;
+	pid_t pid;
+	FILE *f;
+
+	if ((fd = mkstemp(path)) == -1)
+		return -1;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fd, STDOUT_FILENO);
+	if (posix_spawn(&pid, launchctl, &actions, NULL, argv, envp) != 0) {
+		posix_spawn_file_actions_destroy(&actions);
+		close(fd);
+		unlink(path);
+		return -1;
+	}
+	posix_spawn_file_actions_destroy(&actions);
+	waitpid(pid, &status, 0);
+
+	f = fdopen(fd, "r");
+	rewind(f);
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char name[64];
+		if (strcmp(line, "Subcommands:\n") == 0)
+			commands = true;
+		else if (commands && sscanf(line, "\t%63s", name) == 1 && !is_covered(name)) {
+			fprintf(stderr, "uncovered subcommand: %s\n", name);
+			missing++;
+		}
+	}
+	fclose(f);
+	unlink(path);
+	return missing;
+}
+
+static char **
+make_env(const char *sim, size_t services, unsigned latency)
+{
+	size_t n = 0;
+	while (environ[n] != NULL)
+		n++;
+
+	char **envp = calloc(n + 4, sizeof(char *)), **p = envp;
+	for (size_t i = 0; i < n; i++) {
+		if (strncmp(environ[i], "DYLD_INSERT_LIBRARIES=", 22) != 0 &&
+		    strncmp(environ[i], "LAUNCHD_SIM_", 12) != 0)
+			*p++ = environ[i];
+	}
+	asprintf(p++, "DYLD_INSERT_LIBRARIES=%s", sim);
+	asprintf(p++, "LAUNCHD_SIM_SERVICES=%zu", services);
+	asprintf(p++, "LAUNCHD_SIM_LATENCY_US=%u", latency);
+	return envp;
+}
+
+static void
+free_env(char **envp)
+{
+	char **p = envp;
+	while (*p != NULL)
+		p++;
+	// make_env appends its three allocated entries last
+	for (int i = 1; i <= 3; i++)
+		free(p[-i]);
+	free(envp);
+}
+
+static void
+run(const char *launchctl, const char *row, const char *command, const char *const *args, char **envp,
+    size_t services, unsigned latency, int runs, const struct files *files)
+{
+	char *argv[MAX_ARGS + 3], pid[16], service[64];
+	double *wall = calloc(runs, sizeof(double)), *cpu = calloc(runs, sizeof(double));
+	struct sample s = {};
+	long rss = 0;
+	int argc = 0, ret;
+
+	snprintf(pid, sizeof(pid), "%d", getpid());
+	// Some service that exists in every domain size
+	snprintf(service, sizeof(service), "system/com.example.fixture.%zu", services / 2);
+
+	argv[argc++] = (char *)launchctl;
+	argv[argc++] = (char *)command;
+	for (int i = 0; i < MAX_ARGS && args[i] != NULL; i++) {
+		if (strcmp(args[i], "@SERVICE") == 0)
+			argv[argc++] = service;
+		else if (strcmp(args[i], "@PLIST") == 0)
+			argv[argc++] = (char *)files->plist;
+		else if (strcmp(args[i], "@BINARY") == 0)
+			argv[argc++] = (char *)files->binary;
+		else if (strcmp(args[i], "@TARGETS") == 0)
+			argv[argc++] = (char *)files->targets;
+		else if (strcmp(args[i], "@ENV") == 0)
+			argv[argc++] = (char *)files->env;
+		else if (strcmp(args[i], "@PID") == 0)
+			argv[argc++] = pid;
+		else
+			argv[argc++] = (char *)args[i];
+	}
+	argv[argc] = NULL;
+
+	for (int i = 0; i < runs; i++) {
+		if ((ret = measure(launchctl, argv, envp, &s)) != 0) {
+			fprintf(stderr, "%s: %s\n", launchctl, strerror(ret));
+			exit(1);
+		}
+		wall[i] = s.wall;
+		cpu[i] = s.cpu;
+		if (s.rss > rss)
+			rss = s.rss;
+	}
+	qsort(wall, runs, sizeof(double), compare_double);
+	qsort(cpu, runs, sizeof(double), compare_double);
+
+#ifdef __APPLE__
+	rss /= 1024; // bytes on Darwin, kilobytes elsewhere
+#endif
+	printf("%s services=%zu latency_us=%u runs=%d exit=%d wall_p50_ms=%.3f wall_p99_ms=%.3f cpu_p50_ms=%.3f "
+	       "cpu_p99_ms=%.3f peak_rss_kb=%ld bytes_written=%zu\n",
+	    row, services, latency, runs, s.status, percentile(wall, runs, 0.5) * 1e3, percentile(wall, runs, 0.99) * 1e3,
+	    percentile(cpu, runs, 0.5) * 1e3, percentile(cpu, runs, 0.99) * 1e3, rss, s.bytes);
+	fflush(stdout);
+
+	free(wall);
+	free(cpu);
+}
+
+static int
+write_file(const char *path, const void *data, size_t size)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1 || write(fd, data, size) != (ssize_t)size) {
+		perror(path);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+	    "usage: %s [-l launchctl] [-d launchd_sim.dylib] [-n runs] [-s services[,services...]] [-L latency-us] "
+	    "[-f filter]\n",
+	    getprogname());
+	exit(64);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *launchctl = "../launchctl", *sim = "./launchd_sim.dylib", *filter = NULL;
+	char *sizes = strdup("100,1000,10000"), simpath[1024];
+	unsigned latency = 0;
+	int runs = 20, ch;
+
+	while ((ch = getopt(argc, argv, "l:d:n:s:L:f:")) != -1) {
+		switch (ch) {
+			case 'l':
+				launchctl = optarg;
+				break;
+			case 'd':
+				sim = optarg;
+				break;
+			case 'n':
+				runs = atoi(optarg);
+				break;
+			case 's':
+				free(sizes);
+				sizes = strdup(optarg);
+				break;
+			case 'L':
+				latency = (unsigned)strtoul(optarg, NULL, 10);
+				break;
+			case 'f':
+				filter = optarg;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (runs < 1)
+		usage();
+	// dyld resolves DYLD_INSERT_LIBRARIES relative to the child's working directory, which is ours, but be explicit
+	if (realpath(sim, simpath) == NULL) {
+		perror(sim);
+		return 1;
+	}
+
+	char dir[] = "/tmp/launchctl_e2e.XXXXXX";
+	struct files files;
+	if (mkdtemp(dir) == NULL) {
+		perror(dir);
+		return 1;
+	}
+	size_t len, envlen;
+	char *job = fixture_plist(16, &len);
+	char *env = fixture_dotenv(64, &envlen);
+	uint8_t *fat = fixture_fat_binary(2, 1 << 20, &len);
+	static const char targets[] = "# enable --from-file\nsystem/com.example.fixture.1\nsystem/com.example.fixture.2\n\n"
+	                              "system/com.example.fixture.4?\n";
+	snprintf(files.plist, sizeof(files.plist), "%s/com.example.fixture.plist", dir);
+	snprintf(files.binary, sizeof(files.binary), "%s/universal", dir);
+	snprintf(files.targets, sizeof(files.targets), "%s/targets", dir);
+	snprintf(files.env, sizeof(files.env), "%s/env", dir);
+	if (write_file(files.plist, job, strlen(job)) != 0 || write_file(files.binary, fat, len) != 0 ||
+	    write_file(files.targets, targets, sizeof(targets) - 1) != 0 || write_file(files.env, env, envlen) != 0)
+		return 1;
+	free(job);
+	free(env);
+	free(fat);
+
+	char **coverageEnv = make_env(simpath, 100, 0);
+	if (check_coverage(launchctl, coverageEnv) != 0)
+		fprintf(stderr, "warning: add the subcommands above to invocations[] in %s\n", __FILE__);
+	free_env(coverageEnv);
+
+	for (char *p = sizes, *size; (size = strsep(&p, ",")) != NULL;) {
+		size_t services = strtoul(size, NULL, 10);
+		char **envp = make_env(simpath, services, latency);
+		static const char *const none[] = { "posix", "1", NULL };
+
+		// Never talks to launchd: the floor every other row pays for exec, dyld and the stand-in's setup
+		if (filter == NULL || strstr("baseline", filter) != NULL)
+			run(launchctl, "baseline", "error", none, envp, services, latency, runs, &files);
+		for (size_t i = 0; i < sizeof(invocations) / sizeof(invocations[0]); i++) {
+			if (filter != NULL && strstr(invocations[i].row, filter) == NULL)
+				continue;
+			run(launchctl, invocations[i].row, invocations[i].command, invocations[i].args, envp, services, latency,
+			    runs, &files);
+		}
+		free_env(envp);
+	}
+	free(sizes);
+
+	unlink(files.plist);
+	unlink(files.binary);
+	unlink(files.targets);
+	unlink(files.env);
+	rmdir(dir);
+	return 0;
+}
@@ -0,0 +1,278 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/mman.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <xpc/xpc.h>
+
+#include "fixtures.h"
+#include "xpc_private.h"
+
+#define DYLD_INTERPOSE(_replacement, _replacee)                                                            \
+	__attribute__((used)) static struct {                                                              \
+		const void *replacement;                                                                   \
+		const void *replacee;                                                                      \
+	} _interpose_##_replacee                                                                           \
+	    __attribute__((section("__DATA,__interpose"))) = { (const void *)(unsigned long)&_replacement, \
+		    (const void *)(unsigned long)&_replacee };
+
+XPC_EXPORT size_t xpc_shmem_map(xpc_object_t xshmem, void **region);
+
+/*
+ * Stand-in for launchd. Every request launchctl sends down the bootstrap
+ * pipe is answered in-process with a synthetic reply for a system domain of
+ * LAUNCHD_SIM_SERVICES services (default 1000), after sleeping for
+ * LAUNCHD_SIM_LATENCY_US microseconds (default 0). Nothing reaches the
+ * real launchd, so every subcommand is safe to run against it. The stand-in
+ * runs inside launchctl, so replies are built once up front to keep its own
+ * cost out of what is measured.
+ */
+static size_t nservices = 1000;
+static useconds_t latency;
+static xpc_object_t list_reply, runs;
+static char *domain_text, *dumpstate_text;
+static size_t domain_len, dumpstate_len;
+// Kickstarts and starts give a service a new pid in list_reply, as a (re)spawn would; stops clear it
+static pthread_mutex_t services_lock = PTHREAD_MUTEX_INITIALIZER;
+static int64_t next_pid = 20000;
+
+static char *sim_print_text(uint64_t routine, xpc_object_t request, size_t *len);
+
+__attribute__((constructor)) static void
+sim_init(void)
+{
+	const char *env;
+
+	if ((env = getenv("LAUNCHD_SIM_SERVICES")) != NULL)
+		nservices = strtoul(env, NULL, 10);
+	if ((env = getenv("LAUNCHD_SIM_LATENCY_US")) != NULL)
+		latency = (useconds_t)strtoul(env, NULL, 10);
+	list_reply = fixture_list_reply(nservices);
+	xpc_object_t runstats = fixture_runstats_reply(16);
+	runs = xpc_retain(xpc_dictionary_get_value(runstats, "runs"));
+	xpc_release(runstats);
+
+	xpc_object_t request = xpc_dictionary_create(NULL, NULL, 0);
+	domain_text = sim_print_text(XPC_ROUTINE_PRINT, request, &domain_len);
+	dumpstate_text = sim_print_text(XPC_ROUTINE_DUMPSTATE, request, &dumpstate_len);
+	xpc_release(request);
+}
+
+// What launchd prints for the routines that answer through shared memory or a file descriptor
+static char *
+sim_print_text(uint64_t routine, xpc_object_t request, size_t *len)
+{
+	const char *name = xpc_dictionary_get_string(request, "name");
+	char *buf = NULL;
+	FILE *out = open_memstream(&buf, len);
+
+	if (xpc_dictionary_get_bool(request, "version")) {
+		fprintf(out, "Darwin System Bootstrapper Version 7.0.0: launchd_sim\n");
+	} else if (xpc_dictionary_get_bool(request, "variant")) {
+		fprintf(out, "RELEASE\n");
+	} else if (routine == XPC_ROUTINE_PRINT_SERVICE || name != NULL) {
+		fprintf(out, "system/%s = {\n\tactive count = 1\n\tpath = /Library/LaunchDaemons/%s.plist\n",
+		    name != NULL ? name : "com.example.fixture", name != NULL ? name : "com.example.fixture");
+		fprintf(out, "\tstate = running\n\n\tprogram = /usr/libexec/fixtured\n\targuments = {\n");
+		for (int i = 0; i < 16; i++)
+			fprintf(out, "\t\t--option-%d\n", i);
+		fprintf(out, "\t}\n\n\tenvironment = {\n");
+		for (int i = 0; i < 32; i++)
+			fprintf(out, "\t\tFIXTURE_VARIABLE_%d => %d\n", i, i * 7919);
+		fprintf(out, "\t}\n\n\tpid = 101\n\timmediate reason = ipc (mach)\n}\n");
+	} else {
+		size_t n = routine == XPC_ROUTINE_DUMPSTATE ? nservices * 4 : nservices;
+		fprintf(out, "system = {\n\ttype = system\n\thandle = 0\n\tactive count = %zu\n\n\tservices = {\n",
+		    nservices / 3);
+		for (size_t i = 0; i < n; i++)
+			fprintf(out, "\t\t%zu\t%d\tcom.example.fixture.%zu\n", i % 3 == 0 ? 100 + i : 0, 0, i % nservices);
+		fprintf(out, "\t}\n}\n");
+	}
+
+	fclose(out);
+	return buf;
+}
+
+static void
+sim_print(uint64_t routine, xpc_object_t request, xpc_object_t reply)
+{
+	xpc_object_t shmem = xpc_dictionary_get_value(request, "shmem");
+	const char *text;
+	char *buf = NULL;
+	size_t len;
+
+	if (routine == XPC_ROUTINE_DUMPSTATE) {
+		text = dumpstate_text;
+		len = dumpstate_len;
+	} else if (routine == XPC_ROUTINE_PRINT && xpc_dictionary_get_string(request, "name") == NULL &&
+	    !xpc_dictionary_get_bool(request, "version") && !xpc_dictionary_get_bool(request, "variant")) {
+		text = domain_text;
+		len = domain_len;
+	} else {
+		text = buf = sim_print_text(routine, request, &len);
+	}
+
+	if (shmem != NULL) {
+		void *region;
+		size_t size = xpc_shmem_map(shmem, &region);
+		if (size != 0) {
+			if (len > size)
+				len = size;
+			memcpy(region, text, len);
+			munmap(region, size);
+			xpc_dictionary_set_uint64(reply, "bytes-written", len);
+		}
+	} else {
+		int fd = xpc_dictionary_dup_fd(request, "fd");
+		if (fd != -1) {
+			(void)write(fd, text, len);
+			close(fd);
+		}
+	}
+	free(buf);
+}
+
+static xpc_object_t
+sim_reply(uint64_t routine, xpc_object_t request)
+{
+	const char *name = xpc_dictionary_get_string(request, "name");
+	xpc_object_t reply = xpc_dictionary_create(NULL, NULL, 0);
+
+	switch (routine) {
+		case XPC_ROUTINE_LIST:
+			if (name == NULL) {
+				xpc_release(reply);
+				pthread_mutex_lock(&services_lock);
+				reply = xpc_retain(list_reply);
+				pthread_mutex_unlock(&services_lock);
+				return reply;
+			} else {
+				xpc_object_t service = xpc_dictionary_create(NULL, NULL, 0);
+				xpc_dictionary_set_string(service, "Label", name);
+				xpc_dictionary_set_int64(service, "PID", 101);
+				xpc_dictionary_set_int64(service, "LastExitStatus", 0);
+				xpc_dictionary_set_value(reply, "service", service);
+				xpc_release(service);
+			}
+			break;
+		case XPC_ROUTINE_RUNSTATS:
+			xpc_dictionary_set_value(reply, "runs", runs);
+			break;
+		case XPC_ROUTINE_PRINT:
+		case XPC_ROUTINE_PRINT_SERVICE:
+		case XPC_ROUTINE_DUMPSTATE:
+		case XPC_ROUTINE_DUMP_XSC:
+		case XPC_ROUTINE_DUMPJPCATEGORY:
+		case XPC_ROUTINE_LIMIT:
+			sim_print(routine, request, reply);
+			break;
+		case XPC_ROUTINE_GETENV:
+			xpc_dictionary_set_string(reply, "value", "fixture");
+			break;
+		case XPC_ROUTINE_BLAME_SERVICE:
+			xpc_dictionary_set_string(reply, "reason", "ipc (mach)");
+			break;
+		case XPC_ROUTINE_KICKSTART_SERVICE: {
+			xpc_object_t services = xpc_dictionary_get_value(list_reply, "services"), service;
+			pthread_mutex_lock(&services_lock);
+			if (name != NULL && (service = xpc_dictionary_get_value(services, name)) != NULL) {
+				xpc_dictionary_set_int64(service, "pid", next_pid);
+				xpc_dictionary_set_int64(reply, "pid", next_pid++);
+			} else {
+				xpc_dictionary_set_int64(reply, "error", ENOSERVICE);
+			}
+			pthread_mutex_unlock(&services_lock);
+			break;
+		}
+		case XPC_ROUTINE_SERVICE_START:
+		case XPC_ROUTINE_SERVICE_STOP: {
+			xpc_object_t services = xpc_dictionary_get_value(list_reply, "services"), service;
+			bool running;
+			pthread_mutex_lock(&services_lock);
+			if (name != NULL && (service = xpc_dictionary_get_value(services, name)) != NULL) {
+				running = xpc_dictionary_get_int64(service, "pid") != 0;
+				if (routine == XPC_ROUTINE_SERVICE_START ? running : !running)
+					xpc_dictionary_set_int64(reply, "error", EALREADY);
+				else
+					xpc_dictionary_set_int64(service, "pid", routine == XPC_ROUTINE_SERVICE_START ? next_pid++ : 0);
+			} else {
+				xpc_dictionary_set_int64(reply, "error", ENOSERVICE);
+			}
+			pthread_mutex_unlock(&services_lock);
+			break;
+		}
+		case XPC_ROUTINE_RESOLVE_PORT:
+			xpc_dictionary_set_string(reply, "domain", "system");
+			xpc_dictionary_set_string(reply, "service", "com.example.fixture.1");
+			xpc_dictionary_set_string(reply, "endpoint", "com.example.fixture.1.xpc");
+			break;
+		case XPC_ROUTINE_LOAD:
+		case XPC_ROUTINE_UNLOAD:
+		case XPC_ROUTINE_ENABLE:
+		case XPC_ROUTINE_DISABLE: {
+			xpc_object_t errors = xpc_dictionary_create(NULL, NULL, 0);
+			xpc_dictionary_set_value(reply, "errors", errors);
+			xpc_release(errors);
+			break;
+		}
+	}
+	return reply;
+}
+
+static int
+sim_routine(xpc_object_t request, xpc_object_t *reply)
+{
+	if (latency != 0)
+		usleep(latency);
+	*reply = sim_reply(xpc_dictionary_get_uint64(request, "routine"), request);
+	return 0;
+}
+
+int
+sim_xpc_pipe_routine(xpc_pipe_t pipe, xpc_object_t request, xpc_object_t XPC_GIVES_REFERENCE *reply)
+{
+	return sim_routine(request, reply);
+}
+
+DYLD_INTERPOSE(sim_xpc_pipe_routine, xpc_pipe_routine);
+
+int
+sim_xpc_pipe_interface_routine(xpc_pipe_t pipe, uint64_t routine, xpc_object_t request,
+    xpc_object_t XPC_GIVES_REFERENCE *reply, uint64_t flags)
+{
+	return sim_routine(request, reply);
+}
+
+DYLD_INTERPOSE(sim_xpc_pipe_interface_routine, _xpc_pipe_interface_routine);
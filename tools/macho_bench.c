@@ -0,0 +1,257 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "macho.h"
+#include "macho_corpus.h"
+
+static struct macho_index idx;
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// What plist_cmd does per file: pick the first slice and fetch __TEXT,__info_plist
+static uint8_t
+checked_lookup(const uint8_t *data, size_t size)
+{
+	struct macho_slice slices[16];
+	uint32_t count;
+
+	if (macho_slices(data, size, slices, 16, &count) != 0 || count == 0)
+		return 0;
+	if (macho_index_build(&idx, data + slices[0].offset, slices[0].size) != 0)
+		return 0;
+	const struct macho_section *sect = macho_index_find(&idx, "__TEXT", "__info_plist");
+	const uint8_t *p = sect == NULL ? NULL : macho_section_data(&idx, sect);
+	return p == NULL || sect->size == 0 ? 0 : p[0];
+}
+
+/*
+ * The walk plist.c did before it was bounds-checked, kept as a speed
+ * reference. It trusts the file, so it only ever sees well-formed input.
+ */
+static uint8_t
+legacy_lookup(const uint8_t *data, size_t size)
+{
+	const uint8_t *header = data;
+	uint32_t magic;
+
+	memcpy(&magic, data, sizeof(magic));
+	if (magic == FAT_CIGAM || magic == FAT_CIGAM_64) {
+		const struct fat_arch *arch = (const struct fat_arch *)(data + sizeof(struct fat_header));
+		header = data + __builtin_bswap32(arch->offset);
+		if (magic == FAT_CIGAM_64) {
+			const struct fat_arch_64 *arch64 = (const struct fat_arch_64 *)arch;
+			header = data + __builtin_bswap64(arch64->offset);
+		}
+		memcpy(&magic, header, sizeof(magic));
+	}
+	if (magic != MH_MAGIC_64)
+		return 0;
+
+	const struct mach_header_64 *mh = (const struct mach_header_64 *)header;
+	const struct load_command *lc = (const struct load_command *)(header + sizeof(*mh));
+	for (uint32_t i = 0; i < mh->ncmds; i++, lc = (const struct load_command *)((uintptr_t)lc + lc->cmdsize)) {
+		if (lc->cmd != LC_SEGMENT_64)
+			continue;
+		const struct segment_command_64 *seg = (const struct segment_command_64 *)lc;
+		if (strcmp(seg->segname, "__TEXT") != 0)
+			continue;
+		const struct section_64 *sect = (const struct section_64 *)(seg + 1);
+		for (uint32_t k = 0; k < seg->nsects; k++) {
+			if (strcmp(sect[k].sectname, "__info_plist") == 0)
+				return header[sect[k].offset];
+		}
+	}
+	return 0;
+}
+
+static void
+run(const char *name, const struct corpus_file *files, size_t count, int kind, int iterations,
+    uint8_t (*lookup)(const uint8_t *, size_t))
+{
+	volatile uint8_t sink = 0;
+	size_t nfiles = 0, nbytes = 0;
+	double start, elapsed;
+
+	for (size_t i = 0; i < count; i++) {
+		if (kind < 0 || files[i].kind == (enum corpus_kind)kind) {
+			nfiles++;
+			nbytes += files[i].size;
+		}
+	}
+	if (nfiles == 0)
+		return;
+
+	start = now();
+	for (int it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			if (kind < 0 || files[i].kind == (enum corpus_kind)kind)
+				sink ^= lookup(files[i].data, files[i].size);
+		}
+	}
+	elapsed = now() - start;
+	(void)sink;
+
+	printf("%s files=%zu bytes=%zu iterations=%d seconds=%.6f files_per_sec=%.0f mb_per_sec=%.1f\n", name, nfiles,
+	    nbytes, iterations, elapsed, nfiles * iterations / elapsed, nbytes * (double)iterations / elapsed / 1e6);
+}
+
+/*
+ * The same lookups including open, fstat and mmap, which is what a scan
+ * actually pays per file; the parse itself should be noise next to it.
+ */
+static void
+run_files(const char *name, const char *dir, const struct corpus_file *files, size_t count, int iterations,
+    uint8_t (*lookup)(const uint8_t *, size_t))
+{
+	volatile uint8_t sink = 0;
+	size_t nfiles = 0, nbytes = 0;
+	char path[1024];
+	double start, elapsed;
+
+	start = now();
+	for (int it = 0; it < iterations; it++) {
+		for (size_t i = 0; i < count; i++) {
+			if (files[i].kind == CORPUS_MALFORMED)
+				continue;
+			snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+			int fd = open(path, O_RDONLY);
+			struct stat st;
+			if (fd == -1 || fstat(fd, &st) == -1) {
+				perror(path);
+				exit(1);
+			}
+			void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			sink ^= lookup(map, st.st_size);
+			munmap(map, st.st_size);
+			close(fd);
+			if (it == 0) {
+				nfiles++;
+				nbytes += st.st_size;
+			}
+		}
+	}
+	elapsed = now() - start;
+	(void)sink;
+
+	printf("%s files=%zu bytes=%zu iterations=%d seconds=%.6f files_per_sec=%.0f mb_per_sec=%.1f\n", name, nfiles,
+	    nbytes, iterations, elapsed, nfiles * iterations / elapsed, nbytes * (double)iterations / elapsed / 1e6);
+}
+
+static int
+write_corpus(const char *dir, const struct corpus_file *files, size_t count)
+{
+	char path[1024];
+
+	if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+		fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+		return 1;
+	}
+	for (size_t i = 0; i < count; i++) {
+		snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+		FILE *f = fopen(path, "wb");
+		if (f == NULL || fwrite(files[i].data, 1, files[i].size, f) != files[i].size) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			return 1;
+		}
+		fclose(f);
+	}
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct corpus_file *files;
+	const char *outdir = NULL;
+	int iterations = 200, ch;
+
+	while ((ch = getopt(argc, argv, "n:w:")) != -1) {
+		switch (ch) {
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+			case 'w':
+				outdir = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-n iterations] [-w corpus-dir]\n", getprogname());
+				return 64;
+		}
+	}
+
+	size_t count = corpus_generate(&files);
+	if (outdir != NULL) {
+		int ret = write_corpus(outdir, files, count);
+		corpus_free(files, count);
+		return ret;
+	}
+
+	for (int kind = 0; kind < CORPUS_NKINDS; kind++) {
+		char name[64];
+		snprintf(name, sizeof(name), "checked.%s", corpus_kind_name(kind));
+		run(name, files, count, kind, iterations, checked_lookup);
+	}
+	run("checked.all", files, count, -1, iterations, checked_lookup);
+	run("legacy.thin", files, count, CORPUS_THIN, iterations, legacy_lookup);
+	run("legacy.fat", files, count, CORPUS_FAT, iterations, legacy_lookup);
+
+	char dir[] = "/tmp/macho_bench.XXXXXX";
+	if (mkdtemp(dir) != NULL && write_corpus(dir, files, count) == 0) {
+		run_files("checked.files", dir, files, count, iterations, checked_lookup);
+		run_files("legacy.files", dir, files, count, iterations, legacy_lookup);
+	}
+	for (size_t i = 0; i < count; i++) {
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s", dir, files[i].name);
+		unlink(path);
+	}
+	rmdir(dir);
+
+	corpus_free(files, count);
+	return 0;
+}
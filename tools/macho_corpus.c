@@ -0,0 +1,464 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <mach-o/fat.h>
+#include <mach-o/loader.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macho_corpus.h"
+
+static const char info_plist[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				 "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" "
+				 "\"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+				 "<plist version=\"1.0\">\n"
+				 "<dict>\n"
+				 "\t<key>CFBundleIdentifier</key>\n"
+				 "\t<string>com.example.corpus</string>\n"
+				 "\t<key>CFBundleName</key>\n"
+				 "\t<string>corpus</string>\n"
+				 "\t<key>CFBundleVersion</key>\n"
+				 "\t<string>1.0</string>\n"
+				 "</dict>\n"
+				 "</plist>\n";
+
+static const char launchd_plist[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				    "<plist version=\"1.0\">\n"
+				    "<dict>\n"
+				    "\t<key>Label</key>\n"
+				    "\t<string>com.example.corpus</string>\n"
+				    "\t<key>MachServices</key>\n"
+				    "\t<dict>\n"
+				    "\t\t<key>com.example.corpus.xpc</key>\n"
+				    "\t\t<true/>\n"
+				    "\t</dict>\n"
+				    "</dict>\n"
+				    "</plist>\n";
+
+static const char entitlements_xml[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+				       "<plist version=\"1.0\">\n"
+				       "<dict>\n"
+				       "\t<key>com.example.daemon</key>\n"
+				       "\t<true/>\n"
+				       "</dict>\n"
+				       "</plist>\n";
+
+// The same entitlements as DER: [APPLICATION 16] { 1, [CONTEXT 16] { SET { SEQUENCE { key, TRUE } } } }
+static const uint8_t entitlements_der[] = { 0x70, 0x20, 0x02, 0x01, 0x01, 0xb0, 0x1b, 0x31, 0x19, 0x30, 0x17, 0x0c,
+	0x12, 'c', 'o', 'm', '.', 'e', 'x', 'a', 'm', 'p', 'l', 'e', '.', 'd', 'a', 'e', 'm', 'o', 'n', 0x01, 0x01,
+	0xff };
+
+static size_t
+align_up(size_t n, size_t align)
+{
+	return (n + align - 1) & ~(align - 1);
+}
+
+static void
+put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void
+put_be64(uint8_t *p, uint64_t v)
+{
+	put_be32(p, v >> 32);
+	put_be32(p + 4, (uint32_t)v);
+}
+
+static bool
+is_zerofill(uint32_t flags)
+{
+	uint32_t type = flags & SECTION_TYPE;
+	return type == S_ZEROFILL || type == S_GB_ZEROFILL || type == S_THREAD_LOCAL_ZEROFILL;
+}
+
+/*
+ * Lays out a __PAGEZERO segment, one segment per run of sections with the
+ * same segment name, LC_UUID and, if there is a signature, LC_CODE_SIGNATURE,
+ * followed by the section contents and the signature.
+ */
+uint8_t *
+corpus_build_thin(const struct corpus_image *img, size_t *size)
+{
+	size_t hdrsz = img->is64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+	size_t segsz = img->is64 ? sizeof(struct segment_command_64) : sizeof(struct segment_command);
+	size_t sectsz = img->is64 ? sizeof(struct section_64) : sizeof(struct section);
+	size_t nsegs = 0, cmdsize, off, sigoff = 0;
+	uint32_t ncmds;
+
+	for (size_t i = 0; i < img->nsections; i++) {
+		if (i == 0 || strcmp(img->sections[i].segname, img->sections[i - 1].segname) != 0)
+			nsegs++;
+	}
+	cmdsize = segsz * (nsegs + 1) + sectsz * img->nsections + sizeof(struct uuid_command);
+	ncmds = (uint32_t)nsegs + 2;
+	if (img->signature != NULL) {
+		cmdsize += sizeof(struct linkedit_data_command);
+		ncmds++;
+	}
+
+	size_t *offsets = calloc(img->nsections + 1, sizeof(size_t));
+	off = align_up(hdrsz + cmdsize, 16);
+	for (size_t i = 0; i < img->nsections; i++) {
+		if (is_zerofill(img->sections[i].flags))
+			continue;
+		offsets[i] = off;
+		off = align_up(off + img->sections[i].size, 16);
+	}
+	if (img->signature != NULL) {
+		sigoff = off;
+		off += img->signature_size;
+	}
+
+	uint8_t *buf = calloc(1, off);
+	uint8_t *p = buf;
+	if (img->is64) {
+		struct mach_header_64 mh = { MH_MAGIC_64, img->cputype, img->cpusubtype, 2, ncmds, (uint32_t)cmdsize, 0,
+			0 };
+		memcpy(p, &mh, sizeof(mh));
+	} else {
+		struct mach_header mh = { MH_MAGIC, img->cputype, img->cpusubtype, 2, ncmds, (uint32_t)cmdsize, 0 };
+		memcpy(p, &mh, sizeof(mh));
+	}
+	p += hdrsz;
+
+	for (size_t seg = 0, i = 0; seg <= nsegs; seg++) {
+		const char *segname = seg == 0 ? "__PAGEZERO" : img->sections[i].segname;
+		size_t first = i, n = 0;
+		while (seg != 0 && first + n < img->nsections && strcmp(img->sections[first + n].segname, segname) == 0)
+			n++;
+
+		if (img->is64) {
+			struct segment_command_64 sc = { LC_SEGMENT_64, (uint32_t)(segsz + n * sectsz) };
+			strncpy(sc.segname, segname, sizeof(sc.segname));
+			sc.nsects = (uint32_t)n;
+			memcpy(p, &sc, sizeof(sc));
+		} else {
+			struct segment_command sc = { LC_SEGMENT, (uint32_t)(segsz + n * sectsz) };
+			strncpy(sc.segname, segname, sizeof(sc.segname));
+			sc.nsects = (uint32_t)n;
+			memcpy(p, &sc, sizeof(sc));
+		}
+		p += segsz;
+
+		for (; i < first + n; i++) {
+			const struct corpus_section *cs = &img->sections[i];
+			if (img->is64) {
+				struct section_64 s = {};
+				strncpy(s.sectname, cs->sectname, sizeof(s.sectname));
+				strncpy(s.segname, cs->segname, sizeof(s.segname));
+				s.size = cs->size;
+				s.offset = (uint32_t)offsets[i];
+				s.flags = cs->flags;
+				memcpy(p, &s, sizeof(s));
+			} else {
+				struct section s = {};
+				strncpy(s.sectname, cs->sectname, sizeof(s.sectname));
+				strncpy(s.segname, cs->segname, sizeof(s.segname));
+				s.size = (uint32_t)cs->size;
+				s.offset = (uint32_t)offsets[i];
+				s.flags = cs->flags;
+				memcpy(p, &s, sizeof(s));
+			}
+			p += sectsz;
+			if (!is_zerofill(cs->flags) && cs->data != NULL)
+				memcpy(buf + offsets[i], cs->data, cs->size);
+		}
+	}
+
+	struct uuid_command uc = { LC_UUID, sizeof(uc) };
+	memset(uc.uuid, 0x5a, sizeof(uc.uuid));
+	memcpy(p, &uc, sizeof(uc));
+	p += sizeof(uc);
+
+	if (img->signature != NULL) {
+		struct linkedit_data_command lc = { LC_CODE_SIGNATURE, sizeof(lc), (uint32_t)sigoff,
+			(uint32_t)img->signature_size };
+		memcpy(p, &lc, sizeof(lc));
+		memcpy(buf + sigoff, img->signature, img->signature_size);
+	}
+
+	free(offsets);
+	*size = off;
+	return buf;
+}
+
+uint8_t *
+corpus_build_fat(bool fat64, const struct corpus_file *slices, size_t nslices, size_t *size)
+{
+	size_t archsz = fat64 ? sizeof(struct fat_arch_64) : sizeof(struct fat_arch);
+	size_t off = align_up(sizeof(struct fat_header) + nslices * archsz, 1 << 14);
+	size_t total = off;
+
+	for (size_t i = 0; i < nslices; i++)
+		total = align_up(total + slices[i].size, 1 << 14);
+
+	uint8_t *buf = calloc(1, total);
+	put_be32(buf, fat64 ? FAT_MAGIC_64 : FAT_MAGIC);
+	put_be32(buf + 4, (uint32_t)nslices);
+
+	for (size_t i = 0; i < nslices; i++) {
+		uint8_t *arch = buf + sizeof(struct fat_header) + i * archsz;
+		struct mach_header mh;
+		memcpy(&mh, slices[i].data, sizeof(mh));
+		put_be32(arch, (uint32_t)mh.cputype);
+		put_be32(arch + 4, (uint32_t)mh.cpusubtype);
+		if (fat64) {
+			put_be64(arch + 8, off);
+			put_be64(arch + 16, slices[i].size);
+			put_be32(arch + 24, 14);
+		} else {
+			put_be32(arch + 8, (uint32_t)off);
+			put_be32(arch + 12, (uint32_t)slices[i].size);
+			put_be32(arch + 16, 14);
+		}
+		memcpy(buf + off, slices[i].data, slices[i].size);
+		off = align_up(off + slices[i].size, 1 << 14);
+	}
+
+	*size = total;
+	return buf;
+}
+
+struct corpus_list {
+	struct corpus_file *files;
+	size_t count;
+	size_t cap;
+};
+
+static struct corpus_file *
+corpus_add(struct corpus_list *list, enum corpus_kind kind, const char *name, uint8_t *data, size_t size)
+{
+	if (list->count == list->cap) {
+		list->cap = list->cap == 0 ? 64 : list->cap * 2;
+		list->files = realloc(list->files, list->cap * sizeof(*list->files));
+	}
+	struct corpus_file *f = &list->files[list->count++];
+	snprintf(f->name, sizeof(f->name), "%s", name);
+	f->kind = kind;
+	f->data = data;
+	f->size = size;
+	return f;
+}
+
+static struct corpus_file *
+corpus_add_copy(struct corpus_list *list, const char *name, const struct corpus_file *src, size_t size)
+{
+	uint8_t *data = malloc(size == 0 ? 1 : size);
+	memcpy(data, src->data, size);
+	return corpus_add(list, CORPUS_MALFORMED, name, data, size);
+}
+
+static void
+corpus_put32(struct corpus_file *f, size_t off, uint32_t v)
+{
+	if (off + sizeof(v) <= f->size)
+		memcpy(f->data + off, &v, sizeof(v));
+}
+
+/*
+ * An embedded signature (SuperBlob) holding just the XML and DER
+ * entitlements blobs, which is all launchctl looks at.
+ */
+static uint8_t *
+corpus_signature(size_t *size)
+{
+	size_t xmlsz = 8 + sizeof(entitlements_xml) - 1, dersz = 8 + sizeof(entitlements_der);
+	size_t header = 12 + 2 * 8;
+	uint8_t *sig;
+
+	*size = header + xmlsz + dersz;
+	sig = calloc(1, *size);
+	put_be32(sig, 0xfade0cc0);
+	put_be32(sig + 4, (uint32_t)*size);
+	put_be32(sig + 8, 2);
+	put_be32(sig + 12, 5); // CSSLOT_ENTITLEMENTS
+	put_be32(sig + 16, (uint32_t)header);
+	put_be32(sig + 20, 7); // CSSLOT_DER_ENTITLEMENTS
+	put_be32(sig + 24, (uint32_t)(header + xmlsz));
+
+	put_be32(sig + header, 0xfade7171);
+	put_be32(sig + header + 4, (uint32_t)xmlsz);
+	memcpy(sig + header + 8, entitlements_xml, sizeof(entitlements_xml) - 1);
+	put_be32(sig + header + xmlsz, 0xfade7172);
+	put_be32(sig + header + xmlsz + 4, (uint32_t)dersz);
+	memcpy(sig + header + xmlsz + 8, entitlements_der, sizeof(entitlements_der));
+	return sig;
+}
+
+static uint8_t *
+corpus_image(bool is64, cpu_type_t cputype, cpu_subtype_t cpusubtype, size_t textsize, bool daemon, size_t *size)
+{
+	uint8_t *text = malloc(textsize);
+	for (size_t i = 0; i < textsize; i++)
+		text[i] = (uint8_t)(i * 2654435761u >> 24);
+
+	const struct corpus_section sections[] = {
+		{ "__TEXT", "__text", text, textsize, 0 },
+		{ "__TEXT", "__stubs", text, textsize / 64, 0 },
+		{ "__TEXT", "__cstring", info_plist, sizeof(info_plist), 0 },
+		{ "__TEXT", "__info_plist", info_plist, sizeof(info_plist) - 1, 0 },
+		{ "__TEXT", "__launchd_plist", launchd_plist, sizeof(launchd_plist) - 1, 0 },
+		{ "__DATA_CONST", "__got", text, 512, 0 },
+		{ "__DATA_CONST", "__const", text, 4096, 0 },
+		{ "__DATA", "__data", text, 2048, 0 },
+		{ "__DATA", "__bss", NULL, 1 << 16, S_ZEROFILL },
+	};
+	struct corpus_image img = { is64, cputype, cpusubtype, sections, sizeof(sections) / sizeof(sections[0]) };
+	if (!daemon) {
+		// Drop __launchd_plist and keep the rest in order
+		static struct corpus_section copy[9];
+		size_t n = 0;
+		for (size_t i = 0; i < img.nsections; i++) {
+			if (strcmp(sections[i].sectname, "__launchd_plist") != 0)
+				copy[n++] = sections[i];
+		}
+		img.sections = copy;
+		img.nsections = n;
+	}
+
+	uint8_t *signature = NULL;
+	if (daemon) {
+		signature = corpus_signature(&img.signature_size);
+		img.signature = signature;
+	}
+
+	uint8_t *buf = corpus_build_thin(&img, size);
+	free(signature);
+	free(text);
+	return buf;
+}
+
+// xorshift64*, so the corpus is identical on every run
+static uint64_t
+corpus_random(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ull;
+}
+
+size_t
+corpus_generate(struct corpus_file **files)
+{
+	struct corpus_list list = {};
+	struct corpus_file *f;
+	uint8_t *data;
+	size_t size;
+
+	data = corpus_image(true, CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL, 256 << 10, true, &size);
+	corpus_add(&list, CORPUS_THIN, "thin-arm64-daemon", data, size);
+	data = corpus_image(true, CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E, 1 << 20, false, &size);
+	corpus_add(&list, CORPUS_THIN, "thin-arm64e-app", data, size);
+	data = corpus_image(true, CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL, 256 << 10, true, &size);
+	corpus_add(&list, CORPUS_THIN, "thin-x86_64-daemon", data, size);
+	data = corpus_image(false, CPU_TYPE_ARM, CPU_SUBTYPE_ARM_V7, 64 << 10, false, &size);
+	corpus_add(&list, CORPUS_THIN, "thin-armv7-app", data, size);
+
+	struct corpus_file universal[3] = { list.files[2], list.files[0], list.files[1] };
+	data = corpus_build_fat(false, universal, 2, &size);
+	corpus_add(&list, CORPUS_FAT, "fat-x86_64-arm64", data, size);
+	data = corpus_build_fat(true, universal, 3, &size);
+	corpus_add(&list, CORPUS_FAT, "fat64-x86_64-arm64-arm64e", data, size);
+
+	const struct corpus_file thin = list.files[0], fat = list.files[4];
+	size_t hdr = sizeof(struct mach_header_64);
+	size_t textseg = hdr + sizeof(struct segment_command_64);
+
+	corpus_add_copy(&list, "truncated-header", &thin, hdr / 2);
+	corpus_add_copy(&list, "truncated-commands", &thin, textseg + 8);
+	f = corpus_add_copy(&list, "ncmds-huge", &thin, thin.size);
+	corpus_put32(f, offsetof(struct mach_header_64, ncmds), UINT32_MAX);
+	f = corpus_add_copy(&list, "sizeofcmds-huge", &thin, thin.size);
+	corpus_put32(f, offsetof(struct mach_header_64, sizeofcmds), UINT32_MAX - 8);
+	f = corpus_add_copy(&list, "cmdsize-zero", &thin, thin.size);
+	corpus_put32(f, textseg + offsetof(struct segment_command_64, cmdsize), 0);
+	f = corpus_add_copy(&list, "cmdsize-huge", &thin, thin.size);
+	corpus_put32(f, textseg + offsetof(struct segment_command_64, cmdsize), UINT32_MAX);
+	f = corpus_add_copy(&list, "nsects-huge", &thin, thin.size);
+	corpus_put32(f, textseg + offsetof(struct segment_command_64, nsects), UINT32_MAX / 80);
+	f = corpus_add_copy(&list, "section-offset-eof", &thin, thin.size);
+	corpus_put32(f, textseg + sizeof(struct segment_command_64) + 3 * sizeof(struct section_64) +
+	        offsetof(struct section_64, offset),
+	    (uint32_t)thin.size - 4);
+	f = corpus_add_copy(&list, "fat-nfat-huge", &fat, fat.size);
+	put_be32(f->data + 4, 44);
+	f = corpus_add_copy(&list, "fat-offset-eof", &fat, fat.size);
+	put_be32(f->data + sizeof(struct fat_header) + offsetof(struct fat_arch, offset), UINT32_MAX);
+	f = corpus_add_copy(&list, "fat-size-eof", &fat, fat.size);
+	put_be32(f->data + sizeof(struct fat_header) + offsetof(struct fat_arch, size), UINT32_MAX);
+	f = corpus_add_copy(&list, "fat-truncated", &fat, fat.size / 2);
+
+	// Random byte flips confined to the headers and load commands, where the parser looks
+	uint64_t state = 0x9e3779b97f4a7c15ull;
+	for (int i = 0; i < 32; i++) {
+		char name[64];
+		const struct corpus_file src = list.files[i % 4];
+		snprintf(name, sizeof(name), "flip-%02d-%s", i, src.name);
+		f = corpus_add_copy(&list, name, &src, src.size);
+		size_t limit = hdr + 1024;
+		for (int j = 0; j < 4; j++) {
+			size_t off = corpus_random(&state) % limit;
+			f->data[off] ^= (uint8_t)(1 + corpus_random(&state) % 255);
+		}
+	}
+
+	*files = list.files;
+	return list.count;
+}
+
+void
+corpus_free(struct corpus_file *files, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		free(files[i].data);
+	free(files);
+}
+
+const char *
+corpus_kind_name(enum corpus_kind kind)
+{
+	switch (kind) {
+		case CORPUS_THIN:
+			return "thin";
+		case CORPUS_FAT:
+			return "fat";
+		case CORPUS_MALFORMED:
+			return "malformed";
+		default:
+			return "unknown";
+	}
+}
@@ -0,0 +1,80 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <mach/machine.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef _LAUNCHCTL_MACHO_CORPUS_H_
+#define _LAUNCHCTL_MACHO_CORPUS_H_
+
+/*
+ * Synthetic Mach-O files for benchmarking and seeding the fuzzer: thin
+ * 32- and 64-bit images, fat and fat64 files, and malformed variants of
+ * them (truncations, out-of-range counts, sizes and offsets, and seeded
+ * random byte flips in the headers and load commands).
+ */
+enum corpus_kind {
+	CORPUS_THIN,
+	CORPUS_FAT,
+	CORPUS_MALFORMED,
+	CORPUS_NKINDS,
+};
+
+struct corpus_section {
+	const char *segname;
+	const char *sectname;
+	const void *data;
+	size_t size;
+	uint32_t flags;
+};
+
+struct corpus_image {
+	bool is64;
+	cpu_type_t cputype;
+	cpu_subtype_t cpusubtype;
+	const struct corpus_section *sections;
+	size_t nsections;
+	const void *signature;
+	size_t signature_size;
+};
+
+struct corpus_file {
+	char name[64];
+	enum corpus_kind kind;
+	uint8_t *data;
+	size_t size;
+};
+
+uint8_t *corpus_build_thin(const struct corpus_image *img, size_t *size);
+uint8_t *corpus_build_fat(bool fat64, const struct corpus_file *slices, size_t nslices, size_t *size);
+size_t corpus_generate(struct corpus_file **files);
+void corpus_free(struct corpus_file *files, size_t count);
+const char *corpus_kind_name(enum corpus_kind kind);
+#endif
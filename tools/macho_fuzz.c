@@ -0,0 +1,85 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "macho.h"
+
+/*
+ * libFuzzer entry point for the Mach-O parser in macho.c. Every byte a
+ * parsed section claims to cover is read, so an out-of-bounds range shows
+ * up under AddressSanitizer even if nothing else would touch it.
+ */
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static struct macho_index idx;
+	struct macho_slice slices[16];
+	struct macho_walker w;
+	struct macho_load_command lc;
+	volatile uint8_t sink = 0;
+	uint64_t offset, len;
+	uint32_t count;
+
+	if (macho_slices(data, size, slices, 16, &count) != 0)
+		return 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const uint8_t *slice = data + slices[i].offset;
+		(void)macho_arch_name(slices[i].cputype, slices[i].cpusubtype);
+
+		if (macho_walker_init(&w, slice, slices[i].size) == 0) {
+			while (macho_walker_next(&w, &lc))
+				sink ^= lc.data[lc.cmdsize - 1];
+		}
+
+		if (macho_code_signature(slice, slices[i].size, slices[i].size, &offset, &len) == 0) {
+			static const uint32_t magics[] = { CSMAGIC_EMBEDDED_ENTITLEMENTS, CSMAGIC_EMBEDDED_DER_ENTITLEMENTS };
+			for (size_t j = 0; j < 2; j++) {
+				const uint8_t *blob;
+				size_t blobLen;
+				if (macho_signature_blob(slice + offset, len, magics[j], (const void **)&blob, &blobLen) != 0)
+					continue;
+				for (size_t k = 0; k < blobLen; k++)
+					sink ^= blob[k];
+			}
+		}
+
+		if (macho_index_build(&idx, slice, slices[i].size) != 0)
+			continue;
+		for (uint32_t j = 0; j < idx.nsections; j++) {
+			const uint8_t *p = macho_section_data(&idx, &idx.sections[j]);
+			for (uint64_t k = 0; p != NULL && k < idx.sections[j].size; k++)
+				sink ^= p[k];
+		}
+		(void)macho_index_find(&idx, "__TEXT", "__info_plist");
+	}
+
+	(void)sink;
+	return 0;
+}
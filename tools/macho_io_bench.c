@@ -0,0 +1,241 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "macho.h"
+#include "macho_corpus.h"
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+// Best effort: without a way to drop the file from the page cache every pass is warm
+static bool
+evict(int fd, off_t size)
+{
+#ifdef POSIX_FADV_DONTNEED
+	return fdatasync(fd) == 0 && posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED) == 0;
+#else
+	void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		return false;
+	bool ret = msync(map, size, MS_INVALIDATE) == 0;
+	munmap(map, size);
+	return ret;
+#endif
+}
+
+// Bytes of the file in the page cache, which after an eviction is what the lookup pulled in
+static size_t
+resident(int fd, size_t size)
+{
+	size_t pagesize = (size_t)getpagesize(), npages = (size + pagesize - 1) / pagesize, n = 0;
+	void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	unsigned char *vec = malloc(npages);
+
+	if (map != MAP_FAILED && vec != NULL && mincore(map, size, (void *)vec) == 0) {
+		for (size_t i = 0; i < npages; i++)
+			n += vec[i] & 1;
+	}
+	free(vec);
+	if (map != MAP_FAILED)
+		munmap(map, size);
+	return n * pagesize;
+}
+
+// What plist_cmd does per file: pick the first slice and fetch __TEXT,__info_plist
+static int
+lookup(const char *path, enum macho_io io, uint64_t *bytes)
+{
+	struct macho_file file;
+	struct macho_slice slices[16];
+	struct macho_index idx;
+	const struct macho_section *sect;
+	const void *data;
+	void *commands = NULL, *buf = NULL;
+	uint32_t count;
+	int fd, ret;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return errno;
+	if ((ret = macho_file_open(&file, fd, io)) != 0) {
+		close(fd);
+		return ret;
+	}
+	if ((ret = macho_file_slices(&file, slices, 16, &count)) == 0 && count > 0 &&
+	    (ret = macho_file_index(&file, &slices[0], &idx, &commands)) == 0) {
+		if ((sect = macho_index_find(&idx, "__TEXT", "__info_plist")) == NULL)
+			ret = ENOENT;
+		else
+			ret = macho_file_section(&file, &slices[0], sect, &data, &buf);
+	}
+	*bytes = file.bytes_read;
+	free(buf);
+	free(commands);
+	macho_file_close(&file);
+	close(fd);
+	return ret;
+}
+
+static void
+run(const char *name, const char *path, enum macho_io io, bool cold, int iterations)
+{
+	double *samples = calloc(iterations, sizeof(double)), total = 0;
+	uint64_t bytes = 0;
+	size_t cached = 0;
+	struct stat st;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1 || fstat(fd, &st) == -1) {
+		perror(path);
+		exit(1);
+	}
+	if (cold && !evict(fd, st.st_size)) {
+		printf("%s skipped=1 reason=\"cannot evict the page cache\"\n", name);
+		free(samples);
+		close(fd);
+		return;
+	}
+
+	for (int it = 0; it < iterations; it++) {
+		if (cold)
+			evict(fd, st.st_size);
+		double start = now();
+		int ret = lookup(path, io, &bytes);
+		samples[it] = now() - start;
+		total += samples[it];
+		if (ret != 0) {
+			fprintf(stderr, "%s: %s\n", path, strerror(ret));
+			exit(1);
+		}
+		if (cold)
+			cached += resident(fd, st.st_size);
+	}
+	qsort(samples, iterations, sizeof(double), compare_double);
+
+	printf("%s size=%lld iterations=%d p50_us=%.1f p99_us=%.1f mean_us=%.1f bytes_read=%llu", name,
+	    (long long)st.st_size, iterations, samples[iterations / 2] * 1e6, samples[iterations * 99 / 100] * 1e6,
+	    total / iterations * 1e6, (unsigned long long)bytes);
+	if (cold)
+		printf(" bytes_cached=%zu", cached / iterations);
+	printf("\n");
+
+	free(samples);
+	close(fd);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *dir = "/tmp";
+	size_t megabytes = 128;
+	int iterations = 50, ch;
+
+	while ((ch = getopt(argc, argv, "d:m:n:")) != -1) {
+		switch (ch) {
+			case 'd':
+				dir = optarg;
+				break;
+			case 'm':
+				megabytes = strtoul(optarg, NULL, 10);
+				break;
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-d dir] [-m megabytes-per-slice] [-n iterations]\n", getprogname());
+				return 64;
+		}
+	}
+	if (megabytes == 0 || iterations <= 0) {
+		fprintf(stderr, "usage: %s [-d dir] [-m megabytes-per-slice] [-n iterations]\n", getprogname());
+		return 64;
+	}
+
+	// A universal binary with two large slices, as from an app bundle's main executable
+	size_t textsize = megabytes << 20;
+	uint8_t *text = calloc(1, textsize);
+	static const char plist[] = "<plist version=\"1.0\"><dict><key>CFBundleIdentifier</key>"
+				    "<string>com.example.large</string></dict></plist>";
+	const struct corpus_section sections[] = {
+		{ "__TEXT", "__text", text, textsize, 0 },
+		{ "__TEXT", "__info_plist", plist, sizeof(plist) - 1, 0 },
+		{ "__DATA", "__data", text, 4096, 0 },
+	};
+	struct corpus_file slices[2] = {};
+	struct corpus_image img = { true, CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL, sections, 3 };
+	slices[0].data = corpus_build_thin(&img, &slices[0].size);
+	img.cputype = CPU_TYPE_ARM64;
+	img.cpusubtype = CPU_SUBTYPE_ARM64_ALL;
+	slices[1].data = corpus_build_thin(&img, &slices[1].size);
+	size_t size;
+	uint8_t *fat = corpus_build_fat(false, slices, 2, &size);
+	free(slices[0].data);
+	free(slices[1].data);
+	free(text);
+
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/macho_io_bench.XXXXXX", dir);
+	int fd = mkstemp(path);
+	if (fd == -1 || write(fd, fat, size) != (ssize_t)size) {
+		perror(path);
+		return 1;
+	}
+	close(fd);
+	free(fat);
+
+	run("mmap.warm", path, MACHO_IO_MMAP, false, iterations);
+	run("pread.warm", path, MACHO_IO_PREAD, false, iterations);
+	run("mmap.cold", path, MACHO_IO_MMAP, true, iterations);
+	run("pread.cold", path, MACHO_IO_PREAD, true, iterations);
+
+	unlink(path);
+	return 0;
+}
@@ -0,0 +1,479 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "proc_provider.h"
+#include "procargs.h"
+
+/*
+ * Checks and times the KERN_PROCARGS2 decoder in procargs.c on canned
+ * buffers and, off Darwin, the procfs backends of procargs.c and
+ * proc_provider.c on a /proc tree of fixtures. Nothing here needs launchd
+ * or libxpc, so it builds and runs on Linux as well.
+ */
+
+#define BENCH_REPEATS 5
+
+static const char *filter;
+static double scale = 1;
+static int checks, failures;
+
+#define CHECK(cond, ...)                                                     \
+	do {                                                                 \
+		checks++;                                                    \
+		if (!(cond)) {                                               \
+			failures++;                                          \
+			fprintf(stderr, "FAIL %s:%d: ", __func__, __LINE__); \
+			fprintf(stderr, __VA_ARGS__);                        \
+			fputc('\n', stderr);                                 \
+		}                                                            \
+	} while (0)
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+// Same output as launchctl_bench, so the two can be compared with one script
+static void
+run(const char *name, int iterations, size_t bytes, void (*fn)(void *), void *ctx)
+{
+	double samples[BENCH_REPEATS];
+
+	if (filter != NULL && strstr(name, filter) == NULL)
+		return;
+	iterations = (int)(iterations * scale);
+	if (iterations < 1)
+		iterations = 1;
+
+	fn(ctx);
+	for (int r = 0; r < BENCH_REPEATS; r++) {
+		double start = now();
+		for (int i = 0; i < iterations; i++)
+			fn(ctx);
+		samples[r] = (now() - start) / iterations;
+	}
+	qsort(samples, BENCH_REPEATS, sizeof(double), compare_double);
+
+	printf("%s iterations=%d repeats=%d ns_per_op=%.1f min_ns_per_op=%.1f", name, iterations, BENCH_REPEATS,
+	    samples[BENCH_REPEATS / 2] * 1e9, samples[0] * 1e9);
+	if (bytes != 0)
+		printf(" bytes_per_op=%zu mb_per_sec=%.1f", bytes, bytes / samples[BENCH_REPEATS / 2] / 1e6);
+	printf("\n");
+	fflush(stdout);
+}
+
+/*
+ * Lays out a KERN_PROCARGS2 buffer the way the kernel does: argc, the exec
+ * path and NUL padding, argv, the environment and its terminator, apple[].
+ * NULL-terminated string lists; a NULL exec path leaves the buffer at argc.
+ */
+static void
+procargs_fixture(struct procargs *pa, int argc, const char *exec, const char *const *argv, const char *const *env,
+    const char *const *apple)
+{
+	char *buf = NULL;
+	size_t len;
+	FILE *out = open_memstream(&buf, &len);
+
+	fwrite(&argc, sizeof(argc), 1, out);
+	if (exec != NULL) {
+		fputs(exec, out);
+		fwrite("\0\0\0\0", 1, 4, out);
+		for (; argv != NULL && *argv != NULL; argv++)
+			fwrite(*argv, 1, strlen(*argv) + 1, out);
+		for (; env != NULL && *env != NULL; env++)
+			fwrite(*env, 1, strlen(*env) + 1, out);
+		fputc('\0', out);
+		for (; apple != NULL && *apple != NULL; apple++)
+			fwrite(*apple, 1, strlen(*apple) + 1, out);
+	}
+	fclose(out);
+
+	procargs_destroy(pa);
+	pa->buf = buf;
+	pa->cap = pa->len = len;
+	pa->argc = argc;
+}
+
+static bool
+next_arg_is(struct procargs_iter *it, const char *want)
+{
+	const char *str;
+	size_t len;
+	return procargs_next_arg(it, &str, &len) && len == strlen(want) && memcmp(str, want, len) == 0;
+}
+
+static bool
+next_env_is(struct procargs_iter *it, const char *want, size_t keylen)
+{
+	const char *str;
+	size_t len;
+	return procargs_next_env(it, &str, &len) && len == strlen(want) && memcmp(str, want, len) == 0 &&
+	    procargs_env_keylen(str, len) == keylen;
+}
+
+static void
+check_procargs_decode(void)
+{
+	static const char *const argv[] = { "fixtured", "-x", "an argument with spaces", NULL };
+	static const char *const argv0[] = { "fixtured", NULL };
+	static const char *const env[] = { "A=1", "PATH=/usr/bin:/bin", "NOVALUE", "EMPTY=", NULL };
+	static const char *const apple[] = { "executable_path=/usr/libexec/fixtured", "ptr_munge=", NULL };
+	struct procargs pa = {};
+	struct procargs_iter it;
+	const char *str, *exec;
+	size_t len;
+
+	procargs_fixture(&pa, 3, "/usr/libexec/fixtured", argv, env, apple);
+	exec = procargs_exec_path(&pa);
+	CHECK(exec != NULL && strcmp(exec, "/usr/libexec/fixtured") == 0, "exec path is %s", exec);
+	procargs_begin(&pa, &it);
+	CHECK(next_arg_is(&it, "fixtured"), "argv[0]");
+	CHECK(next_arg_is(&it, "-x"), "argv[1]");
+	CHECK(next_arg_is(&it, "an argument with spaces"), "argv[2]");
+	procargs_begin_env(&it);
+	CHECK(next_env_is(&it, "A=1", 1), "env[0]");
+	CHECK(next_env_is(&it, "PATH=/usr/bin:/bin", 4), "env[1]");
+	CHECK(next_env_is(&it, "NOVALUE", 7), "env[2] without '='");
+	CHECK(next_env_is(&it, "EMPTY=", 5), "env[3] with an empty value");
+	CHECK(!procargs_next_env(&it, &str, &len), "environment does not end before apple[]");
+
+	// Like Apple's launchctl, no environment means apple[] is printed in its place
+	procargs_fixture(&pa, 1, "/usr/libexec/fixtured", argv0, NULL, apple);
+	procargs_begin(&pa, &it);
+	CHECK(next_arg_is(&it, "fixtured"), "argv[0] without environment");
+	procargs_begin_env(&it);
+	CHECK(next_env_is(&it, "executable_path=/usr/libexec/fixtured", 15), "apple[0] in place of the environment");
+
+	// Only argc: no exec path, nothing to iterate
+	procargs_fixture(&pa, 2, NULL, NULL, NULL, NULL);
+	CHECK(procargs_exec_path(&pa) == NULL, "exec path of an argc-only buffer");
+	procargs_begin(&pa, &it);
+	CHECK(!procargs_next_arg(&it, &str, &len), "argv of an argc-only buffer");
+
+	// A buffer cut off inside the exec path
+	procargs_fixture(&pa, 1, "/usr/libexec/fixtured", argv, env, apple);
+	pa.len = sizeof(int) + 5;
+	CHECK(procargs_exec_path(&pa) == NULL, "exec path without a terminator");
+	procargs_begin(&pa, &it);
+	CHECK(!procargs_next_arg(&it, &str, &len), "argv after a truncated exec path");
+
+	// A buffer cut off inside argv[1]: the remainder comes back, then nothing
+	procargs_fixture(&pa, 3, "/usr/libexec/fixtured", argv, env, apple);
+	pa.len = sizeof(int) + strlen("/usr/libexec/fixtured") + 4 + strlen("fixtured") + 1 + 1;
+	procargs_begin(&pa, &it);
+	CHECK(next_arg_is(&it, "fixtured"), "argv[0] of a truncated buffer");
+	CHECK(next_arg_is(&it, "-"), "truncated argv[1]");
+	CHECK(!procargs_next_arg(&it, &str, &len), "argv past the end of a truncated buffer");
+
+	procargs_destroy(&pa);
+}
+
+static void
+bench_procargs_decode(void *ctx)
+{
+	const struct procargs *pa = ctx;
+	struct procargs_iter it;
+	const char *str;
+	size_t len, total = 0;
+
+	procargs_begin(pa, &it);
+	for (int i = 0; i < pa->argc && procargs_next_arg(&it, &str, &len); i++)
+		total += len;
+	procargs_begin_env(&it);
+	while (procargs_next_env(&it, &str, &len))
+		total += procargs_env_keylen(str, len);
+	if (total == 0)
+		abort();
+}
+
+#ifndef __APPLE__
+struct procfs_fixture {
+	pid_t pid;
+	char state;
+	unsigned int flags;
+	const char *status; // Expected in proc_info_print output
+};
+
+// <linux/sched.h>
+#define PF_KTHREAD 0x00200000
+
+static const struct procfs_fixture procfs_fixtures[] = {
+	{ 4242, 'S', 0, "status = running" },
+	{ 4243, 'R', PF_KTHREAD, "status = running" },
+	{ 4244, 'T', 0, "status = stopped" },
+	{ 4245, 't', 0, "status = stopped" },
+	{ 4246, 'Z', 0, "status = zombie" },
+};
+
+static int
+write_file(const char *path, const void *data, size_t size)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1 || write(fd, data, size) != (ssize_t)size) {
+		perror(path);
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+/*
+ * Writes <root>/<pid>/{stat,status,cmdline,environ,exe} for every fixture,
+ * with exe a link to a 64-bit ELF header in <root>/fixtured.
+ */
+static int
+procfs_write_fixtures(const char *root)
+{
+	char path[PATH_MAX], exe[PATH_MAX], buf[1024];
+	static const char cmdline[] = "fixtured\0--verbose\0";
+	static const char environ_[] = "HOME=/var/root\0LANG=C\0";
+	int len, ret = 0;
+
+	snprintf(exe, sizeof(exe), "%s/fixtured", root);
+	ret |= write_file(exe, "\177ELF\2\1\1", 7);
+	for (size_t i = 0; i < sizeof(procfs_fixtures) / sizeof(procfs_fixtures[0]); i++) {
+		const struct procfs_fixture *f = &procfs_fixtures[i];
+
+		snprintf(path, sizeof(path), "%s/%d", root, (int)f->pid);
+		if (mkdir(path, 0755) == -1) {
+			perror(path);
+			return -1;
+		}
+		// comm with spaces and parentheses, longer than the 16 characters proc_info keeps
+		len = snprintf(buf, sizeof(buf), "%d (fixture (d) with a long name) %c 1 %d %d 0 -1 %u 0 0 0 0 0 0 0 0 20 0\n",
+		    (int)f->pid, f->state, (int)f->pid, (int)f->pid, f->flags);
+		snprintf(path, sizeof(path), "%s/%d/stat", root, (int)f->pid);
+		ret |= write_file(path, buf, (size_t)len);
+		len = snprintf(buf, sizeof(buf),
+		    "Name:\tfixtured\nState:\t%c\nTracerPid:\t0\nUid:\t501\t502\t503\t504\nGid:\t20\t21\t22\t23\n", f->state);
+		snprintf(path, sizeof(path), "%s/%d/status", root, (int)f->pid);
+		ret |= write_file(path, buf, (size_t)len);
+		snprintf(path, sizeof(path), "%s/%d/cmdline", root, (int)f->pid);
+		ret |= write_file(path, cmdline, sizeof(cmdline) - 1);
+		snprintf(path, sizeof(path), "%s/%d/environ", root, (int)f->pid);
+		ret |= write_file(path, environ_, sizeof(environ_) - 1);
+		snprintf(path, sizeof(path), "%s/%d/exe", root, (int)f->pid);
+		if (symlink(exe, path) == -1) {
+			perror(path);
+			ret = -1;
+		}
+	}
+	return ret;
+}
+
+static void
+procfs_remove_fixtures(const char *root)
+{
+	static const char *const files[] = { "stat", "status", "cmdline", "environ", "exe" };
+	char path[PATH_MAX];
+
+	for (size_t i = 0; i < sizeof(procfs_fixtures) / sizeof(procfs_fixtures[0]); i++) {
+		for (size_t j = 0; j < sizeof(files) / sizeof(files[0]); j++) {
+			snprintf(path, sizeof(path), "%s/%d/%s", root, (int)procfs_fixtures[i].pid, files[j]);
+			unlink(path);
+		}
+		snprintf(path, sizeof(path), "%s/%d", root, (int)procfs_fixtures[i].pid);
+		rmdir(path);
+	}
+	snprintf(path, sizeof(path), "%s/fixtured", root);
+	unlink(path);
+	rmdir(root);
+}
+
+static void
+check_procfs(const char *root)
+{
+	char *text = NULL, exe[PATH_MAX];
+	size_t textlen;
+	struct proc_info info;
+	struct procargs pa = {};
+	struct procargs_iter it;
+	const char *str;
+	uint32_t dirty;
+	size_t len;
+	int ret;
+
+	for (size_t i = 0; i < sizeof(procfs_fixtures) / sizeof(procfs_fixtures[0]); i++) {
+		const struct procfs_fixture *f = &procfs_fixtures[i];
+
+		ret = proc_provider_procfs.get_info(f->pid, &info);
+		CHECK(ret == 0, "get_info(%d) = %d", (int)f->pid, ret);
+		if (ret != 0)
+			continue;
+		CHECK(info.pid == f->pid && info.ppid == 1 && info.pgid == f->pid, "ids of %d", (int)f->pid);
+		CHECK(strcmp(info.comm, "fixture (d) with") == 0, "comm of %d is \"%s\"", (int)f->pid, info.comm);
+		CHECK(info.ruid == 501 && info.uid == 502 && info.svuid == 503, "uids of %d", (int)f->pid);
+		CHECK(info.rgid == 20 && info.gid == 21 && info.svgid == 22, "gids of %d", (int)f->pid);
+		CHECK((info.flags & PROC_INFO_FLAG_LP64) != 0, "64-bit flag of %d", (int)f->pid);
+		CHECK(((info.flags & PROC_INFO_FLAG_SYSTEM) != 0) == ((f->flags & PF_KTHREAD) != 0), "system flag of %d",
+		    (int)f->pid);
+
+		FILE *out = open_memstream(&text, &textlen);
+		proc_info_print(out, &info);
+		fclose(out);
+		CHECK(strstr(text, f->status) != NULL, "state '%c' of %d printed as: %s", f->state, (int)f->pid, text);
+		free(text);
+		text = NULL;
+	}
+	CHECK(proc_provider_procfs.get_info(1, &info) != 0, "get_info of a pid without fixtures");
+	CHECK(proc_provider_procfs.get_dirty(4242, &dirty) == ENOTSUP, "get_dirty");
+
+	ret = procargs_read(&pa, 4242);
+	CHECK(ret == 0, "procargs_read(4242) = %d", ret);
+	if (ret == 0) {
+		snprintf(exe, sizeof(exe), "%s/fixtured", root);
+		CHECK(pa.argc == 2, "argc is %d", pa.argc);
+		CHECK(procargs_exec_path(&pa) != NULL && strcmp(procargs_exec_path(&pa), exe) == 0, "exec path");
+		procargs_begin(&pa, &it);
+		CHECK(next_arg_is(&it, "fixtured") && next_arg_is(&it, "--verbose"), "argv from cmdline");
+		procargs_begin_env(&it);
+		CHECK(next_env_is(&it, "HOME=/var/root", 4) && next_env_is(&it, "LANG=C", 4), "env from environ");
+		CHECK(!procargs_next_env(&it, &str, &len), "environment does not end");
+	}
+	procargs_destroy(&pa);
+}
+
+static void
+bench_procfs_info(void *ctx)
+{
+	struct proc_info info;
+	if (proc_provider_procfs.get_info(*(pid_t *)ctx, &info) != 0)
+		abort();
+}
+
+static void
+bench_procargs_read(void *ctx)
+{
+	if (procargs_read(ctx, 4242) != 0)
+		abort();
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+	bool checkonly = false;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "cf:s:")) != -1) {
+		switch (ch) {
+			case 'c':
+				checkonly = true;
+				break;
+			case 'f':
+				filter = optarg;
+				break;
+			case 's':
+				scale = atof(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-c] [-f filter] [-s scale]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	check_procargs_decode();
+#ifndef __APPLE__
+	char root[] = "/tmp/procinfo_check.XXXXXX";
+	if (mkdtemp(root) == NULL) {
+		perror(root);
+		return 1;
+	}
+	if (procfs_write_fixtures(root) != 0) {
+		procfs_remove_fixtures(root);
+		return 1;
+	}
+	procargs_procfs_root = proc_provider_procfs_root = root;
+	check_procfs(root);
+#endif
+	printf("checks=%d failed=%d\n", checks, failures);
+
+	if (failures == 0 && !checkonly) {
+		static const char *const apple[] = { "executable_path=/usr/libexec/fixtured", "ptr_munge=", NULL };
+		const char *args[65], *env[257];
+		char strings[64 + 256][80];
+		struct procargs pa = {};
+
+		for (int i = 0; i < 64; i++) {
+			snprintf(strings[i], sizeof(strings[i]), "--argument-%d", i);
+			args[i] = strings[i];
+		}
+		args[64] = NULL;
+		for (int i = 0; i < 256; i++) {
+			snprintf(strings[64 + i], sizeof(strings[64 + i]), "FIXTURE_VARIABLE_%d=/some/reasonably/long/value/%d", i,
+			    i * 7919);
+			env[i] = strings[64 + i];
+		}
+		env[256] = NULL;
+		procargs_fixture(&pa, 64, "/usr/libexec/fixtured", args, env, apple);
+		run("procargs_decode.64x256", 100000, pa.len, bench_procargs_decode, &pa);
+		procargs_destroy(&pa);
+
+#ifndef __APPLE__
+		pid_t pid = 4242;
+		run("procfs_info.fixture", 20000, 0, bench_procfs_info, &pid);
+		run("procargs_read.fixture", 20000, 0, bench_procargs_read, &pa);
+		procargs_destroy(&pa);
+
+		procargs_procfs_root = proc_provider_procfs_root = "/proc";
+		pid = getpid();
+		run("procfs_info.self", 20000, 0, bench_procfs_info, &pid);
+#endif
+	}
+
+#ifndef __APPLE__
+	procfs_remove_fixtures(root);
+#endif
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+bool launchctl_tracing;
+
+static FILE *trace_out;
+
+uint64_t
+launchctl_trace_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t
+trace_tid(void)
+{
+	uint64_t tid = 0;
+#ifdef __APPLE__
+	pthread_threadid_np(NULL, &tid);
+#else
+	tid = (uint64_t)(uintptr_t)pthread_self();
+#endif
+	return tid;
+}
+
+static void
+trace_string(const char *str)
+{
+	fputc('"', trace_out);
+	for (const unsigned char *p = (const unsigned char *)str; *p != '\0'; p++) {
+		if (*p == '"' || *p == '\\')
+			fprintf(trace_out, "\\%c", *p);
+		else if (*p < 0x20)
+			fprintf(trace_out, "\\u%04x", *p);
+		else
+			fputc(*p, trace_out);
+	}
+	fputc('"', trace_out);
+}
+
+static void
+trace_close(void)
+{
+	flockfile(trace_out);
+	launchctl_tracing = false;
+	fputs("\n]\n", trace_out);
+	funlockfile(trace_out);
+	fclose(trace_out);
+}
+
+/*
+ * Starts tracing if LAUNCHCTL_TRACE names a file. The file is written as
+ * the program runs and closed at exit; name labels the process.
+ */
+void
+launchctl_trace_open(const char *name)
+{
+	const char *path = getenv("LAUNCHCTL_TRACE");
+	if (path == NULL || *path == '\0')
+		return;
+
+	if ((trace_out = fopen(path, "w")) == NULL) {
+		fprintf(stderr, "LAUNCHCTL_TRACE: %s: %s\n", path, strerror(errno));
+		return;
+	}
+	setvbuf(trace_out, NULL, _IOFBF, 1 << 16);
+	fprintf(trace_out, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":",
+	    getpid(), (unsigned long long)trace_tid());
+	trace_string(name);
+	fputs("}}", trace_out);
+	launchctl_tracing = true;
+	atexit(trace_close);
+}
+
+/*
+ * Records a complete ("X") event from start to now. Spans from several
+ * threads are written whole, one per line.
+ */
+void
+launchctl_trace_span(const char *name, uint64_t start, const char *detail, const char *args, ...)
+{
+	uint64_t end = launchctl_trace_now();
+	va_list ap;
+
+	flockfile(trace_out);
+	if (!launchctl_tracing) {
+		funlockfile(trace_out);
+		return;
+	}
+	fputs(",\n{\"name\":", trace_out);
+	trace_string(name);
+	fprintf(trace_out,
+	    ",\"cat\":\"launchctl\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%llu,\"args\":{", start / 1e3,
+	    (end - start) / 1e3, getpid(), (unsigned long long)trace_tid());
+	if (detail != NULL) {
+		fputs("\"detail\":", trace_out);
+		trace_string(detail);
+	}
+	if (args != NULL) {
+		if (detail != NULL)
+			fputc(',', trace_out);
+		va_start(ap, args);
+		vfprintf(trace_out, args, ap);
+		va_end(ap);
+	}
+	fputs("}}", trace_out);
+	funlockfile(trace_out);
+}
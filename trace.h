@@ -0,0 +1,60 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 Procursus Team <team@procurs.us>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef _LAUNCHCTL_TRACE_H_
+#define _LAUNCHCTL_TRACE_H_
+
+/*
+ * Span tracing in the Chrome trace-event format, enabled by pointing
+ * LAUNCHCTL_TRACE at a file; the result loads in chrome://tracing or
+ * Perfetto. While it is unset LAUNCHCTL_TRACE_BEGIN() is a load and a
+ * branch and LAUNCHCTL_TRACE_END() does nothing.
+ *
+ *	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+ *	...
+ *	LAUNCHCTL_TRACE_END("xpc_from_plist", t, path, "\"bytes\":%lld", size);
+ *
+ * detail, if not NULL, is recorded as the "detail" argument; args is a
+ * printf format for further JSON members of the span's arguments, or NULL.
+ */
+extern bool launchctl_tracing;
+
+void launchctl_trace_open(const char *name);
+uint64_t launchctl_trace_now(void);
+void launchctl_trace_span(const char *name, uint64_t start, const char *detail, const char *args, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#define LAUNCHCTL_TRACE_BEGIN() (launchctl_tracing ? launchctl_trace_now() : 0)
+#define LAUNCHCTL_TRACE_END(name, start, ...)                          \
+	do {                                                           \
+		if (launchctl_tracing)                                 \
+			launchctl_trace_span(name, start, __VA_ARGS__); \
+	} while (0)
+#endif
@@ -32,19 +32,26 @@
 #include <sys/stat.h>
 #include <sys/syslimits.h>
 
+#include <dispatch/dispatch.h>
 #include <errno.h>
+#include <fnmatch.h>
 #include <inttypes.h>
 #include <mach/mach.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sysdir.h>
+#include <time.h>
 #include <unistd.h>
 #include <xpc/xpc.h>
 
 #include "launchctl.h"
 #include "os_alloc_once.h"
+#include "trace.h"
 #include "xpc_private.h"
 
 int
@@ -60,63 +67,508 @@ launchctl_send_xpc_to_launchd(uint64_t routine, xpc_object_t msg, xpc_object_t *
 	xpc_dictionary_set_uint64(msg, "subsystem", routine >> 8);
 	xpc_dictionary_set_uint64(msg, "routine", routine);
 	int ret = 0;
+	uint64_t t = launchctl_tracing || launchctl_stats_enabled ? launchctl_trace_now() : 0;
 
 	if (__builtin_available(macOS 12.0, iOS 15.0, tvOS 15.0, watchOS 8.0, bridgeOS 6.0, *)) {
 		ret = _xpc_pipe_interface_routine(bootstrap_pipe, 0, msg, reply, 0);
 	} else {
 		ret = xpc_pipe_routine(bootstrap_pipe, msg, reply);
 	}
-	if (ret == 0 && (ret = xpc_dictionary_get_int64(*reply, "error")) == 0)
-		return 0;
-
+	if (launchctl_stats_enabled)
+		launchctl_stats_record(routine, msg, ret == 0 ? *reply : NULL,
+		    ret == 0 ? (int)xpc_dictionary_get_int64(*reply, "error") : ret, launchctl_trace_now() - t);
+	if (ret == 0)
+		ret = xpc_dictionary_get_int64(*reply, "error");
+
+	LAUNCHCTL_TRACE_END("routine", t, xpc_dictionary_get_string(msg, "name"),
+	    "\"routine\":%" PRIu64 ",\"type\":%" PRIu64 ",\"handle\":%" PRIu64 ",\"error\":%d", routine,
+	    xpc_dictionary_get_uint64(msg, "type"), xpc_dictionary_get_uint64(msg, "handle"), ret);
 	return ret;
 }
 
 void
 launchctl_xpc_object_print(xpc_object_t in, const char *name, int level)
 {
+	launchctl_xpc_object_fprint(stdout, in, name, level);
+}
+
+void
+launchctl_xpc_object_fprint(FILE *out, xpc_object_t in, const char *name, int level)
+{
+	uint64_t start = level == 0 ? LAUNCHCTL_TRACE_BEGIN() : 0;
+
 	for (int i = 0; i < level; i++)
-		putchar('\t');
+		fputc('\t', out);
 
 	if (name != NULL)
-		printf("\"%s\" = ", name);
+		fprintf(out, "\"%s\" = ", name);
 
 	xpc_type_t t = xpc_get_type(in);
 	if (t == XPC_TYPE_STRING)
-		printf("\"%s\";\n", xpc_string_get_string_ptr(in));
+		fprintf(out, "\"%s\";\n", xpc_string_get_string_ptr(in));
 	else if (t == XPC_TYPE_INT64)
-		printf("%lld;\n", xpc_int64_get_value(in));
+		fprintf(out, "%lld;\n", xpc_int64_get_value(in));
 	else if (t == XPC_TYPE_DOUBLE)
-		printf("%f;\n", xpc_double_get_value(in));
+		fprintf(out, "%f;\n", xpc_double_get_value(in));
 	else if (t == XPC_TYPE_BOOL) {
 		if (in == XPC_BOOL_TRUE)
-			printf("true;\n");
+			fprintf(out, "true;\n");
 		else if (in == XPC_BOOL_FALSE)
-			printf("false;\n");
+			fprintf(out, "false;\n");
 	} else if (t == XPC_TYPE_MACH_SEND)
-		printf("mach-port-object;\n");
+		fprintf(out, "mach-port-object;\n");
 	else if (t == XPC_TYPE_FD)
-		printf("file-descriptor-object;\n");
+		fprintf(out, "file-descriptor-object;\n");
 	else if (t == XPC_TYPE_ARRAY) {
-		printf("(\n");
+		fprintf(out, "(\n");
 		int c = xpc_array_get_count(in);
 		for (int i = 0; i < c; i++) {
-			launchctl_xpc_object_print(xpc_array_get_value(in, i), NULL, level + 1);
+			launchctl_xpc_object_fprint(out, xpc_array_get_value(in, i), NULL, level + 1);
 		}
 		for (int i = 0; i < level; i++)
-			putchar('\t');
-		printf(");\n");
+			fputc('\t', out);
+		fprintf(out, ");\n");
 	} else if (t == XPC_TYPE_DICTIONARY) {
-		printf("{\n");
+		fprintf(out, "{\n");
 		int __block blevel = level + 1;
 		(void)xpc_dictionary_apply(in, ^bool(const char *key, xpc_object_t value) {
-		    launchctl_xpc_object_print(value, key, blevel);
+		    launchctl_xpc_object_fprint(out, value, key, blevel);
 		    return true;
 		});
 		for (int i = 0; i < level; i++)
-			putchar('\t');
-		printf("};\n");
+			fputc('\t', out);
+		fprintf(out, "};\n");
 	}
+	if (level == 0)
+		LAUNCHCTL_TRACE_END("render", start, "text", NULL);
+}
+
+void
+launchctl_fprint_json_string(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for (const unsigned char *p = (const unsigned char *)str; *p != '\0'; p++) {
+		switch (*p) {
+			case '"':
+				fputs("\\\"", out);
+				break;
+			case '\\':
+				fputs("\\\\", out);
+				break;
+			case '\n':
+				fputs("\\n", out);
+				break;
+			case '\r':
+				fputs("\\r", out);
+				break;
+			case '\t':
+				fputs("\\t", out);
+				break;
+			default:
+				if (*p < 0x20)
+					fprintf(out, "\\u%04x", *p);
+				else
+					fputc(*p, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void
+launchctl_fprint_json_data(FILE *out, const uint8_t *data, size_t len)
+{
+	static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	fputc('"', out);
+	for (size_t i = 0; i < len; i += 3) {
+		uint32_t v = (uint32_t)data[i] << 16;
+		if (i + 1 < len)
+			v |= (uint32_t)data[i + 1] << 8;
+		if (i + 2 < len)
+			v |= data[i + 2];
+		fputc(b64[(v >> 18) & 0x3f], out);
+		fputc(b64[(v >> 12) & 0x3f], out);
+		fputc(i + 1 < len ? b64[(v >> 6) & 0x3f] : '=', out);
+		fputc(i + 2 < len ? b64[v & 0x3f] : '=', out);
+	}
+	fputc('"', out);
+}
+
+static void
+xpc_object_fprint_json(FILE *out, xpc_object_t in)
+{
+	xpc_type_t t = xpc_get_type(in);
+	if (t == XPC_TYPE_STRING)
+		launchctl_fprint_json_string(out, xpc_string_get_string_ptr(in));
+	else if (t == XPC_TYPE_INT64)
+		fprintf(out, "%" PRId64, xpc_int64_get_value(in));
+	else if (t == XPC_TYPE_UINT64)
+		fprintf(out, "%" PRIu64, xpc_uint64_get_value(in));
+	else if (t == XPC_TYPE_DOUBLE && isfinite(xpc_double_get_value(in)))
+		fprintf(out, "%.17g", xpc_double_get_value(in));
+	else if (t == XPC_TYPE_BOOL)
+		fputs(xpc_bool_get_value(in) ? "true" : "false", out);
+	else if (t == XPC_TYPE_DATA)
+		launchctl_fprint_json_data(out, xpc_data_get_bytes_ptr(in), xpc_data_get_length(in));
+	else if (t == XPC_TYPE_DATE) {
+		char buf[32];
+		struct tm tm;
+		time_t secs = (time_t)(xpc_date_get_value(in) / NSEC_PER_SEC);
+		strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&secs, &tm));
+		fprintf(out, "\"%s\"", buf);
+	} else if (t == XPC_TYPE_ARRAY) {
+		fputc('[', out);
+		size_t c = xpc_array_get_count(in);
+		for (size_t i = 0; i < c; i++) {
+			if (i != 0)
+				fputc(',', out);
+			xpc_object_fprint_json(out, xpc_array_get_value(in, i));
+		}
+		fputc(']', out);
+	} else if (t == XPC_TYPE_DICTIONARY) {
+		__block bool first = true;
+		fputc('{', out);
+		(void)xpc_dictionary_apply(in, ^bool(const char *key, xpc_object_t value) {
+		    if (!first)
+			    fputc(',', out);
+		    first = false;
+		    launchctl_fprint_json_string(out, key);
+		    fputc(':', out);
+		    xpc_object_fprint_json(out, value);
+		    return true;
+		});
+		fputc('}', out);
+	} else
+		fputs("null", out);
+}
+
+/*
+ * Writes in as a single line of JSON. Data is base64 encoded and dates are
+ * written as ISO 8601 strings; types without a JSON form become null.
+ */
+void
+launchctl_xpc_object_fprint_json(FILE *out, xpc_object_t in)
+{
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+	xpc_object_fprint_json(out, in);
+	LAUNCHCTL_TRACE_END("render", t, "json", NULL);
+}
+
+/*
+ * Runs work(0) ... work(count - 1) on a concurrent queue with at most width
+ * invocations in flight, and returns once all of them have finished.
+ */
+void
+launchctl_concurrent_apply(size_t count, size_t width, void (^work)(size_t index))
+{
+	dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+	dispatch_semaphore_t window = dispatch_semaphore_create(width == 0 ? 1 : (long)width);
+	dispatch_group_t group = dispatch_group_create();
+
+	for (size_t i = 0; i < count; i++) {
+		dispatch_semaphore_wait(window, DISPATCH_TIME_FOREVER);
+		dispatch_group_async(group, queue, ^{
+		    work(i);
+		    dispatch_semaphore_signal(window);
+		});
+	}
+	dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+	dispatch_release(group);
+	dispatch_release(window);
+}
+
+/*
+ * Fetches the "services" dictionary of XPC_ROUTINE_LIST for the domain
+ * described by the type and handle of domain.
+ */
+int
+launchctl_copy_service_list(xpc_object_t domain, xpc_object_t *services)
+{
+	xpc_object_t dict, reply = NULL;
+	int ret;
+
+	*services = NULL;
+	dict = xpc_dictionary_create(NULL, NULL, 0);
+	xpc_dictionary_set_uint64(dict, "type", xpc_dictionary_get_uint64(domain, "type"));
+	xpc_dictionary_set_uint64(dict, "handle", xpc_dictionary_get_uint64(domain, "handle"));
+
+	ret = launchctl_send_xpc_to_launchd(XPC_ROUTINE_LIST, dict, &reply);
+	if (ret == 0) {
+		xpc_object_t list = xpc_dictionary_get_value(reply, "services");
+		if (list == NULL || xpc_get_type(list) != XPC_TYPE_DICTIONARY)
+			ret = EBADRESP;
+		else
+			*services = xpc_retain(list);
+	}
+
+	if (reply != NULL)
+		xpc_release(reply);
+	xpc_release(dict);
+	return ret;
+}
+
+static int
+compare_strings(const void *a, const void *b)
+{
+	return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/*
+ * Appends the services of domain whose names match pattern to out, in name
+ * order, as entries like those of launchctl_expand_service_targets() whose
+ * "target" is prefix/name, or just the name if prefix is NULL. The domain
+ * is listed once and the list kept in snapshots, keyed by its type and
+ * handle, for later patterns against the same domain.
+ */
+int
+launchctl_expand_glob(xpc_object_t domain, const char *prefix, const char *pattern, xpc_object_t snapshots,
+    xpc_object_t out)
+{
+	char key[48];
+	xpc_object_t services;
+	__block size_t n = 0;
+	int ret;
+
+	snprintf(key, sizeof(key), "%" PRIu64 "/%" PRIu64, xpc_dictionary_get_uint64(domain, "type"),
+	    xpc_dictionary_get_uint64(domain, "handle"));
+	if ((services = xpc_dictionary_get_value(snapshots, key)) == NULL) {
+		if ((ret = launchctl_copy_service_list(domain, &services)) != 0)
+			return ret;
+		xpc_dictionary_set_value(snapshots, key, services);
+		xpc_release(services);
+	}
+
+	const char **names = calloc(xpc_dictionary_get_count(services) + 1, sizeof(char *));
+	if (names == NULL)
+		return ENOMEM;
+	(void)xpc_dictionary_apply(services, ^bool(const char *name, xpc_object_t value) {
+	    if (fnmatch(pattern, name, 0) == 0)
+		    names[n++] = name;
+	    return true;
+	});
+	qsort(names, n, sizeof(char *), compare_strings);
+
+	for (size_t i = 0; i < n; i++) {
+		xpc_object_t target = xpc_dictionary_create(NULL, NULL, 0);
+		char *label;
+
+		xpc_dictionary_set_uint64(target, "type", xpc_dictionary_get_uint64(domain, "type"));
+		xpc_dictionary_set_uint64(target, "handle", xpc_dictionary_get_uint64(domain, "handle"));
+		xpc_dictionary_set_string(target, "name", names[i]);
+		if (prefix != NULL) {
+			if (asprintf(&label, "%s/%s", prefix, names[i]) == -1) {
+				xpc_release(target);
+				free(names);
+				return ENOMEM;
+			}
+			xpc_dictionary_set_string(target, "target", label);
+			free(label);
+		} else {
+			xpc_dictionary_set_string(target, "target", names[i]);
+		}
+		xpc_array_append_value(out, target);
+		xpc_release(target);
+	}
+	if (n == 0)
+		fprintf(stderr, "%s%s%s: No matching services\n", prefix != NULL ? prefix : "", prefix != NULL ? "/" : "",
+		    pattern);
+	free(names);
+	return 0;
+}
+
+/*
+ * Resolves service targets into an array of dictionaries with the "type",
+ * "handle" and "name" of one service each, plus the "target" it was named
+ * by. A name with glob characters, as in system/com.example.worker.*, is
+ * matched with fnmatch(3) against a single XPC_ROUTINE_LIST of its domain
+ * and contributes every match; a pattern that matches nothing contributes
+ * nothing. Use launchctl_target_request() to make a request from an entry.
+ */
+int
+launchctl_expand_service_targets(int count, char **targets, xpc_object_t *out)
+{
+	xpc_object_t snapshots = xpc_dictionary_create(NULL, NULL, 0);
+	int ret = 0;
+
+	*out = xpc_array_create(NULL, 0);
+	for (int i = 0; i < count && ret == 0; i++) {
+		xpc_object_t dict = xpc_dictionary_create(NULL, NULL, 0);
+		char *copy = strdup(targets[i]), *slash = copy != NULL ? strrchr(copy, '/') : NULL;
+		const char *name = NULL;
+
+		if (copy == NULL) {
+			ret = ENOMEM;
+		} else if (slash != NULL && strpbrk(slash + 1, "*?[") != NULL) {
+			*slash = '\0';
+			char *prefix = strdup(copy);
+			if (prefix == NULL)
+				ret = ENOMEM;
+			else if ((ret = launchctl_setup_xpc_dict_for_service_name(copy, dict, NULL)) == 0)
+				ret = launchctl_expand_glob(dict, prefix, slash + 1, snapshots, *out);
+			free(prefix);
+		} else if ((ret = launchctl_setup_xpc_dict_for_service_name(copy, dict, &name)) == 0) {
+			if (name == NULL) {
+				ret = EBADNAME;
+			} else {
+				xpc_dictionary_set_string(dict, "name", name);
+				xpc_dictionary_set_string(dict, "target", targets[i]);
+				xpc_array_append_value(*out, dict);
+			}
+		}
+		free(copy);
+		xpc_release(dict);
+	}
+	xpc_release(snapshots);
+	if (ret != 0) {
+		xpc_release(*out);
+		*out = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Reads the pids of entries [start, start + count) of a list made by
+ * launchctl_expand_service_targets() from a single XPC_ROUTINE_LIST of each
+ * domain involved; 0 means not running or not listed, and
+ * LAUNCHCTL_PID_UNKNOWN that the domain could not be listed.
+ */
+void
+launchctl_copy_service_pids(xpc_object_t list, size_t start, size_t count, int64_t *pids)
+{
+	xpc_object_t snapshots = xpc_dictionary_create(NULL, NULL, 0);
+
+	for (size_t i = start; i < start + count; i++) {
+		xpc_object_t target = xpc_array_get_value(list, i), services, service;
+		char key[48];
+
+		pids[i] = LAUNCHCTL_PID_UNKNOWN;
+		snprintf(key, sizeof(key), "%" PRIu64 "/%" PRIu64, xpc_dictionary_get_uint64(target, "type"),
+		    xpc_dictionary_get_uint64(target, "handle"));
+		if ((services = xpc_dictionary_get_value(snapshots, key)) == NULL) {
+			if (launchctl_copy_service_list(target, &services) != 0)
+				continue;
+			xpc_dictionary_set_value(snapshots, key, services);
+			xpc_release(services);
+		}
+		service = xpc_dictionary_get_value(services, xpc_dictionary_get_string(target, "name"));
+		pids[i] = service != NULL ? xpc_dictionary_get_int64(service, "pid") : 0;
+	}
+	xpc_release(snapshots);
+}
+
+/*
+ * Polls the pids of entries [start, start + count) of list until done() has
+ * returned true for each of them or timeout seconds have passed, backing off
+ * exponentially from 10 ms to 500 ms between rounds. done() is given the
+ * index and current pid of a service and is not asked again once it has
+ * returned true; it is not asked about a service in a round where its domain
+ * could not be listed. Returns the number of services that are done.
+ */
+size_t
+launchctl_wait_services(xpc_object_t list, size_t start, size_t count, double timeout,
+    bool (^done)(size_t index, int64_t pid))
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	double deadline = now.tv_sec + now.tv_nsec / 1e9 + timeout, left;
+	int64_t *pids = calloc(xpc_array_get_count(list), sizeof(int64_t));
+	bool *finished = calloc(xpc_array_get_count(list), sizeof(bool));
+	useconds_t backoff = 10000;
+	size_t ndone = 0;
+
+	if (pids == NULL || finished == NULL)
+		goto out;
+	for (;;) {
+		launchctl_copy_service_pids(list, start, count, pids);
+		for (size_t i = start; i < start + count; i++) {
+			if (!finished[i] && pids[i] != LAUNCHCTL_PID_UNKNOWN && done(i, pids[i])) {
+				finished[i] = true;
+				ndone++;
+			}
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (ndone == count || (left = deadline - (now.tv_sec + now.tv_nsec / 1e9)) <= 0)
+			break;
+		usleep(left * 1e6 < backoff ? (useconds_t)(left * 1e6) : backoff);
+		backoff = backoff * 2 > 500000 ? 500000 : backoff * 2;
+	}
+out:
+	free(pids);
+	free(finished);
+	return ndone;
+}
+
+/*
+ * Per-service lines of a command run on several targets: "<target>: ..." on
+ * stdout for a service that did what was asked, on stderr for one that did
+ * not, and a "<verb> n of m services." summary once all have been reported.
+ */
+void
+launchctl_result_ok(struct launchctl_results *res, const char *target, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%s: ", target);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+	res->ok++;
+}
+
+void
+launchctl_result_fail(struct launchctl_results *res, const char *target, int err, const char *fmt, ...)
+{
+	va_list ap;
+
+	// Keep the lines in order when both streams go to the same place
+	fflush(stdout);
+	fprintf(stderr, "%s: ", target);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	if (res->error == 0)
+		res->error = err;
+}
+
+/*
+ * Prints the summary, with detail (if not NULL) before the full stop, and
+ * returns the first error. Errors main() would report again without a
+ * target, like ENOSERVICE, are returned as EMANY since each failed service
+ * already has its line.
+ */
+int
+launchctl_results_finish(const struct launchctl_results *res, size_t total, const char *verb, const char *detail)
+{
+	printf("%s %zu of %zu services%s%s.\n", verb, res->ok, total, detail != NULL ? " " : "",
+	    detail != NULL ? detail : "");
+	fflush(stdout);
+	switch (res->error) {
+		case ENODOMAIN:
+		case ENOSERVICE:
+		case E2BIMPL:
+		case EBADNAME:
+		case EUSAGE:
+			return EMANY;
+	}
+	return res->error;
+}
+
+/*
+ * Makes a new request dictionary addressed to an entry of
+ * launchctl_expand_service_targets().
+ */
+xpc_object_t
+launchctl_target_request(xpc_object_t target)
+{
+	xpc_object_t dict = xpc_dictionary_create(NULL, NULL, 0);
+
+	xpc_dictionary_set_uint64(dict, "type", xpc_dictionary_get_uint64(target, "type"));
+	xpc_dictionary_set_uint64(dict, "handle", xpc_dictionary_get_uint64(target, "handle"));
+	xpc_dictionary_set_string(dict, "name", xpc_dictionary_get_string(target, "name"));
+	return dict;
 }
 
 void
@@ -140,6 +592,9 @@ launchctl_test_xpc_send(uint64_t type, uint64_t handle, const char *name)
 	xpc_dictionary_set_uint64(dict, "handle", handle);
 	xpc_dictionary_set_string(dict, "name", name);
 	int err = launchctl_send_xpc_to_launchd(XPC_ROUTINE_UNKNOWN, dict, &reply);
+	if (reply != NULL)
+		xpc_release(reply);
+	xpc_release(dict);
 	return err == 0;
 }
 
@@ -171,18 +626,22 @@ launchctl_setup_xpc_dict_for_service_name(char *servicetarget, xpc_object_t dict
 				*name = split[1];
 			}
 			if (__builtin_available(macOS 13.0, iOS 16.0, tvOS 16.0, watchOS 9.0, bridgeOS 7.0, *)) {
-				if (xpc_user_sessions_enabled() &&
-				    launchctl_test_xpc_send(1, handle, split[1]) == false) {
-					uint64_t fguid = xpc_user_sessions_get_foreground_uid(0);
-					if (launchctl_test_xpc_send(2, fguid, split[1])) {
-						fprintf(stderr,
-						    "Warning: Please switch to user/foreground/%s service identifier\n",
-						    split[1]);
-						xpc_dictionary_set_uint64(dict, "type", 2);
-						xpc_dictionary_set_uint64(dict, "handle",
-						    xpc_user_sessions_get_foreground_uid(0));
+				uint64_t type = 1;
+				if (xpc_user_sessions_enabled() && !launchctl_resolve_cache_lookup(split[1], &type)) {
+					if (launchctl_test_xpc_send(1, handle, split[1])) {
+						launchctl_resolve_cache_store(split[1], 1);
+					} else if (launchctl_test_xpc_send(2, launchctl_foreground_uid(), split[1])) {
+						type = 2;
+						launchctl_resolve_cache_store(split[1], 2);
 					}
 				}
+				if (type == 2) {
+					fprintf(stderr, "Warning: Please switch to user/foreground/%s service identifier\n",
+					    split[1]);
+					xpc_dictionary_set_uint64(dict, "type", 2);
+					// Whoever is in the foreground now, not when the entry was cached
+					xpc_dictionary_set_uint64(dict, "handle", launchctl_foreground_uid());
+				}
 			}
 		}
 		return 0;
@@ -195,7 +654,7 @@ launchctl_setup_xpc_dict_for_service_name(char *servicetarget, xpc_object_t dict
 					    "user/foreground/ specifier is not supported on this platform\n");
 					return ENOTSUP;
 				}
-				handle = xpc_user_sessions_get_foreground_uid(0);
+				handle = launchctl_foreground_uid();
 			}
 		}
 	} else if (strcmp(split[0], "session") == 0) {
@@ -262,9 +721,11 @@ launchctl_create_shmem(xpc_object_t dict, vm_size_t sz)
 	vm_address_t addr = 0;
 	xpc_object_t shmem;
 
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
 	vm_allocate(mach_task_self(), &addr, sz, 0xf0000003);
 	shmem = xpc_shmem_create((void *)addr, sz);
 	xpc_dictionary_set_value(dict, "shmem", shmem);
+	LAUNCHCTL_TRACE_END("shmem_allocate", t, NULL, "\"size\":%zu", (size_t)sz);
 
 	return addr;
 }
@@ -272,7 +733,7 @@ launchctl_create_shmem(xpc_object_t dict, vm_size_t sz)
 void
 launchctl_print_shmem(xpc_object_t dict, vm_address_t addr, vm_size_t sz, FILE *outfd)
 {
-	uint64_t written;
+	uint64_t written, t = LAUNCHCTL_TRACE_BEGIN();
 
 	written = xpc_dictionary_get_uint64(dict, "bytes-written");
 	if (written <= sz) {
@@ -282,15 +743,16 @@ launchctl_print_shmem(xpc_object_t dict, vm_address_t addr, vm_size_t sz, FILE *
 			fwrite((void *)addr, 1, written, outfd);
 		}
 		fflush(outfd);
-		return;
 	}
+	LAUNCHCTL_TRACE_END("shmem_print", t, NULL, "\"bytes\":%" PRIu64, written);
 }
 
 xpc_object_t
 launchctl_xpc_from_plist(const char *path)
 {
 	xpc_object_t plist = NULL;
-	struct stat sb;
+	uint64_t t = LAUNCHCTL_TRACE_BEGIN();
+	struct stat sb = {};
 	void *f;
 	int fd;
 
@@ -308,6 +770,7 @@ launchctl_xpc_from_plist(const char *path)
 	munmap(f, sb.st_size);
 cleanup:
 	close(fd);
+	LAUNCHCTL_TRACE_END("xpc_from_plist", t, path, "\"bytes\":%lld", (long long)sb.st_size);
 	return plist;
 }
 